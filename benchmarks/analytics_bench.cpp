@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+#include "Analytics.hpp"
+#include "MarketDataServer.hpp"
+
+// Indicators per second over the data/csv set: SMA, EMA, VWAP, log returns
+// and volatility of every row of every symbol, for the window in range(0).
+//
+// BM_ColumnKernels runs the server's column kernels. BM_PerRowWindows is
+// what a subscriber does on its own: for every row it recomputes each
+// rolling statistic over the last `window` rows it kept.
+
+namespace {
+
+const MarketDataServiceImpl &service() {
+    static const MarketDataServiceImpl *instance = [] {
+        auto *s = new MarketDataServiceImpl();
+        for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+            if (entry.path().extension() == ".csv") s->load_data(entry.path().string());
+        }
+        return s;
+    }();
+    return *instance;
+}
+
+std::vector<StockSeries> all_series() {
+    const StockStore &store = service().getStockData();
+    std::vector<StockSeries> series;
+    for (SymbolTable::Id id = 0; id < store.size(); ++id) series.push_back(store.series(id));
+    return series;
+}
+
+constexpr int kIndicators = 5;
+
+}  // namespace
+
+static void BM_ColumnKernels(benchmark::State &state) {
+    const auto window = static_cast<std::uint32_t>(state.range(0));
+    const std::vector<StockSeries> series = all_series();
+    std::size_t rows = 0;
+    for (const auto &s : series) rows += s.size();
+
+    for (auto _ : state) {
+        for (const auto &s : series) {
+            for (Indicator indicator : {Indicator::Sma, Indicator::Ema, Indicator::Vwap,
+                                        Indicator::LogReturn, Indicator::Volatility}) {
+                auto column = compute_indicator(s.columns(), indicator, window);
+                benchmark::DoNotOptimize(column.data());
+            }
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * rows * kIndicators));
+}
+BENCHMARK(BM_ColumnKernels)->Arg(20)->Arg(200);
+
+static void BM_PerRowWindows(benchmark::State &state) {
+    const auto window = static_cast<std::size_t>(state.range(0));
+    const std::vector<StockSeries> series = all_series();
+    std::size_t rows = 0;
+    for (const auto &s : series) rows += s.size();
+
+    for (auto _ : state) {
+        for (const auto &s : series) {
+            const PriceColumnsView &c = s.columns();
+            const double alpha = 2.0 / (window + 1.0);
+            double ema = c.size() ? c.close[0] : 0;
+            std::vector<double> returns(c.size());
+            for (std::size_t i = 0; i < c.size(); ++i) {
+                const std::size_t first = i + 1 >= window ? i + 1 - window : 0;
+                double sum = 0, notional = 0, volume = 0;
+                for (std::size_t j = first; j <= i; ++j) {
+                    sum += c.close[j];
+                    notional += c.close[j] * static_cast<double>(c.volume[j]);
+                    volume += static_cast<double>(c.volume[j]);
+                }
+                ema += alpha * (c.close[i] - ema);
+                returns[i] = i ? std::log(c.close[i] / c.close[i - 1]) : 0;
+
+                const std::size_t from = std::max<std::size_t>(first, 1);
+                double mean = 0, variance = 0;
+                for (std::size_t j = from; j <= i; ++j) mean += returns[j];
+                const double n = static_cast<double>(i + 1 - from);
+                mean /= std::max(n, 1.0);
+                for (std::size_t j = from; j <= i; ++j) {
+                    variance += (returns[j] - mean) * (returns[j] - mean);
+                }
+                benchmark::DoNotOptimize(sum / static_cast<double>(i + 1 - first));
+                benchmark::DoNotOptimize(ema);
+                benchmark::DoNotOptimize(notional / volume);
+                benchmark::DoNotOptimize(n < 2 ? 0 : std::sqrt(variance / (n - 1)));
+            }
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * rows * kIndicators));
+}
+BENCHMARK(BM_PerRowWindows)->Arg(20)->Arg(200);
+
+// A stream start once the columns are computed: a cache lookup per indicator.
+static void BM_CachedIndicatorSet(benchmark::State &state) {
+    const std::vector<StockSeries> series = all_series();
+    IndicatorWindows windows;
+    windows.sma = windows.ema = windows.vwap = windows.volatility = 20;
+    windows.log_return = true;
+
+    IndicatorCache cache;
+    for (auto _ : state) {
+        for (const auto &s : series) benchmark::DoNotOptimize(cache.get(s, windows));
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * series.size()));
+}
+BENCHMARK(BM_CachedIndicatorSet);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "CsvLoader.hpp"
+#include "MappedFile.hpp"
+#include "Snapshot.hpp"
+
+// CSV ingest throughput (MB/s) of the former getline/stringstream/stod loader
+// and of the memory-mapped from_chars loader, both filling PriceColumns, and
+// the warm start from a binary snapshot of the same rows (reported against
+// the CSV size, i.e. the equivalent ingest rate).
+//
+// The input is a single file made of the rows of every data/csv file,
+// repeated range(0) times, written to the temp directory once per size.
+
+namespace {
+
+std::string make_input(int repeats) {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / ("csv_parse_bench_" + std::to_string(repeats) + ".csv");
+    if (std::filesystem::exists(path)) return path.string();
+
+    std::string rows;
+    for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+        if (entry.path().extension() != ".csv") continue;
+        std::ifstream file(entry.path());
+        std::string line;
+        std::getline(file, line);  // symbol
+        std::getline(file, line);  // header
+        while (std::getline(file, line)) rows += line + "\n";
+    }
+
+    std::ofstream out(path);
+    out << "BENCH\nDate,Adj Close,Close,High,Low,Open,Volume\n";
+    for (int i = 0; i < repeats; ++i) out << rows;
+    return path.string();
+}
+
+// The loader as it was before the mmap/from_chars path.
+void legacy_load(const std::string &filepath, PriceColumns &columns) {
+    std::ifstream file(filepath);
+    std::string line;
+    std::string symbol;
+    std::getline(file, symbol);
+    std::getline(file, line);
+
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+
+        std::stringstream ss(line);
+        std::string date;
+        std::string tmp;
+
+        std::getline(ss, date, ',');
+        std::getline(ss, tmp, ',');
+        double adj_close = std::stod(tmp);
+        std::getline(ss, tmp, ',');
+        double close = std::stod(tmp);
+        std::getline(ss, tmp, ',');
+        double high = std::stod(tmp);
+        std::getline(ss, tmp, ',');
+        double low = std::stod(tmp);
+        std::getline(ss, tmp, ',');
+        double open = std::stod(tmp);
+        std::getline(ss, tmp, ',');
+        long volume = std::stol(tmp);
+
+        columns.append(StockData(date, adj_close, close, high, low, open, volume));
+    }
+}
+
+}  // namespace
+
+static void BM_LoadLegacy(benchmark::State& state) {
+    const std::string path = make_input(static_cast<int>(state.range(0)));
+    std::size_t rows = 0;
+
+    for (auto _ : state) {
+        PriceColumns columns;
+        legacy_load(path, columns);
+        rows = columns.size();
+        benchmark::DoNotOptimize(columns.close.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+static void BM_LoadMapped(benchmark::State& state) {
+    const std::string path = make_input(static_cast<int>(state.range(0)));
+    std::size_t rows = 0;
+
+    for (auto _ : state) {
+        MappedFile file(path);
+        PriceColumns columns;
+        CsvParseResult result = parse_price_csv(file.data(), columns);
+        rows = result.rows;
+        benchmark::DoNotOptimize(columns.close.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+static void BM_OpenSnapshot(benchmark::State& state) {
+    const std::string path = make_input(static_cast<int>(state.range(0)));
+    const std::string snapshot_path = path + ".snap";
+    {
+        MappedFile file(path);
+        PriceColumns columns;
+        CsvParseResult result = parse_price_csv(file.data(), columns);
+        StockStore store;
+        store.add(result.symbol, std::move(columns));
+        std::string error;
+        if (!write_snapshot(store, {}, snapshot_path, error)) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+    }
+
+    std::size_t rows = 0;
+    for (auto _ : state) {
+        std::string error;
+        auto snapshot = Snapshot::open(snapshot_path, false, error);
+        StockStore store;
+        for (std::size_t i = 0; i < snapshot->size(); ++i) {
+            store.add(snapshot->symbol(i), snapshot->series(i));
+        }
+        rows = store.series("BENCH").size();
+        benchmark::DoNotOptimize(rows);
+    }
+
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+BENCHMARK(BM_LoadLegacy)->Arg(1)->Arg(50)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadMapped)->Arg(1)->Arg(50)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OpenSnapshot)->Arg(1)->Arg(50)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include "utilities/logger.hpp"
+
+// Cost of one log call on the calling thread, with 1 to 16 threads logging
+// at once: util::logger (per-thread ring, formatted on its own thread)
+// against the mutex-guarded std::cout pattern it replaced, writing into a
+// stream that discards its output so that only the logging path is timed.
+
+namespace {
+
+// Discards everything, like /dev/null, without a system call.
+class null_buffer : public std::streambuf
+{
+    protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+null_buffer null_buf;
+std::ostream null_stream(&null_buf);
+std::mutex null_mutex;
+
+std::unique_ptr<util::logger> shared_logger;
+
+util::logger &bench_logger()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+        util::logger_options options;
+        options.ring_capacity = 1 << 14;
+        options.idle_sleep = std::chrono::microseconds(50);
+        options.sink = [](std::string_view, bool) {};
+        shared_logger = std::make_unique<util::logger>(options);
+    });
+    return *shared_logger;
+}
+
+}  // namespace
+
+// The line the server writes for every tick.
+static void BM_AsyncLogger(benchmark::State &state) {
+    util::logger &log = bench_logger();
+    const std::uint64_t dropped = log.dropped();
+    double price = 187.25;
+    std::int64_t volume = 51234000;
+    for (auto _ : state) {
+        log.log(util::log_level::info,
+                "[Server] Sent update for {}, Adj Close: {}, Close: {}, Volume: {}",
+                "AAPL", price, price, volume);
+        price += 0.01;
+    }
+    if (state.thread_index() == 0) {
+        log.flush();
+        state.counters["dropped"] = static_cast<double>(log.dropped() - dropped);
+    }
+}
+BENCHMARK(BM_AsyncLogger)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// A disabled level: the cost of the filter alone.
+static void BM_AsyncLoggerDisabled(benchmark::State &state) {
+    util::logger &log = bench_logger();
+    double price = 187.25;
+    for (auto _ : state) {
+        if (log.enabled(util::log_level::debug)) {
+            log.log(util::log_level::debug, "[Server] Sent update for {}, Adj Close: {}",
+                    "AAPL", price);
+        }
+        benchmark::DoNotOptimize(price += 0.01);
+    }
+}
+BENCHMARK(BM_AsyncLoggerDisabled)->Threads(1)->Threads(16)->UseRealTime();
+
+// Formatting under a global mutex and std::endl, as before.
+static void BM_MutexOstream(benchmark::State &state) {
+    double price = 187.25;
+    std::int64_t volume = 51234000;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(null_mutex);
+        null_stream << "[Server] Sent update for " << "AAPL"
+                    << ", Adj Close: " << price << ", Close: " << price
+                    << ", Volume: " << volume << std::endl;
+        price += 0.01;
+    }
+}
+BENCHMARK(BM_MutexOstream)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,187 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "utilities/latency_histogram.hpp"
+#include "utilities/logger.hpp"
+
+// End-to-end throughput of the product: the sync server in-process on an
+// ephemeral port, replaying as fast as possible to K MarketDataClient
+// subscribers, each on its own thread and connection, each reading the
+// whole history of the first M symbols over one SubscribeMany stream.
+//
+//   msgs_per_s       updates received by all the clients
+//   bytes_per_s      payload bytes written by the server (bytes_sent)
+//   cpu_ns_per_msg   CPU time of the whole process (server and clients)
+//                    per update
+//   lat_p50/p99/max  receive time minus the server's timestamp, in ns;
+//                    unpaced, this is mostly time queued behind the replay
+//
+// Results are also written as JSON to marketdata_bench.json, unless
+// --benchmark_out names another file, to compare releases.
+
+namespace {
+
+const std::vector<std::string> kSymbols = {"AAPL", "MSFT", "GOOGL", "AMZN", "META",
+                                           "JPM",  "JNJ",  "NVDA",  "PG",   "TSLA"};
+
+struct Server {
+    Server() {
+        for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+            if (entry.path().extension() == ".csv") service.load_data(entry.path().string());
+        }
+        service.set_replay(ReplayOptions::afap());
+
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&service);
+        server = builder.BuildAndStart();
+    }
+
+    ~Server() {
+        if (server) server->Shutdown();
+    }
+
+    // Payload bytes written so far, over all symbols.
+    std::int64_t bytes_sent() const {
+        marketdata::StatsReply stats;
+        service.metrics().fill("bytes_sent", stats);
+        std::int64_t bytes = 0;
+        for (const auto &metric : stats.metrics()) bytes += metric.value();
+        return bytes;
+    }
+
+    MarketDataServiceImpl service;
+    std::unique_ptr<grpc::Server> server;
+    int port = 0;
+};
+
+double cpu_seconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// One connection per subscriber: channels with different arguments do not
+// share a subchannel.
+std::shared_ptr<grpc::Channel> connect(int port, int subscriber) {
+    grpc::ChannelArguments args;
+    args.SetInt("marketdata_bench.subscriber", subscriber);
+    args.SetMaxReceiveMessageSize(-1);
+    return grpc::CreateCustomChannel("localhost:" + std::to_string(port),
+                                     grpc::InsecureChannelCredentials(), args);
+}
+
+struct Subscriber {
+    util::latency_histogram latency;
+    std::int64_t updates = 0;
+    grpc::Status status;
+};
+
+}  // namespace
+
+static void BM_EndToEnd(benchmark::State &state) {
+    const auto subscribers = static_cast<int>(state.range(0));
+    const auto symbol_count = static_cast<std::size_t>(state.range(1));
+    const std::vector<std::string> symbols(kSymbols.begin(), kSymbols.begin() + symbol_count);
+
+    static Server server;
+    if (!server.server) {
+        state.SkipWithError("server did not start");
+        return;
+    }
+
+    util::latency_histogram latency;
+    std::int64_t updates = 0;
+    std::int64_t bytes = 0;
+    double cpu = 0;
+
+    for (auto _ : state) {
+        std::vector<std::shared_ptr<grpc::Channel>> channels;
+        for (int i = 0; i < subscribers; ++i) {
+            channels.push_back(connect(server.port, i));
+            channels.back()->WaitForConnected(std::chrono::system_clock::now() +
+                                              std::chrono::seconds(5));
+        }
+        std::vector<Subscriber> results(static_cast<std::size_t>(subscribers));
+
+        const std::int64_t bytes_before = server.bytes_sent();
+        const double cpu_before = cpu_seconds();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < subscribers; ++i) {
+            threads.emplace_back([&, i] {
+                Subscriber &result = results[static_cast<std::size_t>(i)];
+                auto client = MarketDataClient::createClient(channels[static_cast<std::size_t>(i)]);
+                if (!client.ok()) {
+                    result.status = grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                                                 std::string(client.status().message()));
+                    return;
+                }
+                result.status = client->subscribeToSymbols(symbols, [&](const marketdata::StockPrice &price) {
+                    const std::int64_t elapsed = wall_clock_now_ns() - price.timestamp_ns();
+                    result.latency.record(elapsed > 0 ? static_cast<std::uint64_t>(elapsed) : 0);
+                    ++result.updates;
+                });
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        cpu += cpu_seconds() - cpu_before;
+        bytes += server.bytes_sent() - bytes_before;
+
+        for (const Subscriber &result : results) {
+            if (!result.status.ok()) {
+                state.SkipWithError(result.status.error_message().c_str());
+                return;
+            }
+            latency.merge(result.latency);
+            updates += result.updates;
+        }
+    }
+
+    state.counters["msgs_per_s"] = benchmark::Counter(static_cast<double>(updates),
+                                                      benchmark::Counter::kIsRate);
+    state.counters["bytes_per_s"] = benchmark::Counter(static_cast<double>(bytes),
+                                                       benchmark::Counter::kIsRate);
+    state.counters["cpu_ns_per_msg"] = updates > 0 ? cpu * 1e9 / static_cast<double>(updates) : 0.0;
+    state.counters["lat_p50_ns"] = static_cast<double>(latency.percentile(50));
+    state.counters["lat_p99_ns"] = static_cast<double>(latency.percentile(99));
+    state.counters["lat_max_ns"] = static_cast<double>(latency.max());
+}
+
+BENCHMARK(BM_EndToEnd)
+    ->ArgNames({"subscribers", "symbols"})
+    ->ArgsProduct({{1, 4, 16, 64}, {1, 4, 10}})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+int main(int argc, char **argv) {
+    std::vector<char *> args(argv, argv + argc);
+    std::string out = "--benchmark_out=marketdata_bench.json";
+    std::string format = "--benchmark_out_format=json";
+    const bool has_out = std::any_of(args.begin() + 1, args.end(), [](const char *arg) {
+        return std::string_view(arg).starts_with("--benchmark_out=");
+    });
+    if (!has_out) {
+        args.push_back(out.data());
+        args.push_back(format.data());
+    }
+
+    // A line per stream start and end would be measured too.
+    util::default_logger().set_level(util::log_level::warn);
+
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+    benchmark::AddCustomContext("server", "MarketDataServiceImpl (sync), replay as fast as possible");
+    benchmark::AddCustomContext("encoding", "FULL");
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
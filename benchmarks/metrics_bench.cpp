@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "utilities/metrics.hpp"
+
+// Cost of recording one metric on the hot path, with 1 to 16 threads
+// recording into the same metric at once: the sharded counter and histogram
+// of util::metrics_registry against a single shared atomic and a mutex.
+
+namespace {
+
+util::sharded_counter sharded;
+util::sharded_histogram sharded_latency;
+std::atomic<std::uint64_t> shared{0};
+std::mutex shared_mutex;
+std::uint64_t guarded = 0;
+
+}  // namespace
+
+static void BM_ShardedCounter(benchmark::State &state) {
+    for (auto _ : state) sharded.add();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedCounter)->ThreadRange(1, 16);
+
+static void BM_SharedAtomic(benchmark::State &state) {
+    for (auto _ : state) shared.fetch_add(1, std::memory_order_relaxed);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedAtomic)->ThreadRange(1, 16);
+
+static void BM_MutexCounter(benchmark::State &state) {
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        ++guarded;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexCounter)->ThreadRange(1, 16);
+
+static void BM_ShardedHistogram(benchmark::State &state) {
+    std::uint64_t value = 0;
+    for (auto _ : state) sharded_latency.record(++value & 0xffff);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedHistogram)->ThreadRange(1, 16);
+
+BENCHMARK_MAIN();
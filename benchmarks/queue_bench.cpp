@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "utilities/mpmc_queue.hpp"
+#include "utilities/queue_safe.hpp"
+#include "utilities/spsc_queue.hpp"
+
+// Compares util::queue_safe (mutex + condition variable, unbounded) with the
+// lock-free ring buffers. Blocking push/pop are used on all queues, so the
+// numbers include the cost of waiting when one side outruns the other.
+
+namespace {
+
+constexpr int items_per_run = 100000;
+constexpr std::size_t ring_capacity = 1024;
+
+// Blocking push/pop behind one interface.
+template <class Queue>
+struct ops {
+    static void push(Queue &q, int v) { q.push(std::move(v)); }
+    static int pop(Queue &q) { return q.pop(); }
+};
+
+template <>
+struct ops<util::queue_safe<int>> {
+    static void push(util::queue_safe<int> &q, int v) { q.push(v); }
+    static int pop(util::queue_safe<int> &q) { return q.pop(); }
+};
+
+template <class Queue>
+Queue make_queue() { return Queue(ring_capacity); }
+
+template <>
+util::queue_safe<int> make_queue<util::queue_safe<int>>() { return {}; }
+
+template <class Queue>
+struct holder {
+    Queue queue = make_queue<Queue>();
+};
+
+}  // namespace
+
+// Throughput: range(0) producers and range(1) consumers move items_per_run
+// items through one queue. Items are split evenly between the threads.
+template <class Queue>
+static void BM_Throughput(benchmark::State &state) {
+    const int producers = static_cast<int>(state.range(0));
+    const int consumers = static_cast<int>(state.range(1));
+    const int per_producer = items_per_run / producers;
+    const int per_consumer = per_producer * producers / consumers;
+
+    for (auto _ : state) {
+        holder<Queue> h;
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < per_producer; i++) ops<Queue>::push(h.queue, i);
+            });
+        }
+        for (int c = 0; c < consumers; c++) {
+            threads.emplace_back([&] {
+                long long sum = 0;
+                for (int i = 0; i < per_consumer; i++) sum += ops<Queue>::pop(h.queue);
+                benchmark::DoNotOptimize(sum);
+            });
+        }
+        for (auto &t : threads) t.join();
+    }
+    state.SetItemsProcessed(state.iterations() * per_producer * producers);
+}
+
+// Handoff latency: two threads bounce one token through a pair of queues;
+// reports the mean one-way time in ns.
+template <class Queue>
+static void BM_PingPong(benchmark::State &state) {
+    constexpr int round_trips = 10000;
+    for (auto _ : state) {
+        holder<Queue> ping, pong;
+        std::thread echo([&] {
+            for (int i = 0; i < round_trips; i++) ops<Queue>::push(pong.queue, ops<Queue>::pop(ping.queue));
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < round_trips; i++) {
+            ops<Queue>::push(ping.queue, i);
+            benchmark::DoNotOptimize(ops<Queue>::pop(pong.queue));
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        echo.join();
+
+        state.counters["handoff_ns"] = benchmark::Counter(
+            std::chrono::duration<double, std::nano>(elapsed).count() / (2.0 * round_trips));
+    }
+}
+
+static void ProducerConsumerArgs(benchmark::internal::Benchmark *b) {
+    for (int p : {1, 2, 4}) {
+        for (int c : {1, 2, 4}) b->Args({p, c});
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Throughput, util::queue_safe<int>)->Apply(ProducerConsumerArgs)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Throughput, util::mpmc_queue<int>)->Apply(ProducerConsumerArgs)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Throughput, util::spsc_queue<int>)->Args({1, 1})->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_PingPong, util::queue_safe<int>)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PingPong, util::mpmc_queue<int>)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PingPong, util::spsc_queue<int>)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <google/protobuf/arena.h>
+#include <grpcpp/grpcpp.h>
+#include "MarketDataServer.hpp"
+
+// Encode-and-write cost of a Subscribe stream, per message: filling the
+// StockPrice of a row and serializing it into the grpc::ByteBuffer handed to
+// the transport, as the engines do before Write().
+//
+//   message = 0 : a fresh StockPrice per row, with its symbol set (the sync
+//                 Subscribe before PriceMessage)
+//   message = 1 : a fresh StockPrice per row on a google::protobuf::Arena
+//                 reset every row, its first block on the stack
+//   message = 2 : the stream's PriceMessage, the symbol set once
+//
+// allocs_per_msg counts global operator new calls after a warm-up pass. The
+// serialization into the ByteBuffer makes one in every variant; the rest is
+// protobuf's: the symbol string, the CompactPrice submessage.
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+const StockSeries &rows() {
+    static const StockSeries *series = [] {
+        MarketDataServiceImpl service;
+        service.load_data(std::string(CSV_DATA_DIR) + "/AAPL_5y.csv");
+        return new StockSeries(service.getStockData("AAPL"));
+    }();
+    return *series;
+}
+
+void write(const marketdata::StockPrice &price, grpc::ByteBuffer &buffer) {
+    bool own_buffer = false;
+    buffer.Clear();
+    grpc::SerializationTraits<marketdata::StockPrice>::Serialize(price, &buffer, &own_buffer);
+    benchmark::DoNotOptimize(buffer);
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+static void BM_SendPath(benchmark::State &state) {
+    const auto message = state.range(0);
+    const auto encoding = state.range(1) ? marketdata::COMPACT : marketdata::FULL;
+    const StockSeries &series = rows();
+    const std::string symbol = "AAPL";
+    const IndicatorSet no_indicators;
+    if (series.empty()) {
+        state.SkipWithError("no AAPL rows");
+        return;
+    }
+
+    grpc::ByteBuffer buffer;
+    PriceMessage reused(symbol, encoding);
+    CompactEncoder compact;
+    CompactEncoder *encoder = encoding == marketdata::COMPACT ? &compact : nullptr;
+    alignas(8) char arena_block[1024];
+
+    std::size_t before = 0;
+    std::int64_t messages = 0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < series.size(); ++i) {
+            if (message == 0) {
+                marketdata::StockPrice price;
+                if (!encoder) price.set_symbol(symbol);
+                fill_price(price, series[i], i + 1, encoder);
+                write(price, buffer);
+            } else if (message == 1) {
+                google::protobuf::ArenaOptions options;
+                options.initial_block = arena_block;
+                options.initial_block_size = sizeof(arena_block);
+                google::protobuf::Arena arena(options);
+                auto *price = google::protobuf::Arena::CreateMessage<marketdata::StockPrice>(&arena);
+                if (!encoder) price->set_symbol(symbol);
+                fill_price(*price, series[i], i + 1, encoder);
+                write(*price, buffer);
+            } else {
+                write(reused.fill(series[i], i, no_indicators), buffer);
+            }
+        }
+        // The first pass warms the reused message and the buffer.
+        if (messages == 0) before = g_allocations.load();
+        messages += static_cast<std::int64_t>(series.size());
+    }
+
+    const std::int64_t counted = messages - static_cast<std::int64_t>(series.size());
+    state.counters["allocs_per_msg"] =
+        counted > 0 ? double(g_allocations.load() - before) / double(counted) : 0.0;
+    state.counters["time_per_msg"] = benchmark::Counter(
+        double(messages), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetItemsProcessed(messages);
+}
+
+BENCHMARK(BM_SendPath)
+    ->ArgNames({"message", "compact"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <grpcpp/grpcpp.h>
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "SharedMemoryClient.hpp"
+#include "SharedMemoryFeed.hpp"
+#include "utilities/latency_histogram.hpp"
+
+// Same-host delivery of the replay: gRPC over loopback vs. the shared-memory
+// feed, from the same in-process server.
+//
+//   paced = 0 : every symbol replayed as fast as possible, i.e. the
+//               throughput of each transport (ticks/s)
+//   paced = 1 : one symbol at 5000 ticks/s, so that nothing queues and the
+//               latency is that of the transport alone
+//
+// One-way latency is the receive time minus the server's timestamp, taken
+// right before the gRPC Write() or the ring push, in ns. The gRPC client
+// reads one SubscribeMany stream in the COMPACT encoding; the shared-memory
+// client busy-polls its rings.
+
+namespace {
+
+enum Transport { kGrpc = 0, kSharedMemory = 1 };
+
+const std::vector<std::string> kSymbols = {"AAPL", "MSFT", "GOOGL", "AMZN", "META",
+                                           "JPM",  "JNJ",  "NVDA",  "PG",   "TSLA"};
+
+struct Server {
+    Server() {
+        for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+            if (entry.path().extension() == ".csv") service.load_data(entry.path().string());
+        }
+
+        SharedMemoryOptions options;
+        options.name = "/marketdata_bench_" + std::to_string(::getpid());
+        options.max_symbols = static_cast<std::uint32_t>(kSymbols.size());
+        options.ring_capacity = 1 << 12;  // a whole history: readers never lose ticks
+        feed = std::make_unique<SharedMemoryFeed>(service, options);
+        std::string error;
+        if (!feed->start(error)) {
+            this->error = error;
+            return;
+        }
+        service.set_shared_memory(feed.get());
+
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&service);
+        server = builder.BuildAndStart();
+        channel = grpc::CreateChannel("localhost:" + std::to_string(port),
+                                      grpc::InsecureChannelCredentials());
+    }
+
+    ~Server() {
+        if (server) server->Shutdown();
+        if (feed) feed->stop();
+    }
+
+    MarketDataServiceImpl service;
+    std::unique_ptr<SharedMemoryFeed> feed;
+    std::unique_ptr<grpc::Server> server;
+    std::shared_ptr<grpc::Channel> channel;
+    int port = 0;
+    std::string error;
+};
+
+class Recorder : public PriceConsumer {
+    public:
+    explicit Recorder(util::latency_histogram &latency) : m_latency(latency) {}
+
+    void on_ticks(const std::string &, std::span<const Tick> ticks) override {
+        for (const Tick &tick : ticks) record(tick.timestamp_ns, tick.received_ns);
+    }
+
+    void record(std::int64_t timestamp_ns, std::int64_t received_ns) {
+        const std::int64_t latency = received_ns - timestamp_ns;
+        m_latency.record(latency > 0 ? static_cast<std::uint64_t>(latency) : 0);
+    }
+
+    private:
+    util::latency_histogram &m_latency;
+};
+
+}  // namespace
+
+static void BM_Transport(benchmark::State &state) {
+    const auto transport = static_cast<Transport>(state.range(0));
+    const bool paced = state.range(1) != 0;
+
+    static Server server;
+    if (!server.error.empty() || !server.server) {
+        state.SkipWithError(server.error.empty() ? "server did not start" : server.error.c_str());
+        return;
+    }
+    server.service.set_replay(paced ? ReplayOptions::fixed_rate(5000) : ReplayOptions::afap());
+    const std::vector<std::string> symbols =
+        paced ? std::vector<std::string>{"AAPL"} : kSymbols;
+
+    util::latency_histogram latency;
+    Recorder recorder(latency);
+    std::int64_t ticks = 0;
+    std::uint64_t lost = 0;
+
+    for (auto _ : state) {
+        grpc::Status status;
+        if (transport == kSharedMemory) {
+            SharedMemoryClientOptions options;
+            options.idle_sleep = std::chrono::microseconds(0);
+            SharedMemoryClient client(server.channel, symbols, recorder, options);
+            status = client.run();
+            ticks += static_cast<std::int64_t>(client.received());
+            lost += client.lost();
+        } else {
+            auto client = MarketDataClient::createClient(server.channel);
+            status = client->subscribeToSymbols(symbols, [&](const marketdata::StockPrice &price) {
+                recorder.record(price.timestamp_ns(), wall_clock_now_ns());
+                ++ticks;
+            }, 0, marketdata::COMPACT);
+        }
+        if (!status.ok()) {
+            state.SkipWithError(status.error_message().c_str());
+            return;
+        }
+    }
+
+    state.SetItemsProcessed(ticks);
+    state.counters["lat_p50_ns"] = static_cast<double>(latency.percentile(50));
+    state.counters["lat_p99_ns"] = static_cast<double>(latency.percentile(99));
+    state.counters["lat_max_ns"] = static_cast<double>(latency.max());
+    state.counters["lost"] = static_cast<double>(lost);
+}
+
+BENCHMARK(BM_Transport)
+    ->ArgNames({"shm", "paced"})
+    ->ArgsProduct({{kGrpc, kSharedMemory}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
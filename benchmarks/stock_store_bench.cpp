@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MarketDataServer.hpp"
+
+// Memory footprint and full-scan throughput of the data/csv set, stored as
+// the former array of structs (std::string date + doubles per row, one vector
+// per symbol in an unordered_map) and as the columnar StockStore.
+//
+// The scan computes the volume-weighted close of every symbol, i.e. it reads
+// two fields of every row.
+
+namespace {
+
+struct LegacyStockData {
+    std::string date;
+    double adj_close;
+    double close;
+    double high;
+    double low;
+    double open;
+    long long volume;
+};
+
+using LegacyStore = std::unordered_map<std::string, std::vector<LegacyStockData>>;
+
+const MarketDataServiceImpl &service() {
+    static const MarketDataServiceImpl *instance = [] {
+        auto *s = new MarketDataServiceImpl();
+        for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+            if (entry.path().extension() == ".csv") s->load_data(entry.path().string());
+        }
+        return s;
+    }();
+    return *instance;
+}
+
+const LegacyStore &legacy_store() {
+    static LegacyStore instance = [] {
+        LegacyStore s;
+        const StockStore &store = service().getStockData();
+        for (SymbolTable::Id id = 0; id < store.size(); ++id) {
+            auto &rows = s[store.symbol(id)];
+            for (const StockData &row : store.series(id)) {
+                rows.push_back({row.date(), row.adj_close(), row.close(), row.high(),
+                                row.low(), row.open(), row.volume()});
+            }
+        }
+        return s;
+    }();
+    return instance;
+}
+
+std::size_t legacy_memory_bytes(const LegacyStore &store) {
+    std::size_t bytes = store.bucket_count() * sizeof(void *);
+    for (const auto &[symbol, rows] : store) {
+        // Map node: key, value and the next pointer.
+        bytes += sizeof(std::pair<const std::string, std::vector<LegacyStockData>>) + sizeof(void *);
+        bytes += rows.capacity() * sizeof(LegacyStockData);
+        for (const auto &row : rows) {
+            // Dates outside the small-string buffer live on the heap.
+            if (row.date.capacity() > std::string().capacity()) bytes += row.date.capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+std::size_t row_count() {
+    std::size_t rows = 0;
+    for (const auto &[symbol, series] : legacy_store()) rows += series.size();
+    return rows;
+}
+
+}  // namespace
+
+static void BM_ScanLegacy(benchmark::State& state) {
+    const LegacyStore &store = legacy_store();
+
+    for (auto _ : state) {
+        for (const auto &[symbol, rows] : store) {
+            double notional = 0.0;
+            double volume = 0.0;
+            for (const auto &row : rows) {
+                notional += row.close * static_cast<double>(row.volume);
+                volume += static_cast<double>(row.volume);
+            }
+            benchmark::DoNotOptimize(notional / volume);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * row_count());
+    state.counters["memory_bytes"] = static_cast<double>(legacy_memory_bytes(store));
+    state.counters["row_bytes"] = sizeof(LegacyStockData);
+}
+
+static void BM_ScanColumnar(benchmark::State& state) {
+    const StockStore &store = service().getStockData();
+
+    for (auto _ : state) {
+        for (SymbolTable::Id id = 0; id < store.size(); ++id) {
+            const StockSeries series = store.series(id);
+            const PriceColumnsView &columns = series.columns();
+            const double *close = columns.close.data();
+            const std::int64_t *volumes = columns.volume.data();
+            const std::size_t n = columns.size();
+            double notional = 0.0;
+            double volume = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                notional += close[i] * static_cast<double>(volumes[i]);
+                volume += static_cast<double>(volumes[i]);
+            }
+            benchmark::DoNotOptimize(notional / volume);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * row_count());
+    state.counters["memory_bytes"] = static_cast<double>(store.memory_bytes());
+    state.counters["row_bytes"] = sizeof(std::int32_t) + 5 * sizeof(double) + sizeof(std::int64_t);
+}
+
+BENCHMARK(BM_ScanLegacy);
+BENCHMARK(BM_ScanColumnar);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,184 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include "MarketDataServer.hpp"
+#include "AsyncMarketDataServer.hpp"
+
+// Subscriber count vs. server threads and send latency, for the synchronous
+// (one thread per stream) and the completion-queue server engines, the latter
+// with one replay per subscriber or one shared (fan-out) replay per symbol.
+//
+// The server runs in-process on an ephemeral port. All the subscribers are
+// driven by a single client thread through an async CompletionQueue, so that
+// the thread count growth of the process is entirely due to the server.
+//
+// Latency is measured as receive time minus the timestamp stamped by the
+// server right before Write().
+
+namespace {
+
+enum Engine { kSync = 0, kAsync = 1, kFanout = 2 };
+
+constexpr auto kWindow = std::chrono::seconds(2);
+const ReplayOptions kPacing =
+    ReplayOptions::uniform(std::chrono::milliseconds(10), std::chrono::milliseconds(20));
+
+const std::vector<std::string> kSymbols = {"AAPL", "MSFT", "GOOGL", "AMZN", "META",
+                                           "JPM",  "JNJ",  "NVDA",  "PG",   "TSLA"};
+
+long long count_threads() {
+#ifdef __linux__
+    long long n = 0;
+    for ([[maybe_unused]] const auto &entry : std::filesystem::directory_iterator("/proc/self/task")) {
+        ++n;
+    }
+    return n;
+#else
+    return 0;
+#endif
+}
+
+void load_stock_data(MarketDataServiceImpl &service) {
+    for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+        if (entry.path().extension() == ".csv") service.load_data(entry.path().string());
+    }
+    service.set_replay(kPacing);
+}
+
+struct Subscriber {
+    enum class State { Starting, Reading, Finishing };
+
+    grpc::ClientContext context;
+    marketdata::StockPrice price;
+    grpc::Status status;
+    std::unique_ptr<grpc::ClientAsyncReader<marketdata::StockPrice>> reader;
+    State state = State::Starting;
+};
+
+}  // namespace
+
+static void BM_Subscribers(benchmark::State &state) {
+    const auto engine      = static_cast<Engine>(state.range(0));
+    const auto subscribers = static_cast<int>(state.range(1));
+
+    std::vector<long long> latencies;
+    long long peak_threads = 0;
+    long long base_threads = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        MarketDataServiceImpl service;
+        load_stock_data(service);
+        state.ResumeTiming();
+
+        latencies.clear();
+        base_threads = count_threads();
+
+        AsyncMarketDataServer async_engine(service, std::max(1u, std::thread::hardware_concurrency()));
+
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+        if (engine == kFanout) {
+            async_engine.set_fanout(FanoutOptions{});
+        }
+        if (engine != kSync) {
+            async_engine.configure(builder);
+        } else {
+            builder.RegisterService(&service);
+        }
+        auto server = builder.BuildAndStart();
+        if (engine != kSync) async_engine.start();
+
+        grpc::ChannelArguments args;
+        args.SetMaxReceiveMessageSize(-1);
+        auto stub = marketdata::MarketData::NewStub(grpc::CreateCustomChannel(
+            "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials(), args));
+
+        grpc::CompletionQueue cq;
+        std::vector<std::unique_ptr<Subscriber>> subs;
+        for (int i = 0; i < subscribers; ++i) {
+            auto sub = std::make_unique<Subscriber>();
+            marketdata::StockRequest request;
+            request.set_symbol(kSymbols[i % kSymbols.size()]);
+            sub->reader = stub->PrepareAsyncSubscribe(&sub->context, request, &cq);
+            sub->reader->StartCall(sub.get());
+            subs.push_back(std::move(sub));
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + kWindow;
+        bool cancelled = false;
+        int finished = 0;
+        peak_threads = base_threads;
+
+        while (finished < subscribers) {
+            if (!cancelled && std::chrono::steady_clock::now() >= deadline) {
+                for (auto &sub : subs) sub->context.TryCancel();
+                cancelled = true;
+            }
+
+            void *tag = nullptr;
+            bool ok = false;
+            auto status = cq.AsyncNext(&tag, &ok, std::chrono::system_clock::now() + std::chrono::milliseconds(50));
+            if (status != grpc::CompletionQueue::GOT_EVENT) continue;
+
+            auto *sub = static_cast<Subscriber *>(tag);
+            switch (sub->state) {
+                case Subscriber::State::Starting:
+                case Subscriber::State::Reading:
+                    if (sub->state == Subscriber::State::Reading && ok && !cancelled) {
+                        latencies.push_back(wall_clock_ns() - sub->price.timestamp_ns());
+                    }
+                    if (ok) {
+                        sub->state = Subscriber::State::Reading;
+                        sub->reader->Read(&sub->price, sub);
+                    } else {
+                        sub->state = Subscriber::State::Finishing;
+                        sub->reader->Finish(&sub->status, sub);
+                    }
+                    break;
+                case Subscriber::State::Finishing:
+                    ++finished;
+                    break;
+            }
+
+            if (latencies.size() % 256 == 0) {
+                peak_threads = std::max(peak_threads, count_threads());
+            }
+        }
+
+        server->Shutdown();
+        async_engine.stop();
+        cq.Shutdown();
+        void *tag = nullptr;
+        bool ok = false;
+        while (cq.Next(&tag, &ok)) {}
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) -> double {
+        if (latencies.empty()) return 0.0;
+        return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))] / 1000.0;
+    };
+
+    state.counters["subscribers"]    = subscribers;
+    state.counters["server_threads"] = static_cast<double>(peak_threads - base_threads);
+    state.counters["msgs_per_s"]     = benchmark::Counter(static_cast<double>(latencies.size()), benchmark::Counter::kIsRate);
+    state.counters["p50_us"]         = percentile(0.50);
+    state.counters["p99_us"]         = percentile(0.99);
+}
+
+BENCHMARK(BM_Subscribers)
+    ->ArgNames({"engine", "subscribers"})
+    ->ArgsProduct({{kSync, kAsync, kFanout}, {16, 64, 256, 1024}})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
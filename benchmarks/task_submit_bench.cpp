@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include "utilities/thread_pool.hpp"
+
+// Submit throughput and heap allocations per task of util::thread_pool.
+// Every global operator new is counted, so allocs_per_task covers the
+// submitting thread and the workers alike.
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+constexpr unsigned int tasks_per_batch = 10000;
+
+util::scheduling mode_of(const benchmark::State& state) {
+    return state.range(0) ? util::scheduling::work_stealing
+                          : util::scheduling::shared_queue;
+}
+
+// Runs `submit_batch` once untimed, so that the pools are warm, then
+// measures it and reports allocations per task.
+template <class Batch>
+void measure(benchmark::State& state, Batch submit_batch) {
+    submit_batch();
+
+    const std::size_t before = g_allocations.load();
+    for (auto _ : state) {
+        submit_batch();
+    }
+    const std::size_t tasks = state.iterations() * tasks_per_batch;
+    state.counters["allocs_per_task"] =
+        benchmark::Counter(double(g_allocations.load() - before) / double(tasks));
+    state.SetItemsProcessed(tasks);
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// What ExecuteTask did before: a shared_ptr'd packaged_task around a
+// std::bind, wrapped in a std::function.
+static void BM_SubmitPackagedTask(benchmark::State& state) {
+    util::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()), mode_of(state));
+    std::vector<std::future<int>> futures;
+    futures.reserve(tasks_per_batch);
+
+    measure(state, [&] {
+        for (unsigned int i = 0; i < tasks_per_batch; i++) {
+            auto task = std::make_shared<std::packaged_task<int()>>(
+                std::bind([](unsigned int x) { return int(x); }, i));
+            futures.push_back(task->get_future());
+            pool.Post(std::function<void()>([task] { (*task)(); }));
+        }
+        for (auto& f : futures) benchmark::DoNotOptimize(f.get());
+        futures.clear();
+    });
+}
+
+static void BM_ExecuteTask(benchmark::State& state) {
+    util::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()), mode_of(state));
+    std::vector<std::future<int>> futures;
+    futures.reserve(tasks_per_batch);
+
+    measure(state, [&] {
+        for (unsigned int i = 0; i < tasks_per_batch; i++) {
+            futures.push_back(pool.ExecuteTask([](unsigned int x) { return int(x); }, i));
+        }
+        for (auto& f : futures) benchmark::DoNotOptimize(f.get());
+        futures.clear();
+    });
+}
+
+static void BM_Post(benchmark::State& state) {
+    util::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()), mode_of(state));
+    std::atomic<unsigned int> done{0};
+
+    measure(state, [&] {
+        done = 0;
+        for (unsigned int i = 0; i < tasks_per_batch; i++) {
+            pool.Post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (done.load() < tasks_per_batch) std::this_thread::yield();
+    });
+}
+
+BENCHMARK(BM_SubmitPackagedTask)->ArgName("stealing")->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_ExecuteTask)->ArgName("stealing")->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_Post)->ArgName("stealing")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
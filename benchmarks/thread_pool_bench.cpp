@@ -1,6 +1,9 @@
 #include <benchmark/benchmark.h>
 #include <vector>
 #include <future>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include "utilities/thread_pool.hpp"
 
 
@@ -41,10 +44,123 @@ static void BM_ThreadPool(benchmark::State& state) {
     }
 }
 
+// Busy-waits for about `duration`, i.e. a task of a fixed size.
+void spin_for(std::chrono::nanoseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+constexpr unsigned int fine_grained_tasks = 10000;
+
+// Fine-grained tasks (range(1) microseconds each) submitted from outside the
+// pool, shared queue (range(0) == 0) vs. work stealing (range(0) == 1).
+static void BM_FineGrained(benchmark::State& state) {
+    const auto mode = state.range(0) ? util::scheduling::work_stealing
+                                     : util::scheduling::shared_queue;
+    const std::chrono::microseconds task_size(state.range(1));
+    util::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()), mode);
+
+    for (auto _ : state) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(fine_grained_tasks);
+
+        for (unsigned int i = 0; i < fine_grained_tasks; i++) {
+            futures.push_back(pool.ExecuteTask([task_size] { spin_for(task_size); }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * fine_grained_tasks);
+}
+
+// Binary tree of tasks of depth range(1), every task spawning its children
+// from inside the pool; the 1us leaves do the work.
+static void BM_NestedSpawn(benchmark::State& state) {
+    const auto mode = state.range(0) ? util::scheduling::work_stealing
+                                     : util::scheduling::shared_queue;
+    const int depth = static_cast<int>(state.range(1));
+    const long leaves = 1L << depth;
+    util::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()), mode);
+
+    for (auto _ : state) {
+        std::atomic<long> remaining{leaves};
+        std::promise<void> done;
+
+        std::function<void(int)> spawn = [&](int level) {
+            if (level == 0) {
+                spin_for(std::chrono::microseconds(1));
+                if (--remaining == 0) done.set_value();
+                return;
+            }
+            pool.ExecuteTask(spawn, level - 1);
+            pool.ExecuteTask(spawn, level - 1);
+        };
+        pool.ExecuteTask(spawn, depth);
+        done.get_future().wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * (2 * leaves - 1));
+}
+
+// Wakeup latency: time from posting a task to an idle worker until the task
+// starts, for the wait strategies park (0), spin_park (1) and busy_poll (2).
+// The worker idles range(1) microseconds between tasks, so that a parking
+// worker has given up spinning and is blocked when the task arrives.
+static void BM_WakeupLatency(benchmark::State& state) {
+    util::thread_pool_options options;
+    options.threads = 1;
+    options.mode = state.range(2) ? util::scheduling::work_stealing
+                                  : util::scheduling::shared_queue;
+    options.wait = static_cast<util::wait_strategy>(state.range(0));
+    util::thread_pool pool(options);
+    const std::chrono::microseconds idle(state.range(1));
+
+    std::atomic<std::int64_t> started{0};
+    for (auto _ : state) {
+        std::this_thread::sleep_for(idle);
+        started.store(0, std::memory_order_relaxed);
+
+        const auto posted = std::chrono::steady_clock::now();
+        pool.Post([&started] {
+            started.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                          std::memory_order_release);
+        });
+        std::int64_t at;
+        while ((at = started.load(std::memory_order_acquire)) == 0) {
+            std::this_thread::yield();
+        }
+
+        const auto start = std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(at));
+        state.SetIterationTime(std::chrono::duration<double>(start - posted).count());
+    }
+}
+
+BENCHMARK(BM_WakeupLatency)
+    ->ArgNames({"wait", "idle_us", "stealing"})
+    ->ArgsProduct({{0, 1, 2}, {1000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseManualTime();
+
+BENCHMARK(BM_FineGrained)
+    ->ArgNames({"stealing", "task_us"})
+    ->ArgsProduct({{0, 1}, {1, 10}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_NestedSpawn)
+    ->ArgNames({"stealing", "depth"})
+    ->ArgsProduct({{0, 1}, {10, 14}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
 const     unsigned int total_threads   = std::max(1u, std::thread::hardware_concurrency());
 constexpr unsigned int min_num_threads = 1;
 constexpr unsigned int min_task_num    = 10*min_num_threads;
-const     unsigned int max_task_num    = 2*total_threads;
+const     unsigned int max_task_num    = std::max(2*total_threads, min_task_num + 1);
 
 BENCHMARK(BM_ThreadPool)
     ->ArgsProduct({
@@ -0,0 +1,171 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "CompactDecoder.hpp"
+#include "MarketDataServer.hpp"
+
+// Size and encode/decode cost of one update on the wire, FULL StockPrice vs.
+// the COMPACT encoding (fixed-point deltas in zigzag varints).
+//
+// The ticks are every row of the data/csv set, merged in day order like a
+// SubscribeMany stream of all the symbols, stamped 1us apart. Each update is
+// one StockPrice stream message, as sent by Subscribe.
+
+namespace {
+
+struct Tick {
+    std::uint32_t symbol_id;
+    StockData row;
+    std::int64_t timestamp_ns;
+};
+
+struct Stream {
+    std::vector<std::string> symbols;
+    std::vector<Tick> ticks;
+};
+
+const Stream &stream() {
+    static const Stream *instance = [] {
+        MarketDataServiceImpl service;
+        for (const auto &entry : std::filesystem::directory_iterator(CSV_DATA_DIR)) {
+            if (entry.path().extension() == ".csv") service.load_data(entry.path().string());
+        }
+
+        auto *s = new Stream();
+        const StockStore &store = service.getStockData();
+        std::vector<StockSeries> series;
+        for (SymbolTable::Id id = 0; id < store.size(); ++id) {
+            s->symbols.push_back(store.symbol(id));
+            series.push_back(store.series(id));
+        }
+
+        std::int64_t timestamp = 1'600'000'000'000'000'000;
+        for (SeriesMerge merge(std::move(series)); !merge.done(); merge.next()) {
+            timestamp += 1000;
+            s->ticks.push_back({static_cast<std::uint32_t>(merge.source()), merge.row(), timestamp});
+        }
+        return s;
+    }();
+    return *instance;
+}
+
+void encode_full(const Stream &s, const Tick &tick, marketdata::StockPrice &price) {
+    const StockData &row = tick.row;
+    price.set_symbol(s.symbols[tick.symbol_id]);
+    price.set_adjustedclose(row.adj_close());
+    price.set_close(row.close());
+    price.set_high(row.high());
+    price.set_low(row.low());
+    price.set_open(row.open());
+    price.set_volume(row.volume());
+    price.set_epoch_day(row.epoch_day());
+    price.set_timestamp_ns(tick.timestamp_ns);
+}
+
+std::vector<std::string> serialize_all(bool compact) {
+    const Stream &s = stream();
+    CompactEncoder encoder(s.symbols.size());
+    std::vector<std::string> messages;
+    for (const Tick &tick : s.ticks) {
+        marketdata::StockPrice price;
+        if (compact) {
+            encoder.encode(tick.symbol_id, tick.row, tick.timestamp_ns, *price.mutable_compact());
+        } else {
+            encode_full(s, tick, price);
+        }
+        messages.push_back(price.SerializeAsString());
+    }
+    return messages;
+}
+
+void report(benchmark::State &state, std::size_t bytes) {
+    const std::size_t ticks = stream().ticks.size();
+    state.counters["bytes_per_tick"] = double(bytes) / double(ticks);
+    state.counters["ns_per_tick"] = benchmark::Counter(
+        double(ticks), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.SetItemsProcessed(state.iterations() * ticks);
+}
+
+}  // namespace
+
+// Builds and serializes every update (the message object is reused).
+static void BM_EncodeFull(benchmark::State &state) {
+    const Stream &s = stream();
+    marketdata::StockPrice price;
+    std::string wire;
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        bytes = 0;
+        for (const Tick &tick : s.ticks) {
+            encode_full(s, tick, price);
+            price.SerializeToString(&wire);
+            bytes += wire.size();
+        }
+        benchmark::DoNotOptimize(wire);
+    }
+    report(state, bytes);
+}
+
+static void BM_EncodeCompact(benchmark::State &state) {
+    const Stream &s = stream();
+    marketdata::StockPrice price;
+    std::string wire;
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        CompactEncoder encoder(s.symbols.size());
+        bytes = 0;
+        for (const Tick &tick : s.ticks) {
+            encoder.encode(tick.symbol_id, tick.row, tick.timestamp_ns, *price.mutable_compact());
+            price.SerializeToString(&wire);
+            bytes += wire.size();
+        }
+        benchmark::DoNotOptimize(wire);
+    }
+    report(state, bytes);
+}
+
+// Parses every update back into a full StockPrice.
+static void BM_DecodeFull(benchmark::State &state) {
+    static const std::vector<std::string> messages = serialize_all(false);
+    marketdata::StockPrice price;
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        bytes = 0;
+        for (const std::string &wire : messages) {
+            price.ParseFromString(wire);
+            bytes += wire.size();
+        }
+        benchmark::DoNotOptimize(price);
+    }
+    report(state, bytes);
+}
+
+static void BM_DecodeCompact(benchmark::State &state) {
+    static const std::vector<std::string> messages = serialize_all(true);
+    marketdata::StockPrice wire_price;
+    marketdata::StockPrice price;
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        CompactDecoder decoder(stream().symbols);
+        bytes = 0;
+        for (const std::string &wire : messages) {
+            wire_price.ParseFromString(wire);
+            decoder.decode(wire_price.compact(), price);
+            bytes += wire.size();
+        }
+        benchmark::DoNotOptimize(price);
+    }
+    report(state, bytes);
+}
+
+BENCHMARK(BM_EncodeFull)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EncodeCompact)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeFull)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeCompact)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,17 +1,102 @@
-#include "MarketDataClient.hpp"
+#include "PipelinedClient.hpp"
+#include "SharedMemoryClient.hpp"
 #include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <vector>
-#include "utilities/thread_pool.hpp"
+#include "utilities/logger.hpp"
+#include "utilities/thread_affinity.hpp"
 
+namespace {
+
+// Logs one update in `print_every` per handler thread.
+class PrintingConsumer : public PriceConsumer
+{
+    public:
+        explicit PrintingConsumer(unsigned print_every) : m_print_every(print_every) {}
+
+        void on_ticks(const std::string& symbol, std::span<const Tick> ticks) override {
+            const std::int64_t now = wall_clock_now_ns();
+            for (const Tick& tick : ticks) {
+                UTIL_LOG_EVERY_N(info, m_print_every,
+                                 "[App][{}] Received adj price: {}, Close: {}, High: {}, Low: {}, "
+                                 "Open: {}, Volume: {},  @ {}, latency: {} us",
+                                 symbol, tick.adj_close, tick.close, tick.high, tick.low,
+                                 tick.open, tick.volume, tick.timestamp_ns,
+                                 (now - tick.timestamp_ns) / 1000);
+            }
+        }
+
+    private:
+        unsigned m_print_every;
+};
+
+}  // namespace
+
+// Usage: marketdata_app PORT [--per-symbol] [--handlers=N] [--pin=CORES] [--shm]
+//                            [--latency-interval=SECONDS]
+//                            [--latency-format=text|json] [--log-level=LEVEL]
+//                            [--print-every=N]
+//   --per-symbol         : one Subscribe stream and I/O thread per symbol instead
+//                          of a single SubscribeMany stream for all of them
+//   --handlers=N         : threads processing the updates (default 1); the I/O
+//                          threads only read and queue them
+//   --pin=CORES          : pin the handler threads to these cores, e.g. 2,3 or 2-5
+//   --shm                : read the server's shared-memory feed (same host, server
+//                          started with --shm) on the main thread instead of streams
+//   --latency-interval=S : print the latency histograms of all the clients,
+//                          merged, every S seconds (default 5, 0: only at the end)
+//   --latency-format=... : text (default) or json, one object per report line
+//   --log-level=L        : trace, debug, info (default), warn, error or off
+//   --print-every=N      : print one received update in N per stream (default 1)
 int main(int argc, char** argv) {
     std::string  port;
+    PipelineOptions options;
+    bool shared_memory = false;
+    unsigned print_every = 1;
+    std::chrono::seconds latency_interval(5);
+    LatencyStats::Format latency_format = LatencyStats::Format::Text;
     if (argc > 1) {
         port = "localhost:" + std::string(argv[1]);
     } else {
         std::cerr << "[App] Unspecified server portal, for example 50051." << std::endl;
     }
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--per-symbol") {
+            options.stream_per_symbol = true;
+        } else if (arg.rfind("--handlers=", 0) == 0) {
+            options.handler_threads = static_cast<unsigned>(std::stoul(arg.substr(11)));
+        } else if (arg.rfind("--pin=", 0) == 0) {
+            if (!util::parse_core_list(arg.substr(6), options.cores)) {
+                std::cerr << "[App] Invalid core list: " << arg.substr(6) << std::endl;
+                return 1;
+            }
+        } else if (arg == "--shm") {
+            shared_memory = true;
+        } else if (arg.rfind("--latency-interval=", 0) == 0) {
+            latency_interval = std::chrono::seconds(std::stoul(arg.substr(19)));
+        } else if (arg == "--latency-format=json") {
+            latency_format = LatencyStats::Format::Json;
+        } else if (arg == "--latency-format=text") {
+            latency_format = LatencyStats::Format::Text;
+        } else if (arg.rfind("--log-level=", 0) == 0) {
+            util::log_level level;
+            if (!util::parse_log_level(arg.substr(12), level)) {
+                std::cerr << "[App] Unknown log level: " << arg.substr(12) << std::endl;
+                return 1;
+            }
+            util::default_logger().set_level(level);
+        } else if (arg.rfind("--print-every=", 0) == 0) {
+            print_every = static_cast<unsigned>(std::stoul(arg.substr(14)));
+        } else {
+            std::cerr << "[App] Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
 
     std::cout << "[App] Connecting to " << port << std::endl;
 
@@ -32,37 +117,78 @@ int main(int argc, char** argv) {
         "TSLA"
     };
 
-    util::thread_pool thread_pool(stocks.size());
+    PrintingConsumer consumer(print_every);
+    PipelinedClient client(channel, stocks, consumer, options);
+    SharedMemoryClient shm_client(channel, stocks, consumer);
 
-     std::vector<std::future<void>> futures;
+    // The histograms of all the streams, merged into one report. The queued
+    // log lines go out first so that the report is not interleaved with them.
+    auto report_latency = [&](const char* title) {
+        util::default_logger().flush();
+        LatencyStats merged;
+        if (shared_memory) {
+            merged.merge(shm_client.latency());
+        } else {
+            client.mergeLatency(merged);
+        }
+        const std::string report = merged.report(latency_format);
+        if (latency_format == LatencyStats::Format::Json) {
+            std::cout << report << std::endl;
+        } else {
+            std::cout << "[App] " << title << " latency (us):\n" << report << std::flush;
+        }
+    };
 
-    for (const auto& stock : stocks) {
-        auto fut = thread_pool.ExecuteTask([&, stock]() {
-            auto client_or = MarketDataClient::createClient(channel);
-            if (!client_or.ok()) {
-                std::cerr << "[App] Failed to create client for " << stock
-                          << ": " << client_or.status() << std::endl;
-                return;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::thread reporter;
+    if (latency_interval.count() > 0) {
+        reporter = std::thread([&] {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            while (!done_cv.wait_for(lock, latency_interval, [&] { return done; })) {
+                report_latency("Current");
             }
+        });
+    }
 
-            MarketDataClient client = *std::move(client_or);
+    grpc::Status status;
+    if (shared_memory) {
+        UTIL_LOG(info, "[App] Subscribing to {} symbols over shared memory", stocks.size());
+        status = shm_client.run();
+    } else {
+        UTIL_LOG(info, "[App] Subscribing to {} symbols, {} handler thread(s)", stocks.size(),
+                 options.handler_threads);
+        status = client.run();
+    }
+    if (!status.ok()) {
+        UTIL_LOG(error, "[App] Subscription failed: {}", status.error_message());
+    }
 
-            if (!client.isConnected()) {
-                std::cerr << "[App] Client not connected for " << stock << std::endl;
-                return;
-            }
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        done = true;
+    }
+    done_cv.notify_all();
+    if (reporter.joinable()) reporter.join();
 
-            std::cout << "[App] Subscribing to " << stock << std::endl;
-            client.subscribeToSymbol(stock);
-        });
+    report_latency("Final");
 
-        futures.push_back(std::move(fut));
+    if (shared_memory) {
+        std::cout << "[App] Shared memory: " << shm_client.received() << " ticks received, "
+                  << shm_client.lost() << " lost to overruns" << std::endl;
+        return status.ok() ? 0 : 1;
     }
 
-    // Wait for all tasks to finish
-    for (auto& f : futures) {
-        f.get();  // blocks until that task completes
+    // Backpressure: a consumer slower than the streams shows up as stalls
+    // and a deep queue.
+    std::cout << "[App] Pipeline (symbol received handled batches stalls stall_ms max_depth "
+                 "queue_p50_us queue_p99_us):\n";
+    for (const auto& s : client.stats()) {
+        std::cout << "  " << s.symbol << ' ' << s.received << ' ' << s.handled << ' '
+                  << s.batches << ' ' << s.stalls << ' ' << s.stall_ns / 1000000 << ' '
+                  << s.max_depth << ' ' << s.queue_p50_us << ' ' << s.queue_p99_us << '\n';
     }
-
-    return 0;
-}
\ No newline at end of file
+    std::cout << std::flush;
+    return status.ok() ? 0 : 1;
+}
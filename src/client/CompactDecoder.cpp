@@ -0,0 +1,47 @@
+#include "CompactDecoder.hpp"
+#include <algorithm>
+
+CompactDecoder::CompactDecoder(const std::vector<std::string>& symbols)
+{
+    for (const auto& symbol : symbols) {
+        if (std::find(m_symbols.begin(), m_symbols.end(), symbol) == m_symbols.end()) {
+            m_symbols.push_back(symbol);
+        }
+    }
+    m_previous.resize(m_symbols.size());
+}
+
+bool CompactDecoder::decode(const marketdata::CompactPrice& in, marketdata::StockPrice& out)
+{
+    if (in.symbol_id() >= m_symbols.size()) {
+        return false;
+    }
+
+    Previous& previous = m_previous[in.symbol_id()];
+    previous.adj_close += in.adjusted_close();
+    previous.close += in.close();
+    previous.high += in.high();
+    previous.low += in.low();
+    previous.open += in.open();
+    previous.volume += in.volume();
+    previous.epoch_day += in.epoch_day();
+    m_timestamp_ns += in.timestamp_ns();
+    previous.seq += in.seq();
+
+    out.set_symbol(m_symbols[in.symbol_id()]);
+    out.set_adjustedclose(previous.adj_close / kPriceScale);
+    out.set_close(previous.close / kPriceScale);
+    out.set_high(previous.high / kPriceScale);
+    out.set_low(previous.low / kPriceScale);
+    out.set_open(previous.open / kPriceScale);
+    out.set_volume(previous.volume);
+    out.set_epoch_day(previous.epoch_day);
+    out.set_timestamp_ns(m_timestamp_ns);
+    out.set_seq(in.seq() != 0 ? previous.seq : 0);
+    if (in.has_indicators()) {
+        *out.mutable_indicators() = in.indicators();
+    } else {
+        out.clear_indicators();
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef COMPACT_DECODER_HPP
+#define COMPACT_DECODER_HPP
+
+#include "marketdata.pb.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Client side of the COMPACT encoding (see CompactPrice in marketdata.proto):
+// rebuilds full StockPrice messages from the deltas of one subscription.
+class CompactDecoder
+{
+    public:
+        static constexpr double kPriceScale = 1e6;
+
+        // The symbols of the request, in order; repeated symbols are skipped
+        // like the server does.
+        explicit CompactDecoder(const std::vector<std::string>& symbols);
+
+        // Returns false, leaving `out` unspecified, if the symbol id is unknown.
+        bool decode(const marketdata::CompactPrice& in, marketdata::StockPrice& out);
+
+    private:
+        struct Previous {
+            std::int64_t adj_close = 0;
+            std::int64_t close = 0;
+            std::int64_t high = 0;
+            std::int64_t low = 0;
+            std::int64_t open = 0;
+            std::int64_t volume = 0;
+            std::int32_t epoch_day = 0;
+            std::uint64_t seq = 0;
+        };
+
+        std::vector<std::string> m_symbols;
+        std::vector<Previous> m_previous;  // by symbol id
+        std::int64_t m_timestamp_ns = 0;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "LatencyStats.hpp"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+std::int64_t wall_clock_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+util::latency_histogram& LatencyStats::histogram(const std::string& symbol)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& histogram = m_histograms[symbol];
+    if (!histogram) histogram = std::make_unique<util::latency_histogram>();
+    return *histogram;
+}
+
+void LatencyStats::record(util::latency_histogram& histogram,
+                          const marketdata::StockPrice& price, std::int64_t receive_ns)
+{
+    record(histogram, price.timestamp_ns(), receive_ns);
+}
+
+void LatencyStats::record(util::latency_histogram& histogram,
+                          std::int64_t timestamp_ns, std::int64_t receive_ns)
+{
+    const std::int64_t latency_ns = receive_ns - timestamp_ns;
+    histogram.record(latency_ns > 0 ? static_cast<std::uint64_t>(latency_ns) / 1000 : 0);
+}
+
+void LatencyStats::merge(const LatencyStats& other)
+{
+    if (&other == this) return;
+
+    // Copy the pointers out first: never hold both locks.
+    std::map<std::string, const util::latency_histogram*> histograms;
+    {
+        std::lock_guard<std::mutex> lock(other.m_mutex);
+        for (const auto& [symbol, histogram] : other.m_histograms) {
+            histograms.emplace(symbol, histogram.get());
+        }
+    }
+    for (const auto& [symbol, histogram] : histograms) {
+        this->histogram(symbol).merge(*histogram);
+    }
+}
+
+std::uint64_t LatencyStats::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::uint64_t total = 0;
+    for (const auto& entry : m_histograms) {
+        total += entry.second->count();
+    }
+    return total;
+}
+
+namespace {
+
+void write_summary(std::ostream& out, const std::string& name,
+                   const util::latency_histogram& histogram, LatencyStats::Format format)
+{
+    if (format == LatencyStats::Format::Json) {
+        out << "\"" << name << "\":{\"count\":" << histogram.count()
+            << ",\"mean_us\":" << histogram.mean()
+            << ",\"p50_us\":" << histogram.percentile(50)
+            << ",\"p99_us\":" << histogram.percentile(99)
+            << ",\"p999_us\":" << histogram.percentile(99.9)
+            << ",\"max_us\":" << histogram.max() << "}";
+    } else {
+        out << std::left << std::setw(8) << name << std::right
+            << " count " << std::setw(8) << histogram.count()
+            << "  mean " << std::setw(8) << histogram.mean()
+            << "  p50 " << std::setw(7) << histogram.percentile(50)
+            << "  p99 " << std::setw(7) << histogram.percentile(99)
+            << "  p99.9 " << std::setw(7) << histogram.percentile(99.9)
+            << "  max " << std::setw(7) << histogram.max() << " us\n";
+    }
+}
+
+}  // namespace
+
+std::string LatencyStats::report(Format format) const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    util::latency_histogram total;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (format == Format::Json) out << "{\"symbols\":{";
+
+    bool first = true;
+    for (const auto& [symbol, histogram] : m_histograms) {
+        if (format == Format::Json && !first) out << ",";
+        first = false;
+        write_summary(out, symbol, *histogram, format);
+        total.merge(*histogram);
+    }
+
+    if (format == Format::Json) out << "},";
+    write_summary(out, "total", total, format);
+    if (format == Format::Json) out << "}";
+    return out.str();
+}
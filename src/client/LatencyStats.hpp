@@ -0,0 +1,55 @@
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+
+#include "marketdata.pb.h"
+#include "utilities/latency_histogram.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Wall-clock time in nanoseconds since the epoch, on the clock the server
+// stamps updates with.
+std::int64_t wall_clock_now_ns();
+
+// End-to-end latency of the updates received by a client, per symbol: the
+// receive time minus the server's timestamp_ns, in microseconds. Both ends
+// read the system clock, so across hosts the numbers are only as good as
+// the clock synchronization.
+//
+// Recording is lock-free: subscriptions look the histogram of each of their
+// symbols up once, then only touch its atomics.
+class LatencyStats
+{
+    public:
+        enum class Format { Text, Json };
+
+        // Histogram of `symbol`, created on first use. The reference stays
+        // valid for the lifetime of the LatencyStats.
+        util::latency_histogram& histogram(const std::string& symbol);
+
+        // Records the latency of `price`, received at `receive_ns`. A
+        // negative latency (clock skew) counts as 0.
+        static void record(util::latency_histogram& histogram,
+                           const marketdata::StockPrice& price, std::int64_t receive_ns);
+
+        // Same, for an update stamped `timestamp_ns` by the server.
+        static void record(util::latency_histogram& histogram,
+                           std::int64_t timestamp_ns, std::int64_t receive_ns);
+
+        // Adds the histograms of `other`, symbol by symbol.
+        void merge(const LatencyStats& other);
+
+        std::uint64_t count() const;  // over all symbols
+
+        // One line (Text) or object member (Json) per symbol, with count,
+        // mean, p50/p99/p99.9 and max in microseconds, plus the totals.
+        std::string report(Format format) const;
+
+    private:
+        mutable std::mutex m_mutex;  // guards the map, not the histograms
+        std::map<std::string, std::unique_ptr<util::latency_histogram>> m_histograms;
+};
+
+#endif
@@ -1,13 +1,30 @@
 #include "MarketDataClient.hpp"
-#include <mutex>
+#include "CompactDecoder.hpp"
+#include "utilities/logger.hpp"
+#include <random>
+#include <thread>
+#include <unordered_map>
 
 // Initialize static counter
 std::atomic<int> MarketDataClient::s_nextId{1};
-static std::mutex cout_mutex;
+std::atomic<unsigned> MarketDataClient::s_printEvery{1};
+
+// Formatted on the logger's thread: the receiving thread only copies the
+// fields into its ring.
+static void print_price(int id, const std::string& symbol, const marketdata::StockPrice& price) {
+    const std::int64_t latency_us = (wall_clock_now_ns() - price.timestamp_ns()) / 1000;
+    UTIL_LOG_EVERY_N(info, MarketDataClient::printEvery(),
+                     "[Client#{}][{}] Received adj price: {}, Close: {}, High: {}, Low: {}, "
+                     "Open: {}, Volume: {},  @ {}, latency: {} us",
+                     id, symbol, price.adjustedclose(), price.close(), price.high(),
+                     price.low(), price.open(), price.volume(), price.timestamp_ns(),
+                     latency_us);
+}
 
 MarketDataClient::MarketDataClient(std::shared_ptr<grpc::Channel> channel, int id)
 : m_stub(marketdata::MarketData::NewStub(channel)),
-  m_id(id)
+  m_id(id),
+  m_latency(std::make_shared<LatencyStats>())
 {
 }
 
@@ -29,45 +46,204 @@ int MarketDataClient::getId() const {
   return m_id;
 }
 
-void MarketDataClient::subscribeToSymbol(const std::string& symbol) {
-    grpc::ClientContext context;
-    marketdata::StockRequest request;
-    request.set_symbol(symbol);
-    
-    
-    std::unique_ptr<grpc::ClientReader<marketdata::StockPrice>> reader(
-        m_stub->Subscribe(&context, request));
-        
-    marketdata::StockPrice price;
-
-    while (reader->Read(&price)) {
-      {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::ostringstream oss;
-
-        oss << "[Client#" << m_id << "][" << symbol
-            << "] Received adj price: " << price.adjustedclose() << ", "
-            << "Close: "  << price.close()   << ", "
-            << "High: "   << price.high()    << ", "
-            << "Low: "    << price.low()     << ", "
-            << "Open: "   << price.open()    << ", "
-            << "Volume: " << price.volume()  << ", "
-            << " @ "      << price.timestamp_ns();
-
-        std::cout << oss.str() << std::endl;
+LatencyStats& MarketDataClient::latency() const {
+  return *m_latency;
+}
+
+void MarketDataClient::setReconnectPolicy(const ReconnectPolicy& policy) {
+  m_reconnect = policy;
+}
+
+grpc::Status MarketDataClient::withReconnect(
+    const std::string& what, const std::function<grpc::Status(bool&)>& attempt) const {
+    std::minstd_rand random(std::random_device{}());
+    std::chrono::milliseconds backoff = m_reconnect.initial_backoff;
+    unsigned failures = 0;
+
+    while (true) {
+      bool progressed = false;
+      grpc::Status status = attempt(progressed);
+      if (status.error_code() != grpc::StatusCode::UNAVAILABLE) {
+        return status;
+      }
+      if (progressed) {
+        failures = 0;
+        backoff = m_reconnect.initial_backoff;
       }
+      if (++failures > m_reconnect.max_attempts) {
+        return status;
+      }
+
+      const auto half = backoff.count() / 2;
+      const std::chrono::milliseconds delay(
+          half + std::uniform_int_distribution<std::int64_t>(0, backoff.count() - half)(random));
+      UTIL_LOG(warn, "[Client#{}][{}] Stream broken ({}), reconnecting in {} ms (attempt {}/{})",
+               m_id, what, status.error_message(), delay.count(), failures,
+               m_reconnect.max_attempts);
+      std::this_thread::sleep_for(delay);
+      backoff = std::min(m_reconnect.max_backoff,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             backoff * m_reconnect.multiplier));
+    }
+}
+
+// Returns false for an update received already, i.e. resent by a server
+// that does not resume; updates without a sequence number are all new.
+static bool advance_seq(std::uint64_t& last_seq, const marketdata::StockPrice& price) {
+    if (price.seq() == 0) return true;
+    if (price.seq() <= last_seq) return false;
+    last_seq = price.seq();
+    return true;
+}
+
+grpc::Status MarketDataClient::subscribeToSymbol(const std::string& symbol,
+                                                 const PriceHandler& on_price,
+                                                 marketdata::Encoding encoding) {
+    util::latency_histogram& latency = m_latency->histogram(symbol);
+    std::uint64_t last_seq = 0;
+
+    return withReconnect(symbol, [&](bool& progressed) {
+      grpc::ClientContext context;
+      marketdata::StockRequest request;
+      request.set_symbol(symbol);
+      request.set_encoding(encoding);
+      request.set_start_after_seq(last_seq);
+
+      std::unique_ptr<grpc::ClientReader<marketdata::StockPrice>> reader(
+          m_stub->Subscribe(&context, request));
+
+      // The server may answer FULL whatever was asked.
+      CompactDecoder decoder({symbol});
+      marketdata::StockPrice price;
+      marketdata::StockPrice decoded;
+
+      while (reader->Read(&price)) {
+        const std::int64_t received_ns = wall_clock_now_ns();
+        const marketdata::StockPrice* update = &price;
+        if (price.has_compact()) {
+          if (!decoder.decode(price.compact(), decoded)) continue;
+          update = &decoded;
+        }
+        if (!advance_seq(last_seq, *update)) continue;
+        progressed = true;
+        LatencyStats::record(latency, *update, received_ns);
+        on_price(*update);
+      }
+
+      return reader->Finish();
+    });
+}
+
+void MarketDataClient::subscribeToSymbol(const std::string& symbol) {
+    grpc::Status status = subscribeToSymbol(symbol, [&](const marketdata::StockPrice& price) {
+      print_price(m_id, symbol, price);
+    }, marketdata::COMPACT);
+
+    if (!status.ok()) {
+      UTIL_LOG(error, "[Client#{}][{}] Subscription failed: {}", m_id, symbol,
+               status.error_message());
+    } else {
+      UTIL_LOG(info, "[Client#{}][{}] Subscription ended", m_id, symbol);
     }
+}
 
-    grpc::Status status = reader->Finish();
-    {
-      std::lock_guard<std::mutex> lock(cout_mutex);
-      if (!status.ok()) {
-        std::cerr << "[Client#" << m_id << "][" << symbol
-                  << "] Subscription failed: " << status.error_message()
-                  << std::endl;
-      } else {
-        std::cout << "[Client#" << m_id << "][" << symbol
-                  << "] Subscription ended" << std::endl;
+grpc::Status MarketDataClient::subscribeToSymbols(const std::vector<std::string>& symbols,
+                                                  const PriceHandler& on_price,
+                                                  std::uint32_t max_batch,
+                                                  marketdata::Encoding encoding) {
+    // Looked up once, so that recording takes no lock.
+    struct Progress {
+      util::latency_histogram* latency;
+      std::uint64_t last_seq = 0;
+    };
+    std::unordered_map<std::string, Progress> progress;
+    for (const auto& symbol : symbols) {
+      progress.emplace(symbol, Progress{&m_latency->histogram(symbol)});
+    }
+
+    return withReconnect(std::to_string(symbols.size()) + " symbols", [&](bool& progressed) {
+      grpc::ClientContext context;
+      marketdata::MultiStockRequest request;
+      for (const auto& symbol : symbols) {
+        request.add_symbols(symbol);
+      }
+      request.set_max_batch(max_batch);
+      request.set_encoding(encoding);
+      for (const auto& [symbol, p] : progress) {
+        if (p.last_seq != 0) (*request.mutable_start_after_seq())[symbol] = p.last_seq;
       }
+
+      std::unique_ptr<grpc::ClientReader<marketdata::StockPriceBatch>> reader(
+          m_stub->SubscribeMany(&context, request));
+
+      // Reused across reads: the parsed messages keep their allocations.
+      CompactDecoder decoder(symbols);
+      marketdata::StockPriceBatch batch;
+      marketdata::StockPrice decoded;
+
+      auto handle = [&](const marketdata::StockPrice& price, std::int64_t received_ns) {
+        auto it = progress.find(price.symbol());
+        if (it == progress.end()) return;
+        if (!advance_seq(it->second.last_seq, price)) return;
+        progressed = true;
+        LatencyStats::record(*it->second.latency, price, received_ns);
+        on_price(price);
+      };
+
+      while (reader->Read(&batch)) {
+        // Every update of the batch was stamped before the one Write.
+        const std::int64_t received_ns = wall_clock_now_ns();
+        for (const auto& price : batch.prices()) {
+          handle(price, received_ns);
+        }
+        for (const auto& compact : batch.compact_prices()) {
+          if (decoder.decode(compact, decoded)) handle(decoded, received_ns);
+        }
+      }
+
+      return reader->Finish();
+    });
+}
+
+void MarketDataClient::subscribeToSymbols(const std::vector<std::string>& symbols) {
+    grpc::Status status = subscribeToSymbols(symbols, [this](const marketdata::StockPrice& price) {
+      print_price(m_id, price.symbol(), price);
+    }, 0, marketdata::COMPACT);
+
+    if (!status.ok()) {
+      UTIL_LOG(error, "[Client#{}] Subscription to {} symbols failed: {}", m_id,
+               symbols.size(), status.error_message());
+    } else {
+      UTIL_LOG(info, "[Client#{}] Subscription to {} symbols ended", m_id, symbols.size());
+    }
+}
+
+grpc::Status MarketDataClient::queryRange(const marketdata::RangeRequest& request,
+                                          const ChunkHandler& on_chunk) {
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientReader<marketdata::RangeChunk>> reader(
+        m_stub->QueryRange(&context, request));
+
+    marketdata::RangeChunk chunk;
+    while (reader->Read(&chunk)) {
+      on_chunk(chunk);
+    }
+    return reader->Finish();
+}
+
+grpc::Status MarketDataClient::publish(const BatchSource& next, std::uint64_t* rows) {
+    grpc::ClientContext context;
+    marketdata::PublishReply reply;
+    std::unique_ptr<grpc::ClientWriter<marketdata::StockPriceBatch>> writer(
+        m_stub->Publish(&context, &reply));
+
+    marketdata::StockPriceBatch batch;
+    while (next(batch)) {
+      // A failed write means the call is over; Finish() tells why.
+      if (!writer->Write(batch)) break;
     }
+    writer->WritesDone();
+    grpc::Status status = writer->Finish();
+    if (status.ok() && rows) *rows = reply.rows();
+    return status;
 }
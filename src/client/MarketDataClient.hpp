@@ -2,10 +2,29 @@
 #define MARKET_DATA_CLIENT_HPP
 
 #include <memory>
+#include "LatencyStats.hpp"
 #include "grpcpp/grpcpp.h"
 #include "marketdata.grpc.pb.h"
 #include "absl/status/statusor.h"
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// How a subscription reconnects when its stream breaks (UNAVAILABLE: the
+// server went away or cannot be reached). It waits a delay that grows
+// exponentially from initial_backoff to max_backoff, drawn between half and
+// all of it so that clients do not reconnect in step, then resumes after
+// the last sequence number it received: nothing is received twice.
+struct ReconnectPolicy
+{
+    unsigned max_attempts = 8;  // in a row without an update; 0: never reconnect
+    std::chrono::milliseconds initial_backoff{100};
+    std::chrono::milliseconds max_backoff{5000};
+    double multiplier = 2.0;
+};
 
 class MarketDataClient
 {
@@ -15,16 +34,76 @@ class MarketDataClient
         [[nodiscard]] bool isConnected() const;
         [[nodiscard]] int  getId() const;
 
+        using PriceHandler = std::function<void(const marketdata::StockPrice&)>;
+
+        // Prints every update of `symbol` with its latency. Uses the
+        // COMPACT encoding.
         void subscribeToSymbol(const std::string& symbol);
 
+        // Hands every update of `symbol` to `on_price` on the calling thread.
+        // Under COMPACT the updates are decoded back to full StockPrice
+        // messages (prices rounded to 1e-6). The latency of every update is
+        // recorded in latency() before the handler runs. A broken stream is
+        // resumed according to the reconnect policy.
+        grpc::Status subscribeToSymbol(const std::string& symbol,
+                                       const PriceHandler& on_price,
+                                       marketdata::Encoding encoding = marketdata::FULL);
+
+        // Streams the updates of all `symbols` over a single call, merged in
+        // trading-day order, and prints them like subscribeToSymbol().
+        void subscribeToSymbols(const std::vector<std::string>& symbols);
+
+        // Same, handing every update to `on_price` on the calling thread.
+        // `max_batch` caps the updates per stream message (0: server default).
+        // A broken stream is resumed for every symbol after its last update.
+        grpc::Status subscribeToSymbols(const std::vector<std::string>& symbols,
+                                        const PriceHandler& on_price,
+                                        std::uint32_t max_batch = 0,
+                                        marketdata::Encoding encoding = marketdata::FULL);
+
+        using ChunkHandler = std::function<void(const marketdata::RangeChunk&)>;
+
+        // Fetches a date range of one symbol (see RangeRequest), handing
+        // every chunk of rows to `on_chunk` on the calling thread. The chunk
+        // is reused for the next one.
+        grpc::Status queryRange(const marketdata::RangeRequest& request,
+                                const ChunkHandler& on_chunk);
+
+        // Fills the next Publish message; returns false when there is none.
+        using BatchSource = std::function<bool(marketdata::StockPriceBatch&)>;
+
+        // Appends rows to the server's history, one message per batch that
+        // `next` fills, until it returns false or the server rejects a
+        // message. `rows` receives the number of rows appended. Not resumed
+        // on a broken stream.
+        grpc::Status publish(const BatchSource& next, std::uint64_t* rows = nullptr);
+
+        void setReconnectPolicy(const ReconnectPolicy& policy);
+
+        // Latency of the updates received by this client (and its copies).
+        LatencyStats& latency() const;
+
+        // The printing subscribe methods log one update in `n` per thread
+        // (default 1: every update).
+        static void setPrintEvery(unsigned n) { s_printEvery.store(n, std::memory_order_relaxed); }
+        static unsigned printEvery() { return s_printEvery.load(std::memory_order_relaxed); }
+
     private:
         explicit MarketDataClient(std::shared_ptr<grpc::Channel> channel, int id);
+
+        // Calls `attempt` again while it fails with UNAVAILABLE, until the
+        // policy gives up. `attempt` sets its argument if it received updates.
+        grpc::Status withReconnect(const std::string& what,
+                                   const std::function<grpc::Status(bool&)>& attempt) const;
     private:
         std::unique_ptr<marketdata::MarketData::Stub> m_stub;
         int m_id;
+        std::shared_ptr<LatencyStats> m_latency;
+        ReconnectPolicy m_reconnect;
 
         // Static atomic counter to generate unique IDs
         static std::atomic<int> s_nextId;
+        static std::atomic<unsigned> s_printEvery;
 };
 
 
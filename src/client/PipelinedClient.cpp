@@ -0,0 +1,198 @@
+#include "PipelinedClient.hpp"
+#include "utilities/thread_affinity.hpp"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+PipelinedClient::PipelinedClient(std::shared_ptr<grpc::Channel> channel,
+                                 std::vector<std::string> symbols,
+                                 PriceConsumer& consumer, PipelineOptions options)
+: m_symbols(std::move(symbols)),
+  m_consumer(consumer),
+  m_options(std::move(options))
+{
+    m_options.handler_threads = std::max(1u, m_options.handler_threads);
+    m_options.max_batch = std::max<std::size_t>(1, m_options.max_batch);
+
+    const std::size_t streams = m_options.stream_per_symbol ? m_symbols.size() : 1;
+    for (std::size_t i = 0; i < streams; ++i) {
+        auto client = MarketDataClient::createClient(channel);
+        if (client.ok()) m_clients.push_back(*std::move(client));
+    }
+
+    for (std::size_t i = 0; i < m_symbols.size(); ++i) {
+        m_rings.push_back(std::make_unique<Ring>(m_options.ring_capacity));
+    }
+    for (unsigned int i = 0; i < m_options.handler_threads; ++i) {
+        m_handlers.push_back(std::make_unique<Handler>());
+    }
+    for (std::uint32_t id = 0; id < m_symbols.size(); ++id) {
+        m_handlers[id % m_handlers.size()]->symbols.push_back(id);
+    }
+}
+
+PipelinedClient::~PipelinedClient() = default;
+
+void PipelinedClient::push(std::uint32_t symbol_id, const marketdata::StockPrice& price)
+{
+    Tick tick;
+    tick.symbol_id = symbol_id;
+    tick.epoch_day = price.epoch_day();
+    tick.adj_close = price.adjustedclose();
+    tick.close = price.close();
+    tick.high = price.high();
+    tick.low = price.low();
+    tick.open = price.open();
+    tick.volume = price.volume();
+    tick.seq = price.seq();
+    tick.timestamp_ns = price.timestamp_ns();
+    tick.received_ns = wall_clock_now_ns();
+
+    Ring& ring = *m_rings[symbol_id];
+    if (!ring.queue.try_push(Tick(tick))) {
+        // Full: wait for the handler, i.e. let flow control slow the server.
+        const auto start = std::chrono::steady_clock::now();
+        ring.queue.push(Tick(tick));
+        ring.stalls.fetch_add(1, std::memory_order_relaxed);
+        ring.stall_ns.fetch_add(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()),
+            std::memory_order_relaxed);
+    }
+    ring.received.fetch_add(1, std::memory_order_relaxed);
+
+    // Only the producer raises the maximum, so a plain load/store is enough.
+    const std::uint64_t depth = ring.queue.size();
+    if (depth > ring.max_depth.load(std::memory_order_relaxed)) {
+        ring.max_depth.store(depth, std::memory_order_relaxed);
+    }
+
+    m_handlers[symbol_id % m_handlers.size()]->wakeup.notify();
+}
+
+bool PipelinedClient::drain(Handler& handler, std::vector<Tick>& batch)
+{
+    bool drained = false;
+    for (const std::uint32_t id : handler.symbols) {
+        Ring& ring = *m_rings[id];
+        const std::size_t n = ring.queue.try_pop_bulk(batch.begin(), batch.size());
+        if (n == 0) continue;
+        drained = true;
+
+        const std::int64_t now = wall_clock_now_ns();
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::int64_t queued_ns = now - batch[i].received_ns;
+            ring.queue_delay.record(queued_ns > 0 ? static_cast<std::uint64_t>(queued_ns) / 1000 : 0);
+        }
+        m_consumer.on_ticks(m_symbols[id], std::span<const Tick>(batch.data(), n));
+        ring.handled.fetch_add(n, std::memory_order_relaxed);
+        ring.batches.fetch_add(1, std::memory_order_relaxed);
+    }
+    return drained;
+}
+
+void PipelinedClient::handle(std::size_t index)
+{
+    Handler& handler = *m_handlers[index];
+    if (!m_options.cores.empty()) {
+        util::pin_current_thread(m_options.cores[index % m_options.cores.size()]);
+    }
+    util::set_current_thread_name("md-handler-" + std::to_string(index));
+
+    std::vector<Tick> batch(m_options.max_batch);
+    auto ready = [&] {
+        if (m_streams_done.load(std::memory_order_acquire)) return true;
+        for (const std::uint32_t id : handler.symbols) {
+            if (m_rings[id]->queue.size() > 0) return true;
+        }
+        return false;
+    };
+
+    while (true) {
+        if (drain(handler, batch)) continue;
+        if (m_streams_done.load(std::memory_order_acquire)) {
+            // Every push happened before the flag: one last pass empties the rings.
+            while (drain(handler, batch)) {
+            }
+            return;
+        }
+        handler.wakeup.wait(ready);
+    }
+}
+
+grpc::Status PipelinedClient::run()
+{
+    if (m_clients.empty()) {
+        return grpc::Status(grpc::StatusCode::INTERNAL, "Invalid channel.");
+    }
+
+    m_streams_done.store(false, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < m_handlers.size(); ++i) {
+        m_handlers[i]->thread = std::thread([this, i] { handle(i); });
+    }
+
+    std::vector<grpc::Status> statuses(m_clients.size());
+    std::vector<std::thread> readers;
+    if (m_options.stream_per_symbol) {
+        for (std::uint32_t id = 0; id < m_symbols.size(); ++id) {
+            readers.emplace_back([this, id, &statuses] {
+                util::set_current_thread_name("md-io-" + std::to_string(id));
+                statuses[id] = m_clients[id].subscribeToSymbol(m_symbols[id],
+                    [this, id](const marketdata::StockPrice& price) { push(id, price); },
+                    m_options.encoding);
+            });
+        }
+    } else {
+        readers.emplace_back([this, &statuses] {
+            util::set_current_thread_name("md-io");
+            std::unordered_map<std::string, std::uint32_t> ids;
+            for (std::uint32_t id = 0; id < m_symbols.size(); ++id) ids.emplace(m_symbols[id], id);
+            statuses[0] = m_clients[0].subscribeToSymbols(m_symbols,
+                [this, &ids](const marketdata::StockPrice& price) {
+                    auto it = ids.find(price.symbol());
+                    if (it != ids.end()) push(it->second, price);
+                }, 0, m_options.encoding);
+        });
+    }
+    for (auto& reader : readers) reader.join();
+
+    m_streams_done.store(true, std::memory_order_release);
+    for (auto& handler : m_handlers) {
+        handler->wakeup.notify();
+    }
+    for (auto& handler : m_handlers) {
+        handler->thread.join();
+    }
+
+    for (const auto& status : statuses) {
+        if (!status.ok()) return status;
+    }
+    return grpc::Status::OK;
+}
+
+void PipelinedClient::mergeLatency(LatencyStats& into) const
+{
+    for (const auto& client : m_clients) {
+        into.merge(client.latency());
+    }
+}
+
+std::vector<PipelineSymbolStats> PipelinedClient::stats() const
+{
+    std::vector<PipelineSymbolStats> stats;
+    for (std::size_t id = 0; id < m_symbols.size(); ++id) {
+        const Ring& ring = *m_rings[id];
+        PipelineSymbolStats s;
+        s.symbol = m_symbols[id];
+        s.received = ring.received.load(std::memory_order_relaxed);
+        s.handled = ring.handled.load(std::memory_order_relaxed);
+        s.batches = ring.batches.load(std::memory_order_relaxed);
+        s.stalls = ring.stalls.load(std::memory_order_relaxed);
+        s.stall_ns = ring.stall_ns.load(std::memory_order_relaxed);
+        s.max_depth = ring.max_depth.load(std::memory_order_relaxed);
+        s.queue_p50_us = static_cast<double>(ring.queue_delay.percentile(50));
+        s.queue_p99_us = static_cast<double>(ring.queue_delay.percentile(99));
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
@@ -0,0 +1,124 @@
+#ifndef PIPELINED_CLIENT_HPP
+#define PIPELINED_CLIENT_HPP
+
+#include "MarketDataClient.hpp"
+#include "common/Tick.hpp"
+#include "utilities/latency_histogram.hpp"
+#include "utilities/spin_wait.hpp"
+#include "utilities/spsc_queue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Receives the updates of a PipelinedClient or a SharedMemoryClient.
+// on_ticks() runs on the handler (resp. polling) thread of the symbol; the
+// updates of a symbol always come from the same thread, in order.
+class PriceConsumer
+{
+    public:
+        virtual ~PriceConsumer() = default;
+
+        // The updates of `symbol` queued since the previous call (at most
+        // max_batch of them). The span is only valid during the call.
+        virtual void on_ticks(const std::string& symbol, std::span<const Tick> ticks) = 0;
+};
+
+struct PipelineOptions
+{
+    unsigned int handler_threads = 1;  // symbol i is handled by thread i % handler_threads
+    std::vector<unsigned int> cores;   // handler i is pinned to cores[i % size]; empty: not pinned
+    bool stream_per_symbol = false;    // one Subscribe stream (and I/O thread) per symbol
+                                       // instead of one SubscribeMany stream
+    std::size_t ring_capacity = 1024;  // queued updates per symbol
+    std::size_t max_batch = 64;        // updates per on_ticks() call
+    marketdata::Encoding encoding = marketdata::COMPACT;
+};
+
+// Backpressure counters of one symbol.
+struct PipelineSymbolStats
+{
+    std::string symbol;
+    std::uint64_t received = 0;  // pushed by the I/O thread
+    std::uint64_t handled = 0;   // passed to on_ticks()
+    std::uint64_t batches = 0;   // on_ticks() calls
+    std::uint64_t stalls = 0;    // pushes that found the ring full and waited
+    std::uint64_t stall_ns = 0;  // time the I/O thread spent waiting
+    std::uint64_t max_depth = 0; // most updates queued at once
+    double queue_p50_us = 0;     // time from the read to on_ticks()
+    double queue_p99_us = 0;
+};
+
+// Client that decouples reading the streams from processing the updates.
+//
+// I/O threads only read and decode their stream, then push each update into
+// the lock-free single-producer ring of its symbol. Handler threads, pinned
+// to cores if asked, drain the rings of their symbols in batches and hand
+// them to the consumer. A slow consumer therefore no longer delays the
+// reads: updates queue in the rings, and only when a ring is full does its
+// I/O thread wait, which in turn applies HTTP/2 flow control to the server.
+// Nothing is dropped.
+//
+// Usage:
+//   PipelinedClient client(channel, symbols, consumer, options);
+//   client.run();  // until every stream ends and every update is handled
+class PipelinedClient
+{
+    public:
+        PipelinedClient(std::shared_ptr<grpc::Channel> channel, std::vector<std::string> symbols,
+                        PriceConsumer& consumer, PipelineOptions options = {});
+        ~PipelinedClient();
+
+        PipelinedClient(const PipelinedClient&) = delete;
+        PipelinedClient& operator=(const PipelinedClient&) = delete;
+
+        // Streams every symbol and returns once all the streams ended and
+        // their updates are handled: OK, or the first failure.
+        grpc::Status run();
+
+        // Adds the end-to-end latency recorded by the I/O threads to `into`.
+        void mergeLatency(LatencyStats& into) const;
+
+        // Snapshot of the backpressure counters, per symbol. Thread-safe.
+        std::vector<PipelineSymbolStats> stats() const;
+
+    private:
+        struct Ring
+        {
+            explicit Ring(std::size_t capacity) : queue(capacity) {}
+
+            util::spsc_queue<Tick> queue;
+            alignas(util::CACHE_LINE_SIZE) std::atomic<std::uint64_t> received{0};
+            std::atomic<std::uint64_t> stalls{0};
+            std::atomic<std::uint64_t> stall_ns{0};
+            std::atomic<std::uint64_t> max_depth{0};
+            alignas(util::CACHE_LINE_SIZE) std::atomic<std::uint64_t> handled{0};
+            std::atomic<std::uint64_t> batches{0};
+            util::latency_histogram queue_delay;  // microseconds
+        };
+
+        struct Handler
+        {
+            std::vector<std::uint32_t> symbols;  // ids of the rings it drains
+            util::parking_lot wakeup;
+            std::thread thread;
+        };
+
+        void push(std::uint32_t symbol_id, const marketdata::StockPrice& price);
+        void handle(std::size_t index);
+        bool drain(Handler& handler, std::vector<Tick>& batch);
+
+        std::vector<std::string> m_symbols;
+        PriceConsumer& m_consumer;
+        PipelineOptions m_options;
+
+        std::vector<MarketDataClient> m_clients;  // one per stream
+        std::vector<std::unique_ptr<Ring>> m_rings;  // by symbol id
+        std::vector<std::unique_ptr<Handler>> m_handlers;
+        std::atomic<bool> m_streams_done{false};
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "SharedMemoryClient.hpp"
+#include "utilities/spin_wait.hpp"
+#include <algorithm>
+#include <thread>
+
+SharedMemoryClient::SharedMemoryClient(std::shared_ptr<grpc::Channel> channel,
+                                       std::vector<std::string> symbols,
+                                       PriceConsumer& consumer, SharedMemoryClientOptions options)
+: m_stub(channel ? marketdata::MarketData::NewStub(channel) : nullptr),
+  m_symbols(std::move(symbols)),
+  m_consumer(consumer),
+  m_options(options)
+{
+    m_options.max_batch = std::max<std::size_t>(1, m_options.max_batch);
+}
+
+std::size_t SharedMemoryClient::poll(std::uint32_t id, Symbol& symbol, std::vector<Tick>& batch)
+{
+    std::size_t n = 0;
+    while (n < batch.size() && symbol.reader.next(batch[n])) ++n;
+    if (n == 0) return 0;
+
+    const std::int64_t now = wall_clock_now_ns();
+    for (std::size_t i = 0; i < n; ++i) {
+        batch[i].symbol_id = id;
+        batch[i].received_ns = now;
+        LatencyStats::record(*symbol.latency, batch[i].timestamp_ns, now);
+    }
+    m_consumer.on_ticks(m_symbols[id], std::span<const Tick>(batch.data(), n));
+    m_received.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+grpc::Status SharedMemoryClient::run()
+{
+    if (!m_stub) {
+        return grpc::Status(grpc::StatusCode::INTERNAL, "Invalid channel.");
+    }
+
+    marketdata::SharedMemoryRequest request;
+    for (const auto& symbol : m_symbols) request.add_symbols(symbol);
+    marketdata::SharedMemoryReply reply;
+    grpc::ClientContext context;
+    grpc::Status status = m_stub->SubscribeSharedMemory(&context, request, &reply);
+    if (!status.ok()) return status;
+    if (reply.rings_size() != static_cast<int>(m_symbols.size()) ||
+        reply.positions_size() != reply.rings_size()) {
+        return grpc::Status(grpc::StatusCode::INTERNAL, "Malformed SubscribeSharedMemory reply");
+    }
+
+    // The server is on this host only if its segment is.
+    std::string error;
+    if (!m_memory.open(reply.segment(), error) ||
+        !SharedFeedLayout::valid(m_memory.data(), m_memory.size(), error)) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, error);
+    }
+
+    const void* base = m_memory.data();
+    std::vector<Symbol> symbols(m_symbols.size());
+    for (std::uint32_t id = 0; id < m_symbols.size(); ++id) {
+        const std::uint32_t ring = reply.rings(static_cast<int>(id));
+        if (ring >= SharedFeedLayout::header(base).max_symbols ||
+            !SharedFeedLayout::names(SharedFeedLayout::entry(base, ring), m_symbols[id])) {
+            return grpc::Status(grpc::StatusCode::INTERNAL, "No ring for " + m_symbols[id]);
+        }
+        Symbol& symbol = symbols[id];
+        symbol.start = reply.positions(static_cast<int>(id));
+        symbol.reader = SharedFeedLayout::Ring::reader(
+            SharedFeedLayout::Ring::attach(SharedFeedLayout::ring(base, ring)), symbol.start);
+        symbol.entry = &SharedFeedLayout::entry(base, ring);
+        symbol.latency = &m_latency.histogram(m_symbols[id]);
+    }
+
+    std::vector<Tick> batch(m_options.max_batch);
+    std::size_t remaining = symbols.size();
+    const unsigned int spins = util::spinning_pays_off() ? util::DEFAULT_SPIN_BUDGET
+                                                         : util::SINGLE_CORE_YIELDS;
+    unsigned int idle = 0;
+    while (remaining > 0 && !m_stop.load(std::memory_order_relaxed)) {
+        bool progress = false;
+        for (std::uint32_t id = 0; id < symbols.size(); ++id) {
+            Symbol& symbol = symbols[id];
+            if (symbol.done) continue;
+            if (poll(id, symbol, batch) > 0) progress = true;
+
+            // The end of the replay is published after its last tick. An
+            // end at or before our start is that of an earlier replay.
+            const std::uint64_t end = symbol.entry->end.load(std::memory_order_acquire);
+            if (end > symbol.start && symbol.reader.position() >= end) {
+                symbol.done = true;
+                --remaining;
+            }
+        }
+
+        std::uint64_t lost = 0;
+        for (const Symbol& symbol : symbols) lost += symbol.reader.lost();
+        m_lost.store(lost, std::memory_order_relaxed);
+
+        if (progress) {
+            idle = 0;
+        } else if (++idle < spins) {
+            if (util::spinning_pays_off()) {
+                util::cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        } else if (m_options.idle_sleep.count() > 0) {
+            std::this_thread::sleep_for(m_options.idle_sleep);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (remaining > 0) return grpc::Status(grpc::StatusCode::CANCELLED, "Stopped");
+    return grpc::Status::OK;
+}
+
+void SharedMemoryClient::stop()
+{
+    m_stop.store(true, std::memory_order_relaxed);
+}
+
+std::uint64_t SharedMemoryClient::received() const
+{
+    return m_received.load(std::memory_order_relaxed);
+}
+
+std::uint64_t SharedMemoryClient::lost() const
+{
+    return m_lost.load(std::memory_order_relaxed);
+}
+
+const LatencyStats& SharedMemoryClient::latency() const
+{
+    return m_latency;
+}
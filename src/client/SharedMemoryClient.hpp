@@ -0,0 +1,86 @@
+#ifndef SHARED_MEMORY_CLIENT_HPP
+#define SHARED_MEMORY_CLIENT_HPP
+
+#include "PipelinedClient.hpp"
+#include "common/SharedFeedLayout.hpp"
+#include "utilities/shared_memory.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SharedMemoryClientOptions
+{
+    std::size_t max_batch = 64;  // updates per on_ticks() call
+    // Nap between polls once every ring stayed empty for a while; 0 keeps
+    // polling (lowest latency, one core busy).
+    std::chrono::microseconds idle_sleep{50};
+};
+
+// Same-host subscriber over the server's shared-memory feed (see
+// SharedMemoryFeed and SharedFeedLayout).
+//
+// The subscription is set up through the MarketData service
+// (SubscribeSharedMemory), which tells the client where its symbols' rings
+// and first ticks are. The client then maps the segment read-only and polls
+// the rings on the calling thread: there is no socket, no protobuf, and
+// reading a tick is an 80-byte copy. The server never waits for a reader,
+// so a consumer slower than the replay for a whole ring loses ticks; they
+// are counted in lost().
+//
+// Usage:
+//   SharedMemoryClient client(channel, symbols, consumer);
+//   client.run();  // until the replay of every symbol ended
+class SharedMemoryClient
+{
+    public:
+        SharedMemoryClient(std::shared_ptr<grpc::Channel> channel, std::vector<std::string> symbols,
+                           PriceConsumer& consumer, SharedMemoryClientOptions options = {});
+
+        SharedMemoryClient(const SharedMemoryClient&) = delete;
+        SharedMemoryClient& operator=(const SharedMemoryClient&) = delete;
+
+        // Subscribes, then hands the ticks of every symbol to the consumer
+        // until the replays it joined ended (OK) or stop() is called
+        // (CANCELLED). Fails if the server has no shared-memory feed or is
+        // on another host.
+        grpc::Status run();
+
+        // Makes run() return. Thread-safe.
+        void stop();
+
+        std::uint64_t received() const;
+        std::uint64_t lost() const;  // overwritten before they were read
+
+        // End-to-end latency of the ticks, per symbol.
+        const LatencyStats& latency() const;
+
+    private:
+        struct Symbol
+        {
+            SharedFeedLayout::Ring::reader reader;
+            const SharedFeedLayout::Entry* entry = nullptr;
+            std::uint64_t start = 0;  // position of the first tick of the subscription
+            util::latency_histogram* latency = nullptr;
+            bool done = false;
+        };
+
+        // Hands the ticks available in `symbol`'s ring to the consumer, at
+        // most one batch. Returns the number of ticks.
+        std::size_t poll(std::uint32_t id, Symbol& symbol, std::vector<Tick>& batch);
+
+        std::unique_ptr<marketdata::MarketData::Stub> m_stub;
+        std::vector<std::string> m_symbols;
+        PriceConsumer& m_consumer;
+        SharedMemoryClientOptions m_options;
+
+        util::shared_memory m_memory;
+        LatencyStats m_latency;
+        std::atomic<bool> m_stop{false};
+        std::atomic<std::uint64_t> m_received{0};
+        std::atomic<std::uint64_t> m_lost{0};
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SHARED_FEED_LAYOUT_HPP
+#define SHARED_FEED_LAYOUT_HPP
+
+#include "common/Tick.hpp"
+#include "utilities/seqlock_ring.hpp"
+#include "utilities/spin_wait.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Layout of the shared-memory segment written by a SharedMemoryFeed (server)
+// and read by SharedMemoryClients on the same host:
+//
+//   Header | Entry[max_symbols] | Ring 0 | Ring 1 | ... | Ring max_symbols-1
+//
+// Ring i is the util::seqlock_ring of Ticks of the symbol named by entry i.
+// The server formats the whole segment before serving any subscription, and
+// assigns an entry to a symbol before handing its index out, so readers only
+// ever see entries and rings that are set up.
+struct SharedFeedLayout
+{
+    using Ring = util::seqlock_ring<Tick>;
+
+    static constexpr std::uint64_t kMagic = 0x4445454648534d4d;  // "MMSHFEED"
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kMaxSymbolLength = 23;
+
+    struct alignas(util::CACHE_LINE_SIZE) Header
+    {
+        std::uint64_t magic = 0;
+        std::uint32_t version = 0;
+        std::uint32_t max_symbols = 0;
+        std::uint64_t ring_bytes = 0;
+        std::int64_t writer_pid = 0;  // of the server process, set first
+    };
+
+    struct alignas(util::CACHE_LINE_SIZE) Entry
+    {
+        char symbol[kMaxSymbolLength + 1] = {};  // truncated, NUL-terminated
+        // Position after the last tick of the latest replay that ended: a
+        // reader that joined that replay is done once it has read up to it.
+        std::atomic<std::uint64_t> end{0};
+    };
+
+    static std::size_t bytes(std::uint32_t max_symbols, std::size_t ring_capacity)
+    {
+        return sizeof(Header) + max_symbols * (sizeof(Entry) + Ring::bytes(ring_capacity));
+    }
+
+    static const Header &header(const void *base) { return *static_cast<const Header *>(base); }
+
+    static Entry &entry(void *base, std::uint32_t index)
+    {
+        return reinterpret_cast<Entry *>(static_cast<Header *>(base) + 1)[index];
+    }
+
+    static const Entry &entry(const void *base, std::uint32_t index)
+    {
+        return reinterpret_cast<const Entry *>(static_cast<const Header *>(base) + 1)[index];
+    }
+
+    static const void *ring(const void *base, std::uint32_t index)
+    {
+        const Header &h = header(base);
+        return static_cast<const char *>(base) + sizeof(Header) + h.max_symbols * sizeof(Entry) +
+               index * h.ring_bytes;
+    }
+
+    static void *ring(void *base, std::uint32_t index)
+    {
+        return const_cast<void *>(ring(static_cast<const void *>(base), index));
+    }
+
+    // Checks the header of a mapped segment of `size` bytes. Returns false
+    // with `error` set if it is not a segment of this version.
+    static bool valid(const void *base, std::size_t size, std::string &error)
+    {
+        if (size < sizeof(Header)) {
+            error = "segment too small";
+            return false;
+        }
+        const Header &h = header(base);
+        if (h.magic != kMagic || h.version != kVersion) {
+            error = "not a market data segment of version " + std::to_string(kVersion);
+            return false;
+        }
+        if (sizeof(Header) + h.max_symbols * (sizeof(Entry) + h.ring_bytes) > size) {
+            error = "segment truncated";
+            return false;
+        }
+        return true;
+    }
+
+    // True if `entry` names `symbol` (as truncated when stored).
+    static bool names(const Entry &entry, const std::string &symbol)
+    {
+        return std::strncmp(entry.symbol, symbol.c_str(), kMaxSymbolLength) == 0;
+    }
+};
+
+#endif
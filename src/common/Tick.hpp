@@ -0,0 +1,28 @@
+#ifndef TICK_HPP
+#define TICK_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+// One update as handed to a PriceConsumer: the fields of a StockPrice in a
+// flat struct, so that queuing it copies 80 bytes and never allocates.
+// It is also the record of the shared-memory transport (SharedFeedLayout),
+// hence shared by the client and the server.
+struct Tick
+{
+    std::uint32_t symbol_id = 0;  // index in the subscribed symbols
+    std::int32_t epoch_day = 0;
+    double adj_close = 0;
+    double close = 0;
+    double high = 0;
+    double low = 0;
+    double open = 0;
+    std::int64_t volume = 0;
+    std::uint64_t seq = 0;
+    std::int64_t timestamp_ns = 0;  // stamped by the server
+    std::int64_t received_ns = 0;   // read by the client
+};
+
+static_assert(std::is_trivially_copyable_v<Tick> && sizeof(Tick) == 80);
+
+#endif
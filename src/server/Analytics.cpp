@@ -0,0 +1,207 @@
+#include "Analytics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+bool indicator_windows(const marketdata::IndicatorRequest &request, IndicatorWindows &windows,
+                       std::string &error) {
+  windows.sma = request.sma_window();
+  windows.ema = request.ema_window();
+  windows.vwap = request.vwap_window();
+  windows.log_return = request.log_return();
+  windows.volatility = request.volatility_window();
+  if (std::max({windows.sma, windows.ema, windows.vwap, windows.volatility}) >
+      IndicatorWindows::kMaxWindow) {
+    error = "Indicator windows are limited to " + std::to_string(IndicatorWindows::kMaxWindow) +
+            " rows";
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+// prefix[i] = x[0] + ... + x[i - 1], prefix[0] = 0.
+template <class T>
+std::vector<double> prefix_sums(std::span<const T> x) {
+  std::vector<double> prefix(x.size() + 1);
+  double sum = 0;
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    sum += static_cast<double>(x[i]);
+    prefix[i + 1] = sum;
+  }
+  return prefix;
+}
+
+// out[i] = sum of the `window` values ending at i (fewer at the start).
+void window_sums(const std::vector<double> &prefix, std::uint32_t window, std::span<double> out) {
+  const std::size_t n = out.size();
+  const std::size_t warmup = std::min<std::size_t>(window, n);
+  const double *p = prefix.data();
+  double *o = out.data();
+  for (std::size_t i = 0; i < warmup; ++i) o[i] = p[i + 1];
+  for (std::size_t i = warmup; i < n; ++i) o[i] = p[i + 1] - p[i + 1 - window];
+}
+
+// Number of values in the window ending at i.
+double window_count(std::size_t i, std::uint32_t window) {
+  return static_cast<double>(std::min<std::size_t>(i + 1, window));
+}
+
+}  // namespace
+
+void rolling_mean(std::span<const double> x, std::uint32_t window, std::span<double> out) {
+  window = std::max<std::uint32_t>(window, 1);
+  window_sums(prefix_sums(x), window, out);
+
+  const std::size_t n = out.size();
+  const std::size_t warmup = std::min<std::size_t>(window, n);
+  const double scale = 1.0 / window;
+  double *o = out.data();
+  for (std::size_t i = 0; i < warmup; ++i) o[i] /= window_count(i, window);
+  for (std::size_t i = warmup; i < n; ++i) o[i] *= scale;
+}
+
+void exponential_moving_average(std::span<const double> x, std::uint32_t window,
+                                std::span<double> out) {
+  if (x.empty()) return;
+  const double alpha = 2.0 / (std::max<std::uint32_t>(window, 1) + 1.0);
+  double ema = x[0];
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    ema += alpha * (x[i] - ema);
+    out[i] = ema;
+  }
+}
+
+void rolling_vwap(std::span<const double> price, std::span<const std::int64_t> volume,
+                  std::uint32_t window, std::span<double> out) {
+  window = std::max<std::uint32_t>(window, 1);
+  const std::size_t n = price.size();
+
+  std::vector<double> notional(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    notional[i] = price[i] * static_cast<double>(volume[i]);
+  }
+  std::vector<double> volumes(n);
+  window_sums(prefix_sums(volume), window, volumes);
+  window_sums(prefix_sums(std::span<const double>(notional)), window, out);
+
+  // A window without volume falls back to the price.
+  double *o = out.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    o[i] = volumes[i] > 0 ? o[i] / volumes[i] : price[i];
+  }
+}
+
+void log_returns(std::span<const double> price, std::span<double> out) {
+  if (price.empty()) return;
+  const double *p = price.data();
+  double *o = out.data();
+  o[0] = 1;
+  for (std::size_t i = 1; i < price.size(); ++i) o[i] = p[i] / p[i - 1];
+  for (std::size_t i = 0; i < price.size(); ++i) o[i] = std::log(o[i]);
+}
+
+void rolling_stddev(std::span<const double> x, std::uint32_t window, std::span<double> out) {
+  window = std::max<std::uint32_t>(window, 1);
+  const std::size_t n = x.size();
+
+  std::vector<double> squares(n);
+  for (std::size_t i = 0; i < n; ++i) squares[i] = x[i] * x[i];
+  std::vector<double> sums(n);
+  window_sums(prefix_sums(x), window, sums);
+  window_sums(prefix_sums(std::span<const double>(squares)), window, out);
+
+  double *o = out.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    const double count = window_count(i, window);
+    // Rounding can make the difference slightly negative.
+    const double variance = (o[i] - sums[i] * sums[i] / count) / std::max(count - 1, 1.0);
+    o[i] = count < 2 ? 0 : std::sqrt(std::max(variance, 0.0));
+  }
+}
+
+std::vector<double> compute_indicator(const PriceColumnsView &columns, Indicator indicator,
+                                      std::uint32_t window) {
+  const std::size_t n = columns.size();
+  std::vector<double> out(n);
+  switch (indicator) {
+    case Indicator::Sma:
+      rolling_mean(columns.close, window, out);
+      break;
+    case Indicator::Ema:
+      exponential_moving_average(columns.close, window, out);
+      break;
+    case Indicator::Vwap:
+      rolling_vwap(columns.close, columns.volume, window, out);
+      break;
+    case Indicator::LogReturn:
+      log_returns(columns.close, out);
+      break;
+    case Indicator::Volatility: {
+      if (n == 0) break;
+      std::vector<double> returns(n);
+      log_returns(columns.close, returns);
+      // The first row has no return.
+      rolling_stddev(std::span<const double>(returns).subspan(1), window,
+                     std::span<double>(out).subspan(1));
+      out[0] = 0;
+      break;
+    }
+  }
+  return out;
+}
+
+void IndicatorSet::fill(std::size_t i, marketdata::Indicators &out) const {
+  if (sma) out.set_sma((*sma)[i]);
+  if (ema) out.set_ema((*ema)[i]);
+  if (vwap) out.set_vwap((*vwap)[i]);
+  if (log_return) out.set_log_return((*log_return)[i]);
+  if (volatility) out.set_volatility((*volatility)[i]);
+}
+
+std::size_t IndicatorCache::KeyHash::operator()(const Key &key) const {
+  std::size_t h = std::hash<const void *>()(key.rows);
+  h = h * 31 + key.size;
+  h = h * 31 + static_cast<std::size_t>(key.indicator);
+  return h * 31 + key.window;
+}
+
+IndicatorSet IndicatorCache::get(const StockSeries &series, const IndicatorWindows &windows) {
+  IndicatorSet set;
+  if (series.empty()) return set;
+
+  if (windows.sma) set.sma = column(series, Indicator::Sma, windows.sma);
+  if (windows.ema) set.ema = column(series, Indicator::Ema, windows.ema);
+  if (windows.vwap) set.vwap = column(series, Indicator::Vwap, windows.vwap);
+  if (windows.log_return) set.log_return = column(series, Indicator::LogReturn, 0);
+  if (windows.volatility) {
+    set.volatility = column(series, Indicator::Volatility, windows.volatility);
+  }
+  return set;
+}
+
+IndicatorSet::Column IndicatorCache::column(const StockSeries &series, Indicator indicator,
+                                            std::uint32_t window) {
+  const Key key{series.columns().date.data(), series.size(), indicator, window};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_columns.find(key);
+    if (it != m_columns.end()) return it->second.column;
+  }
+
+  // Computed outside the lock: a long series takes a while. Streams asking
+  // for the same new column at once may each compute it; the first stored
+  // is the one kept.
+  auto column = std::make_shared<const std::vector<double>>(
+      compute_indicator(series.columns(), indicator, window));
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_columns.find(key);
+  if (it != m_columns.end()) return it->second.column;
+
+  // The streams keep the columns they hold; new ones are computed again.
+  if (m_columns.size() >= m_max_columns) m_columns.clear();
+  m_columns.emplace(key, Entry{series, column});
+  return column;
+}
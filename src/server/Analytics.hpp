@@ -0,0 +1,113 @@
+#ifndef ANALYTICS_HPP
+#define ANALYTICS_HPP
+
+#include "marketdata.pb.h"
+#include "StockStore.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Rolling indicators of a symbol, computed once per series on the server and
+// streamed with its updates (see IndicatorRequest in marketdata.proto).
+//
+// The kernels run over whole columns. Rolling sums are taken as differences
+// of prefix sums, so apart from the prefix scan and the EMA recurrence every
+// pass is element-wise over contiguous arrays, without loop-carried
+// dependencies, which the compiler vectorizes. The cost per row does not
+// depend on the window.
+
+enum class Indicator : std::uint8_t { Sma, Ema, Vwap, LogReturn, Volatility };
+
+// Windows in rows; 0 (or false) leaves the indicator out.
+struct IndicatorWindows {
+  static constexpr std::uint32_t kMaxWindow = 1 << 16;
+
+  std::uint32_t sma = 0;
+  std::uint32_t ema = 0;
+  std::uint32_t vwap = 0;
+  bool log_return = false;
+  std::uint32_t volatility = 0;
+
+  bool any() const { return sma || ema || vwap || log_return || volatility; }
+};
+
+// The windows of `request`. Returns false with `error` set if one is larger
+// than kMaxWindow.
+bool indicator_windows(const marketdata::IndicatorRequest &request, IndicatorWindows &windows,
+                       std::string &error);
+
+// Kernels. `out` has the size of the input; until `window` rows are
+// available the statistics are over the rows so far.
+void rolling_mean(std::span<const double> x, std::uint32_t window, std::span<double> out);
+void exponential_moving_average(std::span<const double> x, std::uint32_t window,
+                                std::span<double> out);
+void rolling_vwap(std::span<const double> price, std::span<const std::int64_t> volume,
+                  std::uint32_t window, std::span<double> out);
+// out[0] is 0.
+void log_returns(std::span<const double> price, std::span<double> out);
+// Sample standard deviation; 0 over fewer than two values.
+void rolling_stddev(std::span<const double> x, std::uint32_t window, std::span<double> out);
+
+// One indicator over the rows of `columns`, on the close. The volatility is
+// the rolling standard deviation of the log returns (0 for the first row,
+// which has none).
+std::vector<double> compute_indicator(const PriceColumnsView &columns, Indicator indicator,
+                                      std::uint32_t window);
+
+// The indicator columns of one series, aligned with its rows. Columns are
+// shared between the streams that request the same indicator and window.
+struct IndicatorSet {
+  using Column = std::shared_ptr<const std::vector<double>>;
+
+  Column sma;
+  Column ema;
+  Column vwap;
+  Column log_return;
+  Column volatility;
+
+  bool empty() const { return !sma && !ema && !vwap && !log_return && !volatility; }
+
+  // Sets the indicators of row `i` in `out`.
+  void fill(std::size_t i, marketdata::Indicators &out) const;
+};
+
+// Computes the indicator columns of a series on first request and keeps
+// them for the next streams of the same version of the series. Thread-safe;
+// columns are computed outside the lock, so streams of other series do not
+// wait on them.
+class IndicatorCache {
+ public:
+  explicit IndicatorCache(std::size_t max_columns = 1024) : m_max_columns(max_columns) {}
+
+  IndicatorSet get(const StockSeries &series, const IndicatorWindows &windows);
+
+ private:
+  struct Key {
+    const void *rows;  // identifies the version of the series
+    std::size_t size;
+    Indicator indicator;
+    std::uint32_t window;
+
+    bool operator==(const Key &other) const = default;
+  };
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const;
+  };
+  struct Entry {
+    StockSeries series;  // keeps `rows` alive, so that the key stays unique
+    IndicatorSet::Column column;
+  };
+
+  IndicatorSet::Column column(const StockSeries &series, Indicator indicator,
+                              std::uint32_t window);
+
+  std::mutex m_mutex;
+  std::size_t m_max_columns;
+  std::unordered_map<Key, Entry, KeyHash> m_columns;
+};
+
+#endif
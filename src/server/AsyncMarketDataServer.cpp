@@ -0,0 +1,909 @@
+#include "AsyncMarketDataServer.hpp"
+#include "utilities/logger.hpp"
+#include <grpcpp/alarm.h>
+#include <chrono>
+#include <mutex>
+
+// How often a call retries a symbol that is not loaded yet.
+constexpr auto kLoadingRetry = std::chrono::milliseconds(20);
+// How often a following call that sent every row checks for published ones.
+constexpr auto kFollowPoll = std::chrono::milliseconds(5);
+
+// A fan-out stream sends every subscriber of a symbol the same FULL daily
+// rows at the server's pacing, so it cannot serve a request for anything
+// else. Returns false with `error` set for such a request.
+static bool fanout_accepts(const marketdata::StockRequest &request, std::string &error) {
+  const char *option = nullptr;
+  if (request.encoding() != marketdata::FULL) {
+    option = "another encoding than FULL";
+  } else if (request.replay().ByteSizeLong() > 0) {
+    option = "its own replay";
+  } else if (request.indicators().ByteSizeLong() > 0) {
+    option = "indicators";
+  } else if (request.start_after_seq() != 0 || request.start_epoch_day() != 0) {
+    option = "a resume point";
+  } else if (request.resolution() != marketdata::DAILY || request.bar_rows() != 0) {
+    option = "bars";
+  } else if (request.follow()) {
+    option = "follow";
+  }
+  if (option) error = std::string("A fan-out server does not serve ") + option;
+  return option == nullptr;
+}
+
+// One Subscribe, SubscribeMany or QueryRange RPC. A call is requested on one completion queue and all its
+// events are delivered there, i.e. to a single worker. Its timer is on the
+// wheel of that worker, so it fires on the same thread.
+//
+// A call owns two independent completion sources: the chain of operations
+// started by the call (Requested, Alarm, Written, Finished), and the
+// AsyncNotifyWhenDone notification. The call deletes itself once both are
+// over. After a failed operation or a cancellation no new operation is
+// started, which also guarantees that nothing is queued on a completion
+// queue that is being shut down.
+class AsyncMarketDataServer::CallBase
+{
+    public:
+    enum class Event { Requested, Alarm, Written, Finished, Done };
+
+    struct Tag : CompletionTag {
+      Tag(CallBase *c, Event e) : call(c), event(e) {}
+      void proceed(bool ok) override { call->proceed(event, ok); }
+      CallBase *call;
+      Event event;
+    };
+
+    // Delivers the Alarm event from the timer wheel.
+    struct Timer : util::wheel_timer {
+      explicit Timer(CallBase *c) : call(c) {}
+      void expire(bool fired) override { call->proceed(Event::Alarm, fired); }
+      CallBase *call;
+    };
+
+    CallBase(AsyncMarketDataServer &owner, std::size_t worker, Method method)
+        : m_owner(owner),
+          m_worker(worker),
+          m_cq(owner.m_queues[worker].get()),
+          m_wheel(*owner.m_wheels[worker]),
+          m_method(method),
+          m_writer(&m_context),
+          m_timer(this),
+          m_requested(this, Event::Requested),
+          m_alarmed(this, Event::Alarm),
+          m_written(this, Event::Written),
+          m_finished(this, Event::Finished),
+          m_done(this, Event::Done) {
+      m_context.AsyncNotifyWhenDone(&m_done);
+      if (m_method == Method::Subscribe) {
+        m_owner.m_service.RequestSubscribe(&m_context, &m_raw_request, &m_writer,
+                                           m_cq, m_cq, &m_requested);
+      } else if (m_method == Method::SubscribeMany) {
+        m_owner.m_service.RequestSubscribeMany(&m_context, &m_raw_request, &m_writer,
+                                               m_cq, m_cq, &m_requested);
+      } else {
+        m_owner.m_service.RequestQueryRange(&m_context, &m_raw_request, &m_writer,
+                                            m_cq, m_cq, &m_requested);
+      }
+    }
+
+    virtual ~CallBase() = default;
+
+    virtual void proceed(Event event, bool ok) = 0;
+
+    protected:
+    // Requests the next call of the same method on this queue and parses
+    // the request. Returns false if the request is malformed.
+    template <class Request>
+    bool accept(Request &request) {
+      m_owner.request_call(m_worker, m_method);
+      return grpc::SerializationTraits<Request>::Deserialize(&m_raw_request, &request).ok();
+    }
+
+    void log_start(const std::string &what) {
+      m_description = what;
+      UTIL_LOG(info, "[Server] Client subscribed to: {}", m_description);
+    }
+
+    void log_end() { UTIL_LOG(info, "[Server] Subscription ended for: {}", m_description); }
+
+    ServerMetrics &metrics() { return m_owner.m_data.metrics(); }
+
+    // The stream is counted as active from here until the call is deleted.
+    void start_stream() { m_active.emplace(metrics()); }
+
+    // Starts writing `buffer`; the Written event follows.
+    void write(const grpc::ByteBuffer &buffer) {
+      m_write_start = ServerMetrics::clock::now();
+      m_writer.Write(buffer, &m_written);
+    }
+
+    // On a successful Written event.
+    void record_written() { metrics().record_write(ServerMetrics::clock::now() - m_write_start); }
+
+    // On Done: a stream that did not end with Finish was cancelled.
+    void record_done() {
+      if (m_active && m_context.IsCancelled()) m_active->cancelled();
+    }
+
+    // Parses the replay of the request into m_schedule. Returns false if
+    // the request is invalid, with `error` set.
+    bool start_schedule(const marketdata::Replay &request, std::string_view stream_key,
+                        std::string &error) {
+      ReplayOptions options;
+      if (!replay_for(m_owner.m_data.replay(), request, options, error)) return false;
+      m_schedule = ReplayClock(options, stream_key);
+      return true;
+    }
+
+    // The Alarm event is delivered at `deadline`.
+    void schedule_at(ReplayClock::clock::time_point deadline) {
+      m_alarm_pending = true;
+      m_wheel.schedule(m_timer, deadline);
+    }
+
+    // On Done: a call waiting for its timer has no operation in flight, so
+    // its chain is over.
+    void cancel_timer() {
+      if (m_alarm_pending) {
+        m_wheel.cancel(m_timer);
+        m_alarm_pending = false;
+        m_finish_seen = true;
+      }
+    }
+
+    AsyncMarketDataServer &m_owner;
+    std::size_t m_worker;
+    grpc::ServerCompletionQueue *m_cq;
+    util::timer_wheel &m_wheel;
+    Method m_method;
+
+    grpc::ServerContext m_context;
+    grpc::ByteBuffer m_raw_request;
+    grpc::ServerAsyncWriter<grpc::ByteBuffer> m_writer;
+    std::string m_description;  // of the subscription, for the log
+    std::optional<ServerMetrics::Stream> m_active;
+    ServerMetrics::clock::time_point m_write_start;
+
+    ReplayClock m_schedule;
+    Timer m_timer;
+    bool m_alarm_pending = false;
+    bool m_finish_seen = false;
+    bool m_done_seen = false;
+
+    Tag m_requested;
+    Tag m_alarmed;
+    Tag m_written;
+    Tag m_finished;
+    Tag m_done;
+};
+
+// Replays the symbol for this subscriber only, building and serializing
+// its own messages.
+class AsyncMarketDataServer::SubscribeCall : public CallBase
+{
+    public:
+    SubscribeCall(AsyncMarketDataServer &owner, std::size_t worker)
+        : CallBase(owner, worker, Method::Subscribe) {}
+
+    void proceed(Event event, bool ok) override {
+      switch (event) {
+        case Event::Requested:
+          if (!ok) {
+            // Server is shutting down, the call never started and the done
+            // notification will not be delivered.
+            delete this;
+            return;
+          }
+          on_requested();
+          break;
+        case Event::Alarm:
+          m_alarm_pending = false;
+          if (!ok || m_done_seen || m_context.IsCancelled()) {
+            m_finish_seen = true;
+          } else if (m_stocks.empty()) {
+            lookup();
+          } else if (m_next == m_stocks.size()) {
+            follow();
+          } else {
+            write_next();
+          }
+          break;
+        case Event::Written:
+          if (!ok) {
+            m_finish_seen = true;
+            break;
+          }
+          record_written();
+          m_sent.sent(1, m_buffer.Length());
+          if (++m_next == m_stocks.size()) {
+            end_of_rows();
+          } else {
+            schedule_next();
+          }
+          break;
+        case Event::Finished:
+          m_finish_seen = true;
+          log_end();
+          break;
+        case Event::Done:
+          m_done_seen = true;
+          record_done();
+          cancel_timer();
+          break;
+      }
+
+      if (m_finish_seen && m_done_seen && !m_alarm_pending) {
+        delete this;
+      }
+    }
+
+    private:
+    void on_requested() {
+      if (!accept(m_request)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed request"),
+                        &m_finished);
+        return;
+      }
+
+      std::string error;
+      if (!start_schedule(m_request.replay(), m_request.symbol(), error) ||
+          !indicator_windows(m_request.indicators(), m_windows, error) ||
+          !bar_spec(m_request.resolution(), m_request.bar_rows(), m_bar, error) ||
+          !check_follow(m_request.follow(), m_bar, error)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error), &m_finished);
+        return;
+      }
+
+      log_start(m_request.symbol());
+      m_message.emplace(m_request.symbol(), m_request.encoding());
+      lookup();
+    }
+
+    void lookup() {
+      m_stocks = m_owner.m_data.getStockData(m_request.symbol());
+      if (!m_stocks.empty()) {
+        m_stocks = m_owner.m_data.bars(m_request.symbol(), m_stocks, m_bar);
+        m_symbol = m_owner.m_data.getStockData().handle(m_request.symbol());
+        start_stream();
+        m_sent = metrics().symbol(m_request.symbol());
+        m_indicators = m_owner.m_data.indicators(m_stocks, m_windows);
+        m_next = resume_row(m_stocks, m_request.start_after_seq(), m_request.start_epoch_day());
+        if (m_next == m_stocks.size()) {
+          // Resumed after the last row: nothing left to send, but maybe to follow.
+          end_of_rows();
+          return;
+        }
+        schedule_next();
+      } else if (m_owner.m_data.loading()) {
+        // The symbol may not be loaded yet.
+        schedule_at(ReplayClock::clock::now() + kLoadingRetry);
+      } else {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found"),
+                        &m_finished);
+      }
+    }
+
+    // Every row of m_stocks is sent.
+    void end_of_rows() {
+      if (m_request.follow()) {
+        follow();
+      } else {
+        m_writer.Finish(grpc::Status::OK, &m_finished);
+      }
+    }
+
+    // Sends the rows published since the last one sent, as soon as there are.
+    void follow() {
+      StockSeries latest = m_symbol.latest();
+      if (latest.size() <= m_next) {
+        schedule_at(ReplayClock::clock::now() + kFollowPoll);
+        return;
+      }
+      m_stocks = std::move(latest);
+      m_indicators = m_owner.m_data.indicators(m_stocks, m_windows);
+      m_live = true;
+      write_next();
+    }
+
+    // Writes right away if the next row is due already (always so in AFAP
+    // and for published rows).
+    void schedule_next() {
+      if (m_live) {
+        write_next();
+        return;
+      }
+      const auto due = m_schedule.next(m_stocks[m_next].epoch_day());
+      if (due <= ReplayClock::clock::now()) {
+        write_next();
+      } else {
+        schedule_at(due);
+      }
+    }
+
+    void write_next() {
+      const marketdata::StockPrice &price = m_message->fill(m_stocks[m_next], m_next, m_indicators);
+
+      bool own_buffer = false;
+      m_buffer.Clear();
+      grpc::SerializationTraits<marketdata::StockPrice>::Serialize(price, &m_buffer, &own_buffer);
+      write(m_buffer);
+    }
+
+    marketdata::StockRequest m_request;
+    std::optional<PriceMessage> m_message;
+    grpc::ByteBuffer m_buffer;
+    StockStore::Handle m_symbol;  // polled when following
+
+    StockSeries m_stocks;
+    std::size_t m_next = 0;
+    IndicatorWindows m_windows;
+    BarSpec m_bar;
+    IndicatorSet m_indicators;
+    ServerMetrics::Symbol m_sent;
+    bool m_live = false;  // following: sending rows as they are published
+};
+
+// Subscriber of the shared per-symbol replay of the FanoutBus.
+//
+// Ticks arrive from the publisher's worker, which may not be the worker of
+// this call, so the write side is guarded by m_mutex: the publisher starts a
+// Write when the stream is idle, otherwise the tick is queued according to
+// the slow-consumer policy and written when the in-flight Write completes.
+class AsyncMarketDataServer::FanoutCall : public CallBase, public FanoutSubscriber
+{
+    public:
+    FanoutCall(AsyncMarketDataServer &owner, std::size_t worker)
+        : CallBase(owner, worker, Method::Subscribe), m_queue(owner.m_bus->options()) {}
+
+    void proceed(Event event, bool ok) override {
+      bool done = false;
+
+      switch (event) {
+        case Event::Requested:
+          if (!ok) {
+            delete this;
+            return;
+          }
+          on_requested();
+          return;
+        case Event::Alarm: {
+          bool retry = false;
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_alarm_pending = false;
+            retry = ok && !m_done_seen;
+            done = can_delete();
+          }
+          if (retry) attach();
+          break;
+        }
+        case Event::Written: {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (!ok) {
+            m_writing = false;
+            m_closed = true;
+            done = can_delete();
+            break;
+          }
+          record_written();
+          m_sent.sent(1, m_in_flight.Length());
+          if (m_queue.pop(m_in_flight)) {
+            write(m_in_flight);
+          } else {
+            m_writing = false;
+            if (m_end_of_stream && !m_closed) {
+              m_finishing = true;
+              m_writer.Finish(grpc::Status::OK, &m_finished);
+            }
+          }
+          done = can_delete();
+          break;
+        }
+        case Event::Finished: {
+          log_end();
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_finish_seen = true;
+          done = can_delete();
+          break;
+        }
+        case Event::Done: {
+          // No tick can be published to this call once detached.
+          if (m_publisher) m_publisher->detach(this);
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_done_seen = true;
+          record_done();
+          m_closed = true;
+          if (m_alarm_pending) m_alarm.Cancel();
+          done = can_delete();
+          break;
+        }
+      }
+
+      if (done) delete this;
+    }
+
+    void publish(const grpc::ByteBuffer &tick) override {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_closed || m_finishing || m_end_of_stream) return;
+
+      if (!m_writing) {
+        m_writing = true;
+        m_in_flight = tick;
+        write(m_in_flight);
+        return;
+      }
+
+      switch (m_queue.offer(tick)) {
+        case SubscriberQueue::Offer::Queued:
+          metrics().fanout_queue_depth().record(m_queue.size());
+          break;
+        case SubscriberQueue::Offer::Dropped:
+        case SubscriberQueue::Offer::Conflated:
+          metrics().fanout_dropped().add();
+          break;
+        case SubscriberQueue::Offer::Overflow:
+          m_closed = true;
+          m_context.TryCancel();
+          UTIL_LOG(warn, "[Server] Disconnecting slow consumer of: {}", m_request.symbol());
+          break;
+      }
+    }
+
+    void end_of_stream() override {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_end_of_stream = true;
+      if (!m_writing && !m_closed && !m_finishing) {
+        m_finishing = true;
+        m_writer.Finish(grpc::Status::OK, &m_finished);
+      }
+    }
+
+    private:
+    void on_requested() {
+      if (!accept(m_request)) {
+        finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed request"));
+        return;
+      }
+      std::string error;
+      if (!fanout_accepts(m_request, error)) {
+        finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error));
+        return;
+      }
+      log_start(m_request.symbol());
+      attach();
+    }
+
+    void attach() {
+      {
+        // Set before the first tick can be published.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sent = metrics().symbol(m_request.symbol());
+      }
+      m_publisher = m_owner.m_bus->attach(m_request.symbol(), this, m_cq);
+      if (m_publisher) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        start_stream();
+        return;
+      }
+
+      if (m_owner.m_data.loading()) {
+        // The symbol may not be loaded yet.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_alarm_pending = true;
+        m_alarm.Set(m_cq, std::chrono::system_clock::now() + kLoadingRetry, &m_alarmed);
+        return;
+      }
+      finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found"));
+    }
+
+    void finish(const grpc::Status &status) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_finishing = true;
+      m_writer.Finish(status, &m_finished);
+    }
+
+    // Requires m_mutex.
+    bool can_delete() const {
+      return m_done_seen && !m_writing && !m_alarm_pending && (!m_finishing || m_finish_seen);
+    }
+
+    marketdata::StockRequest m_request;
+    std::shared_ptr<SymbolPublisher> m_publisher;
+    grpc::Alarm m_alarm;
+
+    std::mutex m_mutex;
+    ServerMetrics::Symbol m_sent;
+    SubscriberQueue m_queue;
+    grpc::ByteBuffer m_in_flight;
+    bool m_writing = false;
+    bool m_closed = false;
+    bool m_end_of_stream = false;
+    bool m_finishing = false;
+};
+
+// SubscribeMany: replays several symbols merged in date order, one
+// StockPriceBatch per write. Same life cycle as SubscribeCall.
+class AsyncMarketDataServer::MultiSubscribeCall : public CallBase
+{
+    public:
+    MultiSubscribeCall(AsyncMarketDataServer &owner, std::size_t worker)
+        : CallBase(owner, worker, Method::SubscribeMany) {}
+
+    void proceed(Event event, bool ok) override {
+      switch (event) {
+        case Event::Requested:
+          if (!ok) {
+            delete this;
+            return;
+          }
+          on_requested();
+          break;
+        case Event::Alarm:
+          m_alarm_pending = false;
+          if (!ok || m_done_seen || m_context.IsCancelled()) {
+            m_finish_seen = true;
+          } else if (!m_started) {
+            lookup();
+          } else if (m_stream.done()) {
+            follow();
+          } else {
+            write_next();
+          }
+          break;
+        case Event::Written:
+          if (!ok) {
+            m_finish_seen = true;
+            break;
+          }
+          record_written();
+          ServerMetrics::count_batch(m_sent, m_stream.sources(), m_batch);
+          if (m_stream.done()) {
+            end_of_rows();
+          } else {
+            schedule_next();
+          }
+          break;
+        case Event::Finished:
+          m_finish_seen = true;
+          log_end();
+          break;
+        case Event::Done:
+          m_done_seen = true;
+          record_done();
+          cancel_timer();
+          break;
+      }
+
+      if (m_finish_seen && m_done_seen && !m_alarm_pending) {
+        delete this;
+      }
+    }
+
+    private:
+    void on_requested() {
+      if (!accept(m_request)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed request"),
+                        &m_finished);
+        return;
+      }
+
+      m_symbols = requested_symbols(m_request);
+      if (m_symbols.empty()) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "No symbols requested"),
+                        &m_finished);
+        return;
+      }
+
+      std::string error;
+      if (!start_schedule(m_request.replay(), m_symbols.front(), error) ||
+          !indicator_windows(m_request.indicators(), m_windows, error) ||
+          !bar_spec(m_request.resolution(), m_request.bar_rows(), m_bar, error) ||
+          !check_follow(m_request.follow(), m_bar, error)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error), &m_finished);
+        return;
+      }
+
+      log_start(std::to_string(m_symbols.size()) + " symbols");
+      lookup();
+    }
+
+    // Starts the stream once every symbol is found.
+    void lookup() {
+      std::vector<StockSeries> series;
+      std::vector<IndicatorSet> indicators;
+      std::vector<std::size_t> starts;
+      for (const auto &symbol : m_symbols) {
+        StockSeries stocks = m_owner.m_data.getStockData(symbol);
+        if (!stocks.empty()) {
+          stocks = m_owner.m_data.bars(symbol, stocks, m_bar);
+          if (m_windows.any()) indicators.push_back(m_owner.m_data.indicators(stocks, m_windows));
+          starts.push_back(resume_row(stocks, resume_seq(m_request, symbol),
+                                      m_request.start_epoch_day()));
+          series.push_back(std::move(stocks));
+        } else if (m_owner.m_data.loading()) {
+          // The symbol may not be loaded yet.
+          schedule_at(ReplayClock::clock::now() + kLoadingRetry);
+          return;
+        } else {
+          m_writer.Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found: " + symbol),
+                          &m_finished);
+          return;
+        }
+      }
+
+      start_stream();
+      for (const auto &symbol : m_symbols) m_sent.push_back(metrics().symbol(symbol));
+      m_stream = MultiSymbolStream(std::move(m_symbols), std::move(series), m_request.max_batch(),
+                                   m_request.encoding(), std::move(indicators), std::move(starts));
+      m_span_days = m_schedule.options().mode == ReplayMode::Afap;
+      if (m_request.follow()) {
+        for (const auto &symbol : m_stream.symbols()) {
+          m_followed.push_back(m_owner.m_data.getStockData().handle(symbol));
+        }
+      }
+      m_started = true;
+      if (m_stream.done()) {
+        end_of_rows();
+        return;
+      }
+      schedule_next();
+    }
+
+    // Every row of the stream is sent.
+    void end_of_rows() {
+      if (m_request.follow()) {
+        follow();
+      } else {
+        m_writer.Finish(grpc::Status::OK, &m_finished);
+      }
+    }
+
+    // Sends the rows published since the last ones sent, as soon as there are.
+    void follow() {
+      if (!m_owner.m_data.follow(m_stream, m_followed, m_windows)) {
+        schedule_at(ReplayClock::clock::now() + kFollowPoll);
+        return;
+      }
+      m_live = true;
+      write_next();
+    }
+
+    void schedule_next() {
+      if (m_live) {
+        write_next();
+        return;
+      }
+      const auto due = m_schedule.next(m_stream.epoch_day());
+      if (due <= ReplayClock::clock::now()) {
+        write_next();
+      } else {
+        schedule_at(due);
+      }
+    }
+
+    void write_next() {
+      m_stream.next_batch(m_batch, m_span_days || m_live);
+
+      bool own_buffer = false;
+      m_buffer.Clear();
+      grpc::SerializationTraits<marketdata::StockPriceBatch>::Serialize(m_batch, &m_buffer,
+                                                                        &own_buffer);
+      write(m_buffer);
+    }
+
+    marketdata::MultiStockRequest m_request;
+    std::vector<std::string> m_symbols;
+    marketdata::StockPriceBatch m_batch;
+    grpc::ByteBuffer m_buffer;
+
+    MultiSymbolStream m_stream;
+    std::vector<ServerMetrics::Symbol> m_sent;  // by index in the stream's symbols
+    std::vector<StockStore::Handle> m_followed;  // the stream's symbols, when following
+    IndicatorWindows m_windows;
+    BarSpec m_bar;
+    bool m_span_days = false;
+    bool m_started = false;
+    bool m_live = false;  // following: sending rows as they are published
+};
+
+// Writes the chunks of a date range one after the other.
+class AsyncMarketDataServer::QueryRangeCall : public CallBase
+{
+    public:
+    QueryRangeCall(AsyncMarketDataServer &owner, std::size_t worker)
+        : CallBase(owner, worker, Method::QueryRange) {}
+
+    void proceed(Event event, bool ok) override {
+      switch (event) {
+        case Event::Requested:
+          if (!ok) {
+            delete this;
+            return;
+          }
+          on_requested();
+          break;
+        case Event::Alarm:
+          m_alarm_pending = false;
+          if (!ok || m_done_seen || m_context.IsCancelled()) {
+            m_finish_seen = true;
+          } else {
+            lookup();
+          }
+          break;
+        case Event::Written:
+          if (!ok) {
+            m_finish_seen = true;
+          } else {
+            record_written();
+            m_sent.sent(static_cast<std::size_t>(m_chunk.epoch_day_size()), m_buffer.Length());
+            write_next();
+          }
+          break;
+        case Event::Finished:
+          m_finish_seen = true;
+          log_end();
+          break;
+        case Event::Done:
+          m_done_seen = true;
+          record_done();
+          cancel_timer();
+          break;
+      }
+
+      if (m_finish_seen && m_done_seen && !m_alarm_pending) {
+        delete this;
+      }
+    }
+
+    private:
+    void on_requested() {
+      if (!accept(m_request)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed request"),
+                        &m_finished);
+        return;
+      }
+
+      std::string error;
+      if (!parse_range_query(m_request, m_query, error)) {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error), &m_finished);
+        return;
+      }
+
+      log_start(m_request.symbol() + " (range)");
+      lookup();
+    }
+
+    void lookup() {
+      StockSeries stocks = m_owner.m_data.getStockData(m_request.symbol());
+      if (!stocks.empty()) {
+        start_stream();
+        m_sent = metrics().symbol(m_request.symbol());
+        m_cursor = RangeCursor(std::move(stocks), m_query);
+        write_next();
+      } else if (m_owner.m_data.loading()) {
+        // The symbol may not be loaded yet.
+        schedule_at(ReplayClock::clock::now() + kLoadingRetry);
+      } else {
+        m_writer.Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found"),
+                        &m_finished);
+      }
+    }
+
+    // Finishes the stream once every chunk is written (at once for an empty range).
+    void write_next() {
+      if (m_cursor.done()) {
+        m_writer.Finish(grpc::Status::OK, &m_finished);
+        return;
+      }
+      m_cursor.next_chunk(m_chunk);
+
+      bool own_buffer = false;
+      m_buffer.Clear();
+      grpc::SerializationTraits<marketdata::RangeChunk>::Serialize(m_chunk, &m_buffer,
+                                                                   &own_buffer);
+      write(m_buffer);
+    }
+
+    marketdata::RangeRequest m_request;
+    RangeQuery m_query;
+    RangeCursor m_cursor;
+    marketdata::RangeChunk m_chunk;
+    grpc::ByteBuffer m_buffer;
+    ServerMetrics::Symbol m_sent;
+};
+
+AsyncMarketDataServer::AsyncMarketDataServer(MarketDataServiceImpl &data,
+                                             unsigned int num_threads)
+    : m_data(data), m_num_threads(num_threads == 0 ? 1 : num_threads), m_service(data) {}
+
+grpc::Status AsyncMarketDataServer::RawService::GetStats(grpc::ServerContext *,
+                                                         const marketdata::StatsRequest *request,
+                                                         marketdata::StatsReply *reply) {
+  m_data.metrics().fill(request->prefix(), *reply);
+  return grpc::Status::OK;
+}
+
+grpc::Status AsyncMarketDataServer::RawService::SubscribeSharedMemory(
+    grpc::ServerContext *context, const marketdata::SharedMemoryRequest *request,
+    marketdata::SharedMemoryReply *reply) {
+  return m_data.subscribe_shared_memory(context, *request, *reply);
+}
+
+grpc::Status AsyncMarketDataServer::RawService::Publish(
+    grpc::ServerContext *context, grpc::ServerReader<marketdata::StockPriceBatch> *reader,
+    marketdata::PublishReply *reply) {
+  return m_data.Publish(context, reader, reply);
+}
+
+AsyncMarketDataServer::~AsyncMarketDataServer() { stop(); }
+
+void AsyncMarketDataServer::set_fanout(const FanoutOptions &options) {
+  m_bus = std::make_unique<FanoutBus>(m_data, options);
+}
+
+void AsyncMarketDataServer::configure(grpc::ServerBuilder &builder) {
+  builder.RegisterService(&m_service);
+  for (unsigned int i = 0; i < m_num_threads; ++i) {
+    m_queues.push_back(builder.AddCompletionQueue());
+    m_wheels.push_back(std::make_unique<util::timer_wheel>());
+  }
+}
+
+void AsyncMarketDataServer::start() {
+  for (std::size_t i = 0; i < m_queues.size(); ++i) {
+    request_call(i, Method::Subscribe);
+    request_call(i, Method::SubscribeMany);
+    request_call(i, Method::QueryRange);
+  }
+  for (std::size_t i = 0; i < m_queues.size(); ++i) {
+    m_workers.emplace_back([this, i]() { serve(i); });
+  }
+}
+
+void AsyncMarketDataServer::stop() {
+  if (m_bus) m_bus->shutdown();
+  for (auto &cq : m_queues) {
+    cq->Shutdown();
+  }
+  for (auto &worker : m_workers) {
+    if (worker.joinable()) worker.join();
+  }
+  m_workers.clear();
+  m_queues.clear();
+  m_wheels.clear();
+}
+
+unsigned int AsyncMarketDataServer::size() const { return m_num_threads; }
+
+void AsyncMarketDataServer::request_call(std::size_t worker, Method method) {
+  if (method == Method::SubscribeMany) {
+    new MultiSubscribeCall(*this, worker);
+  } else if (method == Method::QueryRange) {
+    new QueryRangeCall(*this, worker);
+  } else if (m_bus) {
+    new FanoutCall(*this, worker);
+  } else {
+    new SubscribeCall(*this, worker);
+  }
+}
+
+void AsyncMarketDataServer::serve(std::size_t worker) {
+  grpc::ServerCompletionQueue *cq = m_queues[worker].get();
+  util::timer_wheel &wheel = *m_wheels[worker];
+  void *tag = nullptr;
+  bool ok = false;
+
+  while (true) {
+    // Wakes up for the next event or the next timer, whichever comes first.
+    const auto status = cq->AsyncNext(&tag, &ok, system_deadline(wheel.next_expiry()));
+    if (status == grpc::CompletionQueue::SHUTDOWN) break;
+    if (status == grpc::CompletionQueue::GOT_EVENT) {
+      static_cast<CompletionTag *>(tag)->proceed(ok);
+    }
+    wheel.advance(ReplayClock::clock::now());
+  }
+
+  // Calls cancel their timer when done, so this only fires the timers of
+  // calls that never got their done notification.
+  wheel.drain();
+}
@@ -0,0 +1,124 @@
+#ifndef ASYNC_MARKET_DATA_SERVER_HPP
+#define ASYNC_MARKET_DATA_SERVER_HPP
+
+#include "FanoutBus.hpp"
+#include "MarketDataServer.hpp"
+#include "utilities/timer_wheel.hpp"
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Completion-queue based engine for the MarketData service.
+//
+// The synchronous MarketDataServiceImpl parks one gRPC thread per subscriber
+// for the whole lifetime of the stream. This engine instead multiplexes every
+// subscription over a fixed number of worker threads: each worker owns one
+// ServerCompletionQueue and one util::timer_wheel, and a stream waiting for
+// its next update (see ReplayClock) is a timer on that wheel rather than a
+// sleeping thread. The worker polls its queue until the next timer is due;
+// updates that are due already, e.g. the whole of an AFAP replay, are
+// written without a timer.
+//
+// Subscribe is served as a raw (ByteBuffer) method so that the engine decides
+// where the messages are serialized:
+//   * by default every subscription replays the symbol on its own;
+//   * with set_fanout(), the subscribers of a symbol share one live replay
+//     (see FanoutBus) and each tick is serialized once for all of them.
+// SubscribeMany (several symbols merged into one stream) always replays on
+// its own, since a merged stream cannot follow the per-symbol replays.
+// QueryRange writes its chunks back to back, each once the previous one is
+// written. A following stream that sent all its rows checks for published
+// rows on a timer.
+// Fan-out subscriptions are always sent FULL and at the server's replay
+// options: their shared messages cannot carry per-subscriber deltas or
+// schedules.
+//
+// The stock data itself is still owned (and loaded) by MarketDataServiceImpl,
+// which also applies the Publish calls.
+//
+// Usage:
+//   AsyncMarketDataServer engine(service, num_threads);
+//   engine.configure(builder);          // before BuildAndStart()
+//   auto server = builder.BuildAndStart();
+//   engine.start();
+//   ...
+//   server->Shutdown();
+//   engine.stop();
+class AsyncMarketDataServer
+{
+    public:
+    AsyncMarketDataServer(MarketDataServiceImpl &data, unsigned int num_threads);
+    ~AsyncMarketDataServer();
+
+    AsyncMarketDataServer(const AsyncMarketDataServer &) = delete;
+    AsyncMarketDataServer &operator=(const AsyncMarketDataServer &) = delete;
+
+    // Shares one replay per symbol between its subscribers.
+    // Must be called before start().
+    void set_fanout(const FanoutOptions &options);
+
+    // Registers the async service and one completion queue per worker.
+    // Must be called before grpc::ServerBuilder::BuildAndStart().
+    void configure(grpc::ServerBuilder &builder);
+
+    // Spawns the worker threads. Must be called once the server is built.
+    void start();
+
+    // Shuts the completion queues down and joins the workers.
+    // The grpc::Server must have been shut down before.
+    void stop();
+
+    unsigned int size() const;
+
+    private:
+    // The streaming methods are raw and served on the completion queues.
+    // GetStats, SubscribeSharedMemory and Publish (client streaming) are
+    // plain calls, answered on gRPC's own threads.
+    class RawService final
+        : public marketdata::MarketData::WithRawMethod_QueryRange<
+              marketdata::MarketData::WithRawMethod_SubscribeMany<
+                  marketdata::MarketData::WithRawMethod_Subscribe<
+                      marketdata::MarketData::Service>>>
+    {
+        public:
+        explicit RawService(MarketDataServiceImpl &data) : m_data(data) {}
+
+        grpc::Status GetStats(grpc::ServerContext *context,
+                              const marketdata::StatsRequest *request,
+                              marketdata::StatsReply *reply) override;
+
+        grpc::Status SubscribeSharedMemory(grpc::ServerContext *context,
+                                           const marketdata::SharedMemoryRequest *request,
+                                           marketdata::SharedMemoryReply *reply) override;
+
+        grpc::Status Publish(grpc::ServerContext *context,
+                             grpc::ServerReader<marketdata::StockPriceBatch> *reader,
+                             marketdata::PublishReply *reply) override;
+
+        private:
+        MarketDataServiceImpl &m_data;
+    };
+
+    enum class Method { Subscribe, SubscribeMany, QueryRange };
+
+    class CallBase;
+    class SubscribeCall;
+    class FanoutCall;
+    class MultiSubscribeCall;
+    class QueryRangeCall;
+
+    void request_call(std::size_t worker, Method method);
+    void serve(std::size_t worker);
+
+    const MarketDataServiceImpl &m_data;
+    unsigned int m_num_threads;
+    std::unique_ptr<FanoutBus> m_bus;
+
+    RawService m_service;
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> m_queues;
+    std::vector<std::unique_ptr<util::timer_wheel>> m_wheels;  // one per queue
+    std::vector<std::thread> m_workers;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "Bars.hpp"
+#include <algorithm>
+#include <chrono>
+
+bool bar_spec(marketdata::Resolution resolution, std::uint32_t bar_rows, BarSpec &spec,
+              std::string &error) {
+  if (!marketdata::Resolution_IsValid(resolution)) {
+    error = "Unknown resolution " + std::to_string(static_cast<int>(resolution));
+    return false;
+  }
+  if (bar_rows > BarSpec::kMaxBarRows) {
+    error = "Bars are limited to " + std::to_string(BarSpec::kMaxBarRows) + " rows";
+    return false;
+  }
+  if (resolution != marketdata::DAILY && bar_rows > 1) {
+    error = "A subscription takes either a resolution or bar_rows";
+    return false;
+  }
+  spec.resolution = resolution;
+  spec.rows = bar_rows;
+  return true;
+}
+
+namespace {
+
+std::int32_t floor_div(std::int32_t a, std::int32_t b) {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// Appends the bar of the source elements [first, last) to `out`.
+void append_bar(const PriceColumnsView &source, std::size_t first, std::size_t last,
+                PriceColumns &out) {
+  double high = source.high[first];
+  double low = source.low[first];
+  std::int64_t volume = 0;
+  for (std::size_t i = first; i < last; ++i) {
+    high = std::max(high, source.high[i]);
+    low = std::min(low, source.low[i]);
+    volume += source.volume[i];
+  }
+  out.date.push_back(source.date[last - 1]);
+  out.adj_close.push_back(source.adj_close[last - 1]);
+  out.close.push_back(source.close[last - 1]);
+  out.high.push_back(high);
+  out.low.push_back(low);
+  out.open.push_back(source.open[first]);
+  out.volume.push_back(volume);
+}
+
+// The first `n` elements of `columns`.
+PriceColumnsView head(const PriceColumnsView &columns, std::size_t n) {
+  return {columns.date.first(n), columns.adj_close.first(n), columns.close.first(n),
+          columns.high.first(n), columns.low.first(n),       columns.open.first(n),
+          columns.volume.first(n)};
+}
+
+}  // namespace
+
+std::int32_t period_of(marketdata::Resolution resolution, std::int32_t epoch_day) {
+  if (resolution == marketdata::WEEKLY) {
+    return floor_div(epoch_day + 3, 7);  // 1970-01-01 was a Thursday
+  }
+  if (resolution == marketdata::DAILY) return epoch_day;
+
+  const std::chrono::year_month_day ymd{std::chrono::sys_days{std::chrono::days{epoch_day}}};
+  const std::int32_t year = static_cast<int>(ymd.year());
+  const std::int32_t month = year * 12 + static_cast<std::int32_t>(unsigned(ymd.month())) - 1;
+  switch (resolution) {
+    case marketdata::MONTHLY:
+      return month;
+    case marketdata::QUARTERLY:
+      return floor_div(month, 3);
+    default:
+      return year;
+  }
+}
+
+PriceColumns aggregate_rows(const PriceColumnsView &rows, std::uint32_t rows_per_bar) {
+  rows_per_bar = std::max<std::uint32_t>(rows_per_bar, 1);
+  PriceColumns bars;
+  bars.reserve((rows.size() + rows_per_bar - 1) / rows_per_bar);
+  for (std::size_t first = 0; first < rows.size(); first += rows_per_bar) {
+    append_bar(rows, first, std::min<std::size_t>(first + rows_per_bar, rows.size()), bars);
+  }
+  return bars;
+}
+
+BarPyramid::BarPyramid(const StockSeries &rows) : m_rows(rows) {
+  for (auto resolution : {marketdata::WEEKLY, marketdata::MONTHLY, marketdata::QUARTERLY,
+                          marketdata::YEARLY}) {
+    build(resolution, nullptr, 0);
+  }
+}
+
+BarPyramid::BarPyramid(const BarPyramid &previous, const StockSeries &rows) : m_rows(rows) {
+  const std::size_t appended = previous.m_rows.size();
+  build(marketdata::WEEKLY, &previous.m_levels[index(marketdata::WEEKLY)], appended);
+  std::size_t changed =
+      build(marketdata::MONTHLY, &previous.m_levels[index(marketdata::MONTHLY)], appended);
+  changed = build(marketdata::QUARTERLY, &previous.m_levels[index(marketdata::QUARTERLY)], changed);
+  build(marketdata::YEARLY, &previous.m_levels[index(marketdata::YEARLY)], changed);
+}
+
+bool BarPyramid::built_on(const StockSeries &rows) const {
+  return rows.columns().date.data() == m_rows.columns().date.data() &&
+         rows.size() == m_rows.size();
+}
+
+bool BarPyramid::extended_by(const StockSeries &rows) const {
+  if (m_rows.empty() || rows.size() <= m_rows.size()) return false;
+  const std::size_t last = m_rows.size() - 1;
+  const PriceColumnsView &old_rows = m_rows.columns();
+  const PriceColumnsView &new_rows = rows.columns();
+  return new_rows.date[0] == old_rows.date[0] && new_rows.date[last] == old_rows.date[last] &&
+         new_rows.close[last] == old_rows.close[last];
+}
+
+StockSeries BarPyramid::level(marketdata::Resolution resolution) const {
+  if (resolution == marketdata::DAILY) return m_rows;
+  return m_levels[index(resolution)].bars;
+}
+
+marketdata::Resolution BarPyramid::source_of(marketdata::Resolution resolution) {
+  switch (resolution) {
+    case marketdata::QUARTERLY:
+      return marketdata::MONTHLY;
+    case marketdata::YEARLY:
+      return marketdata::QUARTERLY;
+    default:
+      return marketdata::DAILY;
+  }
+}
+
+std::size_t BarPyramid::index(marketdata::Resolution resolution) {
+  return static_cast<std::size_t>(resolution) - 1;
+}
+
+std::size_t BarPyramid::build(marketdata::Resolution resolution, const Level *previous,
+                              std::size_t changed) {
+  const StockSeries source_series = level(source_of(resolution));
+  const PriceColumnsView &source = source_series.columns();
+
+  // Bars before the one holding element `changed` are complete and kept.
+  // starts[0] is 0, so there is always one.
+  std::size_t kept = 0;
+  std::size_t first = 0;
+  if (previous && !previous->starts.empty()) {
+    const auto it = std::upper_bound(previous->starts.begin(), previous->starts.end(), changed);
+    kept = static_cast<std::size_t>(it - previous->starts.begin()) - 1;
+    first = previous->starts[kept];
+  }
+
+  auto bars = std::make_shared<PriceColumns>();
+  std::vector<std::size_t> starts;
+  if (kept > 0) {
+    bars->reserve(previous->starts.size() + 1);
+    bars->append(head(previous->bars.columns(), kept));
+    starts.assign(previous->starts.begin(), previous->starts.begin() + kept);
+  }
+
+  while (first < source.size()) {
+    const std::int32_t period = period_of(resolution, source.date[first]);
+    std::size_t last = first + 1;
+    while (last < source.size() && period_of(resolution, source.date[last]) == period) ++last;
+    starts.push_back(first);
+    append_bar(source, first, last, *bars);
+    first = last;
+  }
+
+  Level &level = m_levels[index(resolution)];
+  level.bars = StockSeries(std::shared_ptr<const PriceColumns>(std::move(bars)));
+  level.starts = std::move(starts);
+  return kept;
+}
+
+void BarStore::update(const std::string &symbol, const StockSeries &rows) {
+  pyramid(symbol, rows);
+}
+
+StockSeries BarStore::bars(const std::string &symbol, const StockSeries &rows,
+                           const BarSpec &spec) {
+  if (spec.rows > 1) {
+    return StockSeries(
+        std::make_shared<const PriceColumns>(aggregate_rows(rows.columns(), spec.rows)));
+  }
+  if (spec.resolution == marketdata::DAILY) return rows;
+  return pyramid(symbol, rows)->level(spec.resolution);
+}
+
+std::shared_ptr<const BarPyramid> BarStore::pyramid(const std::string &symbol,
+                                                    const StockSeries &rows) {
+  std::shared_ptr<const BarPyramid> current;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pyramids.find(symbol);
+    if (it != m_pyramids.end()) current = it->second;
+  }
+  if (current && current->built_on(rows)) return current;
+
+  // Built outside the lock: a large history takes a while.
+  auto built = current && current->extended_by(rows)
+                   ? std::make_shared<const BarPyramid>(*current, rows)
+                   : std::make_shared<const BarPyramid>(rows);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto &stored = m_pyramids[symbol];
+  if (!stored || stored->size() <= built->size()) stored = built;
+  return built;
+}
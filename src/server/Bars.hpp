@@ -0,0 +1,105 @@
+#ifndef BARS_HPP
+#define BARS_HPP
+
+#include "marketdata.pb.h"
+#include "StockStore.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// OHLCV bars of a symbol, coarser than its rows (see Resolution in
+// marketdata.proto). A bar has the open of its first row, the close and
+// adjusted close of its last, the highest high, the lowest low and the total
+// volume, and is dated by its last row.
+//
+// The calendar levels form a pyramid: weeks and months are aggregated from
+// the rows, quarters from the months and years from the quarters, so each
+// level costs one pass over a smaller level. It is built when a symbol is
+// loaded; when rows are appended, only the last bar of each level (which
+// may have been partial) and the bars after it are aggregated again. Bars
+// are stored as PriceColumns, so a bar series streams like the rows.
+
+// What a subscription asks for: a calendar level, or bars of a fixed number
+// of rows (computed per request, they are not kept).
+struct BarSpec {
+  static constexpr std::uint32_t kMaxBarRows = 1 << 16;
+
+  marketdata::Resolution resolution = marketdata::DAILY;
+  std::uint32_t rows = 0;  // > 1: bars of that many rows instead
+
+  bool any() const { return resolution != marketdata::DAILY || rows > 1; }
+};
+
+// Returns false with `error` set if the resolution is unknown, `bar_rows`
+// too large, or both are set.
+bool bar_spec(marketdata::Resolution resolution, std::uint32_t bar_rows, BarSpec &spec,
+              std::string &error);
+
+// Index of the calendar period (Monday-to-Sunday week, month, quarter or
+// year) of `epoch_day`; consecutive periods have consecutive indices.
+std::int32_t period_of(marketdata::Resolution resolution, std::int32_t epoch_day);
+
+// Bars of `rows_per_bar` consecutive rows; the last one may be partial.
+PriceColumns aggregate_rows(const PriceColumnsView &rows, std::uint32_t rows_per_bar);
+
+// The calendar levels over one version of a symbol's rows. Immutable.
+class BarPyramid {
+ public:
+  explicit BarPyramid(const StockSeries &rows);
+  // The pyramid of `rows`, which extend those of `previous` (extended_by()),
+  // reusing its bars up to the last one of each level.
+  BarPyramid(const BarPyramid &previous, const StockSeries &rows);
+
+  // `rows` is the version the pyramid was built on.
+  bool built_on(const StockSeries &rows) const;
+  // `rows` is that version with rows appended after the last one.
+  bool extended_by(const StockSeries &rows) const;
+
+  std::size_t size() const { return m_rows.size(); }  // rows
+
+  // The bars of a level; DAILY gives the rows.
+  StockSeries level(marketdata::Resolution resolution) const;
+
+ private:
+  struct Level {
+    StockSeries bars;
+    std::vector<std::size_t> starts;  // first element of each bar in its source
+  };
+
+  // The level the bars of `resolution` (WEEKLY..YEARLY) are aggregated
+  // from, and the position of `resolution` in m_levels.
+  static marketdata::Resolution source_of(marketdata::Resolution resolution);
+  static std::size_t index(marketdata::Resolution resolution);
+
+  // (Re)aggregates the bars of `resolution` from element `changed` of its
+  // source on, keeping the bars of `previous` before the one holding it.
+  // Returns the index of the first bar that may differ from `previous`.
+  std::size_t build(marketdata::Resolution resolution, const Level *previous, std::size_t changed);
+
+  StockSeries m_rows;
+  std::array<Level, 4> m_levels;  // WEEKLY, MONTHLY, QUARTERLY, YEARLY
+};
+
+// The latest pyramid of every symbol. Thread-safe.
+class BarStore {
+ public:
+  // Builds the pyramid of `rows`, the current history of `symbol`; extends
+  // the previous pyramid if rows were only appended.
+  void update(const std::string &symbol, const StockSeries &rows);
+
+  // The bars of `rows` (a version of `symbol`'s history) at `spec`. A newer
+  // version than the symbol's pyramid replaces it.
+  StockSeries bars(const std::string &symbol, const StockSeries &rows, const BarSpec &spec);
+
+ private:
+  std::shared_ptr<const BarPyramid> pyramid(const std::string &symbol, const StockSeries &rows);
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<const BarPyramid>> m_pyramids;
+};
+
+#endif
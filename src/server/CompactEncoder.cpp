@@ -0,0 +1,37 @@
+#include "CompactEncoder.hpp"
+#include <cmath>
+
+namespace {
+
+std::int64_t to_fixed(double price) {
+  return std::llround(price * CompactEncoder::kPriceScale);
+}
+
+// Returns the difference from `previous` and makes `value` the new previous.
+template <class T>
+T delta(T value, T &previous) {
+  const T d = value - previous;
+  previous = value;
+  return d;
+}
+
+}  // namespace
+
+CompactEncoder::CompactEncoder(std::size_t symbols) : m_previous(symbols) {}
+
+void CompactEncoder::encode(std::uint32_t symbol_id, const StockData &row,
+                            std::int64_t timestamp_ns, marketdata::CompactPrice &out,
+                            std::uint64_t seq) {
+  Previous &previous = m_previous[symbol_id];
+
+  out.set_symbol_id(symbol_id);
+  out.set_adjusted_close(delta(to_fixed(row.adj_close()), previous.adj_close));
+  out.set_close(delta(to_fixed(row.close()), previous.close));
+  out.set_high(delta(to_fixed(row.high()), previous.high));
+  out.set_low(delta(to_fixed(row.low()), previous.low));
+  out.set_open(delta(to_fixed(row.open()), previous.open));
+  out.set_volume(delta(static_cast<std::int64_t>(row.volume()), previous.volume));
+  out.set_epoch_day(delta(row.epoch_day(), previous.epoch_day));
+  out.set_timestamp_ns(delta(timestamp_ns, m_timestamp_ns));
+  out.set_seq(seq != 0 ? delta(seq, previous.seq) : 0);
+}
@@ -0,0 +1,39 @@
+#ifndef COMPACT_ENCODER_HPP
+#define COMPACT_ENCODER_HPP
+
+#include "marketdata.pb.h"
+#include "StockStore.hpp"
+#include <cstdint>
+#include <vector>
+
+// Server side of the COMPACT encoding (see CompactPrice in marketdata.proto).
+// Keeps the previous update of every symbol of one subscription, so there
+// is one encoder per subscription.
+class CompactEncoder {
+ public:
+  static constexpr double kPriceScale = 1e6;
+
+  explicit CompactEncoder(std::size_t symbols = 1);
+
+  // Encodes `row` of symbol `symbol_id` into `out`, stamped with
+  // `timestamp_ns`. `seq` is the sequence number of the row (0: none).
+  void encode(std::uint32_t symbol_id, const StockData &row, std::int64_t timestamp_ns,
+              marketdata::CompactPrice &out, std::uint64_t seq = 0);
+
+ private:
+  struct Previous {
+    std::int64_t adj_close = 0;
+    std::int64_t close = 0;
+    std::int64_t high = 0;
+    std::int64_t low = 0;
+    std::int64_t open = 0;
+    std::int64_t volume = 0;
+    std::int32_t epoch_day = 0;
+    std::uint64_t seq = 0;
+  };
+
+  std::vector<Previous> m_previous;  // by symbol id
+  std::int64_t m_timestamp_ns = 0;
+};
+
+#endif
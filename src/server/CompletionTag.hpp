@@ -0,0 +1,14 @@
+#ifndef COMPLETION_TAG_HPP
+#define COMPLETION_TAG_HPP
+
+// Every tag placed on a completion queue of the async engine. The worker
+// draining the queue calls proceed() with the `ok` flag of the completed
+// operation (or alarm).
+class CompletionTag
+{
+    public:
+    virtual ~CompletionTag() = default;
+    virtual void proceed(bool ok) = 0;
+};
+
+#endif
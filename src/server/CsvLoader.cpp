@@ -0,0 +1,104 @@
+#include "CsvLoader.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kFields = 7;
+constexpr const char *kFieldNames[kFields] = {"Date", "Adj Close", "Close", "High",
+                                              "Low",  "Open",      "Volume"};
+
+// Cuts the next line off `text`, without its line terminator. memchr is the
+// vectorized delimiter scan of the C library.
+std::string_view next_line(std::string_view &text) {
+  const char *begin = text.data();
+  const char *nl = static_cast<const char *>(std::memchr(begin, '\n', text.size()));
+  std::size_t length = nl ? static_cast<std::size_t>(nl - begin) : text.size();
+  text.remove_prefix(nl ? length + 1 : length);
+  if (length > 0 && begin[length - 1] == '\r') --length;
+  return {begin, length};
+}
+
+template <class T>
+bool parse_number(std::string_view field, T &value) {
+  auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+  return ec == std::errc() && ptr == field.data() + field.size();
+}
+
+// Parses one data row; on failure returns false and sets `error`.
+bool parse_row(std::string_view line, PriceColumns &columns, std::string &error) {
+  std::string_view fields[kFields];
+  std::size_t count = 0;
+  while (true) {
+    const std::size_t comma = line.find(',');
+    if (count < kFields) fields[count] = line.substr(0, comma);
+    ++count;
+    if (comma == std::string_view::npos) break;
+    line.remove_prefix(comma + 1);
+  }
+  if (count != kFields) {
+    error = "expected " + std::to_string(kFields) + " fields, found " + std::to_string(count);
+    return false;
+  }
+
+  auto invalid = [&](std::size_t i) {
+    error = "invalid " + std::string(kFieldNames[i]) + " '" + std::string(fields[i]) + "'";
+    return false;
+  };
+
+  const auto date = parse_date(fields[0]);
+  if (!date) return invalid(0);
+
+  double prices[5];
+  for (std::size_t i = 0; i < 5; ++i) {
+    if (!parse_number(fields[i + 1], prices[i])) return invalid(i + 1);
+  }
+
+  std::int64_t volume = 0;
+  if (!parse_number(fields[6], volume)) return invalid(6);
+
+  columns.date.push_back(*date);
+  columns.adj_close.push_back(prices[0]);
+  columns.close.push_back(prices[1]);
+  columns.high.push_back(prices[2]);
+  columns.low.push_back(prices[3]);
+  columns.open.push_back(prices[4]);
+  columns.volume.push_back(volume);
+  return true;
+}
+
+}  // namespace
+
+CsvParseResult parse_price_csv(std::string_view text, PriceColumns &columns) {
+  CsvParseResult result;
+
+  if (text.empty()) {
+    result.errors.push_back({1, "missing symbol line"});
+    return result;
+  }
+  result.symbol = std::string(next_line(text));
+  if (result.symbol.empty()) {
+    result.errors.push_back({1, "empty symbol"});
+    return result;
+  }
+
+  // Header
+  next_line(text);
+
+  columns.reserve(columns.size() +
+                  static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1);
+
+  std::string error;
+  for (std::size_t line_number = 3; !text.empty(); ++line_number) {
+    const std::string_view line = next_line(text);
+    if (line.empty()) continue;
+
+    if (parse_row(line, columns, error)) {
+      ++result.rows;
+    } else {
+      result.errors.push_back({line_number, std::move(error)});
+    }
+  }
+  return result;
+}
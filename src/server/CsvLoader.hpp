@@ -0,0 +1,32 @@
+#ifndef CSV_LOADER_HPP
+#define CSV_LOADER_HPP
+
+#include "StockStore.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CsvError {
+  std::size_t line;  // 1-based
+  std::string message;
+};
+
+struct CsvParseResult {
+  std::string symbol;
+  std::size_t rows = 0;  // rows appended to the columns
+  std::vector<CsvError> errors;
+};
+
+// Parses a price CSV in place:
+//
+//   SYMBOL
+//   Date,Adj Close,Close,High,Low,Open,Volume
+//   2020-09-21,107.07,110.08,110.19,103.09,104.54,195713800
+//   ...
+//
+// Valid rows are appended to `columns`; malformed rows are skipped and
+// reported with their line number. Accepts LF and CRLF line endings.
+CsvParseResult parse_price_csv(std::string_view text, PriceColumns &columns);
+
+#endif
@@ -0,0 +1,156 @@
+#include "FanoutBus.hpp"
+#include <algorithm>
+#include <chrono>
+
+SubscriberQueue::SubscriberQueue(const FanoutOptions &options) : m_options(options) {
+  // Conflation needs a slot to overwrite.
+  if (m_options.max_queued == 0) m_options.max_queued = 1;
+}
+
+SubscriberQueue::Offer SubscriberQueue::offer(const grpc::ByteBuffer &tick) {
+  if (m_ticks.size() < m_options.max_queued) {
+    m_ticks.push_back(tick);
+    return Offer::Queued;
+  }
+
+  switch (m_options.policy) {
+    case SlowConsumerPolicy::Drop:
+      ++m_dropped;
+      return Offer::Dropped;
+    case SlowConsumerPolicy::Conflate:
+      m_ticks.back() = tick;
+      ++m_dropped;
+      return Offer::Conflated;
+    case SlowConsumerPolicy::Disconnect:
+      break;
+  }
+  return Offer::Overflow;
+}
+
+bool SubscriberQueue::pop(grpc::ByteBuffer &tick) {
+  if (m_ticks.empty()) return false;
+  tick = std::move(m_ticks.front());
+  m_ticks.pop_front();
+  return true;
+}
+
+std::size_t SubscriberQueue::size() const { return m_ticks.size(); }
+
+std::size_t SubscriberQueue::dropped() const { return m_dropped; }
+
+SymbolPublisher::SymbolPublisher(FanoutBus &bus, std::string symbol,
+                                 StockSeries rows,
+                                 grpc::CompletionQueue *cq)
+    : m_bus(bus), m_symbol(std::move(symbol)), m_rows(rows), m_cq(cq),
+      m_schedule(bus.m_data.replay(), m_symbol) {
+  m_price.set_symbol(m_symbol);
+}
+
+bool SymbolPublisher::attach(FanoutSubscriber *subscriber) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_finished) return false;
+  m_subscribers.push_back(subscriber);
+  return true;
+}
+
+void SymbolPublisher::detach(FanoutSubscriber *subscriber) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_subscribers.erase(
+      std::remove(m_subscribers.begin(), m_subscribers.end(), subscriber),
+      m_subscribers.end());
+}
+
+void SymbolPublisher::start() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  schedule_next();
+}
+
+void SymbolPublisher::stop() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopping = true;
+  if (m_self) m_alarm.Cancel();
+}
+
+void SymbolPublisher::schedule_next() {
+  m_self = shared_from_this();
+  m_alarm.Set(m_cq, system_deadline(m_schedule.next(m_rows[m_next].epoch_day())), &m_tag);
+}
+
+void SymbolPublisher::on_tick(bool ok) {
+  std::shared_ptr<SymbolPublisher> self;  // keeps *this alive until we return
+  bool finished = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    self = std::move(m_self);
+
+    if (!ok || m_stopping || m_subscribers.empty()) {
+      m_finished = true;
+      finished = true;
+    } else {
+      fill_price(m_price, m_rows[m_next], m_next + 1);
+
+      // Encoded once, shared by every subscriber.
+      grpc::ByteBuffer tick;
+      bool own_buffer = false;
+      grpc::SerializationTraits<marketdata::StockPrice>::Serialize(m_price, &tick, &own_buffer);
+
+      for (FanoutSubscriber *subscriber : m_subscribers) {
+        subscriber->publish(tick);
+      }
+
+      if (++m_next == m_rows.size()) {
+        for (FanoutSubscriber *subscriber : m_subscribers) {
+          subscriber->end_of_stream();
+        }
+        m_subscribers.clear();
+        m_finished = true;
+        finished = true;
+      } else {
+        schedule_next();
+      }
+    }
+  }
+
+  if (finished) m_bus.remove(m_symbol, this);
+}
+
+FanoutBus::FanoutBus(const MarketDataServiceImpl &data, const FanoutOptions &options)
+    : m_data(data), m_options(options) {}
+
+std::shared_ptr<SymbolPublisher> FanoutBus::attach(const std::string &symbol,
+                                                   FanoutSubscriber *subscriber,
+                                                   grpc::CompletionQueue *cq) {
+  const StockSeries rows = m_data.getStockData(symbol);
+  if (rows.empty()) return nullptr;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopped) return nullptr;
+
+  std::shared_ptr<SymbolPublisher> &publisher = m_publishers[symbol];
+  if (publisher && publisher->attach(subscriber)) {
+    return publisher;
+  }
+
+  publisher = std::make_shared<SymbolPublisher>(*this, symbol, rows, cq);
+  publisher->attach(subscriber);
+  publisher->start();
+  return publisher;
+}
+
+void FanoutBus::shutdown() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopped = true;
+  for (auto &[symbol, publisher] : m_publishers) {
+    publisher->stop();
+  }
+}
+
+const FanoutOptions &FanoutBus::options() const { return m_options; }
+
+void FanoutBus::remove(const std::string &symbol, const SymbolPublisher *publisher) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_publishers.find(symbol);
+  if (it != m_publishers.end() && it->second.get() == publisher) {
+    m_publishers.erase(it);
+  }
+}
@@ -0,0 +1,152 @@
+#ifndef FANOUT_BUS_HPP
+#define FANOUT_BUS_HPP
+
+#include "CompletionTag.hpp"
+#include "MarketDataServer.hpp"
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What to do with a subscriber whose outbound queue is full.
+enum class SlowConsumerPolicy {
+  Drop,        // discard the new tick
+  Conflate,    // replace the most recent queued tick with the new one
+  Disconnect   // cancel the subscription
+};
+
+struct FanoutOptions {
+  SlowConsumerPolicy policy = SlowConsumerPolicy::Conflate;
+  std::size_t max_queued = 64;  // ticks queued behind the in-flight Write
+};
+
+// Bounded queue of serialized ticks waiting for a subscriber's in-flight
+// Write to complete. Not thread-safe, guarded by its owner.
+class SubscriberQueue
+{
+    public:
+    enum class Offer { Queued, Dropped, Conflated, Overflow };
+
+    explicit SubscriberQueue(const FanoutOptions &options);
+
+    // Applies the slow-consumer policy when the queue is full. Overflow means
+    // that the subscriber must be disconnected; the tick is not queued.
+    Offer offer(const grpc::ByteBuffer &tick);
+
+    // Moves the oldest queued tick into `tick`. Returns false if empty.
+    bool pop(grpc::ByteBuffer &tick);
+
+    std::size_t size() const;
+    std::size_t dropped() const;
+
+    private:
+    FanoutOptions m_options;
+    std::deque<grpc::ByteBuffer> m_ticks;
+    std::size_t m_dropped = 0;
+};
+
+// Receiving end of a SymbolPublisher. Both callbacks are invoked from the
+// publisher's thread with the publisher lock held, so implementations must
+// not call back into the publisher.
+class FanoutSubscriber
+{
+    public:
+    virtual ~FanoutSubscriber() = default;
+
+    // A new tick. The buffer shares its (refcounted) slices with every other
+    // subscriber of the symbol; copying it does not copy the payload.
+    virtual void publish(const grpc::ByteBuffer &tick) = 0;
+
+    // The replay is over, no more ticks will be published.
+    virtual void end_of_stream() = 0;
+};
+
+class FanoutBus;
+
+// Replays one symbol once for all its subscribers: every tick is built and
+// serialized a single time, then handed to each attached subscriber.
+// Ticks follow the server's replay options (see ReplayClock), each one
+// waited for with a grpc::Alarm on the completion queue of the worker that
+// created the publisher.
+class SymbolPublisher : public std::enable_shared_from_this<SymbolPublisher>
+{
+    public:
+    SymbolPublisher(FanoutBus &bus, std::string symbol,
+                    StockSeries rows,
+                    grpc::CompletionQueue *cq);
+
+    // Returns false once the publisher has stopped (replay over or no more
+    // subscribers); the caller must then create a new one.
+    bool attach(FanoutSubscriber *subscriber);
+
+    // After detach() returns, the subscriber is never called again.
+    void detach(FanoutSubscriber *subscriber);
+
+    private:
+    friend class FanoutBus;
+
+    struct Tag : CompletionTag {
+      explicit Tag(SymbolPublisher *p) : publisher(p) {}
+      void proceed(bool ok) override { publisher->on_tick(ok); }
+      SymbolPublisher *publisher;
+    };
+
+    void start();
+    void stop();
+    void on_tick(bool ok);
+    void schedule_next();  // requires m_mutex
+
+    FanoutBus &m_bus;
+    const std::string m_symbol;
+    const StockSeries m_rows;
+    grpc::CompletionQueue *m_cq;
+
+    std::mutex m_mutex;
+    std::vector<FanoutSubscriber *> m_subscribers;
+    std::size_t m_next = 0;
+    bool m_finished = false;
+    bool m_stopping = false;
+
+    ReplayClock m_schedule;
+    grpc::Alarm m_alarm;
+    Tag m_tag{this};
+    std::shared_ptr<SymbolPublisher> m_self;  // alive while an alarm is pending
+    marketdata::StockPrice m_price;
+};
+
+// Registry of the live publishers, one per symbol.
+class FanoutBus
+{
+    public:
+    FanoutBus(const MarketDataServiceImpl &data, const FanoutOptions &options);
+
+    // Attaches the subscriber to the publisher of `symbol`, creating and
+    // starting it on `cq` if needed. Returns nullptr for an unknown symbol.
+    std::shared_ptr<SymbolPublisher> attach(const std::string &symbol,
+                                            FanoutSubscriber *subscriber,
+                                            grpc::CompletionQueue *cq);
+
+    // Cancels the pending alarms. Must be called before the completion
+    // queues are shut down; no publisher is started or re-armed afterwards.
+    void shutdown();
+
+    const FanoutOptions &options() const;
+
+    private:
+    friend class SymbolPublisher;
+
+    void remove(const std::string &symbol, const SymbolPublisher *publisher);
+
+    const MarketDataServiceImpl &m_data;
+    FanoutOptions m_options;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<SymbolPublisher>> m_publishers;
+    bool m_stopped = false;
+};
+
+#endif
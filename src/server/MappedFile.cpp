@@ -0,0 +1,47 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path, [[maybe_unused]] Access access) {
+#ifdef _WIN32
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) return;
+  m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  m_open = true;
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st {};
+  if (::fstat(fd, &st) == 0) {
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size == 0) {
+      m_open = true;  // mmap rejects empty mappings
+    } else {
+      void *p = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p != MAP_FAILED) {
+        ::madvise(p, m_size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        m_data = static_cast<const char *>(p);
+        m_open = true;
+      }
+    }
+  }
+  ::close(fd);  // the mapping keeps the file referenced
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (m_data) ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. Memory-mapped on POSIX systems, so that
+// processes mapping the same file share its page cache; read into a buffer
+// elsewhere.
+class MappedFile {
+ public:
+  // Expected access pattern, passed on to the kernel as read-ahead advice.
+  enum class Access { Sequential, Random };
+
+  explicit MappedFile(const std::string &path, Access access = Access::Sequential);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool is_open() const { return m_open; }
+  std::string_view data() const { return {m_data, m_size}; }
+
+ private:
+  const char *m_data = nullptr;
+  std::size_t m_size = 0;
+  bool m_open = false;
+#ifdef _WIN32
+  std::string m_buffer;
+#endif
+};
+
+#endif
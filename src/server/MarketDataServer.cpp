@@ -1,147 +1,748 @@
 #include "MarketDataServer.hpp"
+#include "CsvLoader.hpp"
+#include "MappedFile.hpp"
+#include "SharedMemoryFeed.hpp"
+#include "Snapshot.hpp"
+#include "utilities/logger.hpp"
+#include "utilities/thread_pool.hpp"
 #include <grpcpp/grpcpp.h>
+#include <algorithm>
 #include <chrono>
+#include <iostream>
 #include <mutex>
 #include <thread>
-#include <fstream>
-#include <sstream>
+#include <tuple>
+#include <utility>
 
-static std::mutex cout_mutex;
+namespace {
+
+// Formats an epoch day as a date on the logger's thread, so that per-tick
+// lines do not format dates on the stream's thread.
+struct LoggedDate {
+  std::int32_t epoch_day;
+};
+
+std::ostream &operator<<(std::ostream &out, LoggedDate date) {
+  return out << format_date(date.epoch_day);
+}
+
+}  // namespace
 
 void MarketDataServiceImpl::load_data(const std::string &filepath)
 {
-    std::ifstream file(filepath);
+    const auto start = ServerMetrics::clock::now();
+    MappedFile file(filepath);
 
     if (!file.is_open()) {
         std::cout << "Failed to open file: " << filepath << "\n";
         return;
     }
 
-    std::string line;
+    PriceColumns columns;
+    CsvParseResult result = parse_price_csv(file.data(), columns);
 
-    // First line: symbol
-    std::string symbol;
-    if (!std::getline(file, symbol)) {
-        std::cerr << "File empty: " << filepath << "\n";
-        return;
+    // Malformed rows are skipped; report the first few.
+    constexpr std::size_t max_reported = 10;
+    for (std::size_t i = 0; i < result.errors.size() && i < max_reported; ++i) {
+        std::cerr << filepath << ":" << result.errors[i].line << ": "
+                  << result.errors[i].message << "\n";
+    }
+    if (result.errors.size() > max_reported) {
+        std::cerr << filepath << ": " << result.errors.size() - max_reported
+                  << " more malformed rows\n";
     }
 
-    // Second line: header -> skip
-    std::getline(file, line);
-
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-
-        std::stringstream ss(line);
-        std::string date;
-        std::string tmp;
-        
-        //DATE
-        std::getline(ss, date, ',');
-        //ADJ CLOSE
-        std::getline(ss, tmp, ',');
-        double adj_close = std::stod(tmp);
-        //CLOSE        
-        std::getline(ss, tmp, ',');
-        double close = std::stod(tmp);
-        //HIGH
-        std::getline(ss, tmp, ',');
-        double high = std::stod(tmp);
-        //LOW
-        std::getline(ss, tmp, ',');
-        double low = std::stod(tmp);
-        //OPEN
-        std::getline(ss, tmp, ',');
-        double open = std::stod(tmp);
-        //VOLUME
-        std::getline(ss, tmp, ',');
-        long volume = std::stol(tmp);
-
-        m_stock_data[symbol].emplace_back(StockData(date, adj_close, close, high, low, open, volume));
-    }
-
-    /*
-    for (const auto &[symbol, stock_data] : m_stock_data) {
-      std::cout << "Symbol: " << symbol << std::endl;
-      for (auto const &data : stock_data) {
-        std::cout <<
-        "Date: "      << data.date()      << ", " <<
-        "Adj Close: " << data.adj_close() << ", " <<
-        "Close: "     << data.close()     << ", " <<
-        "High: "      << data.high()      << ", " <<
-        "Low: "       << data.low()       << ", " <<
-        "Open: "      << data.open()      << ", " <<
-        "Volume: "    << data.volume()    << std::endl;
-      }
+    if (result.symbol.empty()) return;
+    const std::size_t rows = columns.date.size();
+    m_stock_data.add(result.symbol, std::move(columns));
+    m_bars.update(result.symbol, m_stock_data.series(result.symbol));
+    m_metrics.record_load(filepath, rows, ServerMetrics::clock::now() - start);
+
+    // Taking the lock orders the publication with a waiter's predicate check.
+    { std::lock_guard<std::mutex> lock(m_load_mutex); }
+    m_loaded.notify_all();
+}
+
+void MarketDataServiceImpl::begin_loading()
+{
+    std::lock_guard<std::mutex> lock(m_load_mutex);
+    ++m_loads_in_progress;
+}
+
+void MarketDataServiceImpl::end_loading()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_load_mutex);
+        if (m_loads_in_progress > 0) --m_loads_in_progress;
+    }
+    m_loaded.notify_all();
+}
+
+void MarketDataServiceImpl::load_files(const std::vector<std::string> &files,
+                                       util::thread_pool &pool)
+{
+    begin_loading();
+
+    std::vector<std::future<void>> loaded;
+    loaded.reserve(files.size());
+    for (const auto &file : files) {
+        loaded.push_back(pool.ExecuteTask([this, &file] { load_data(file); }));
+    }
+    for (auto &f : loaded) {
+        if (f.valid()) f.wait();
     }
-    */
+
+    end_loading();
+}
+
+bool MarketDataServiceImpl::save_snapshot(const std::string &path,
+                                          const std::vector<SnapshotSource> &sources) const
+{
+    std::string error;
+    if (!write_snapshot(m_stock_data, sources, path, error)) {
+        std::cerr << "Failed to write snapshot " << path << ": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool MarketDataServiceImpl::load_snapshot(const std::string &path, bool verify_data)
+{
+    const auto start = ServerMetrics::clock::now();
+    begin_loading();
+    std::string error;
+    std::shared_ptr<const Snapshot> snapshot = Snapshot::open(path, verify_data, error);
+    if (!snapshot) {
+        std::cerr << "Ignoring snapshot " << path << ": " << error << "\n";
+        end_loading();
+        return false;
+    }
+
+    std::size_t rows = 0;
+    for (std::size_t i = 0; i < snapshot->size(); ++i) {
+        StockSeries series = snapshot->series(i);
+        rows += series.size();
+        const std::string symbol(snapshot->symbol(i));
+        m_stock_data.add(symbol, std::move(series));
+        m_bars.update(symbol, m_stock_data.series(symbol));
+    }
+    m_metrics.record_load(path, rows, ServerMetrics::clock::now() - start);
+    end_loading();
+    return true;
+}
+
+bool MarketDataServiceImpl::loading() const {
+  std::lock_guard<std::mutex> lock(m_load_mutex);
+  return m_loads_in_progress > 0;
+}
+
+void MarketDataServiceImpl::set_replay(const ReplayOptions &replay) {
+  m_replay = replay;
+}
+
+void MarketDataServiceImpl::set_shared_memory(SharedMemoryFeed *feed) {
+  m_shared_memory = feed;
+}
+
+std::int64_t wall_clock_ns() {
+  // system_clock: high_resolution_clock is not tied to the epoch everywhere,
+  // and clients compare the timestamps with their own wall clock.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void fill_price(marketdata::StockPrice &price, const StockData &row, std::uint64_t seq) {
+  price.set_adjustedclose(row.adj_close());
+  price.set_close(row.close());
+  price.set_high(row.high());
+  price.set_low(row.low());
+  price.set_open(row.open());
+  price.set_volume(row.volume());
+  price.set_epoch_day(row.epoch_day());
+  price.set_timestamp_ns(wall_clock_ns());
+  price.set_seq(seq);
+}
+
+void fill_price(marketdata::StockPrice &price, const StockData &row, std::uint64_t seq,
+                CompactEncoder *compact) {
+  if (compact) {
+    compact->encode(0, row, wall_clock_ns(), *price.mutable_compact(), seq);
+  } else {
+    fill_price(price, row, seq);
+  }
+}
+
+PriceMessage::PriceMessage(const std::string &symbol, marketdata::Encoding encoding) {
+  if (encoding == marketdata::COMPACT) {
+    m_compact.emplace();
+  } else {
+    m_price.set_symbol(symbol);
+  }
+}
+
+const marketdata::StockPrice &PriceMessage::fill(const StockData &row, std::size_t i,
+                                                 const IndicatorSet &indicators) {
+  fill_price(m_price, row, i + 1, m_compact ? &*m_compact : nullptr);
+  if (!indicators.empty()) {
+    indicators.fill(i, m_compact ? *m_price.mutable_compact()->mutable_indicators()
+                                 : *m_price.mutable_indicators());
+  }
+  return m_price;
+}
+
+std::size_t resume_row(const StockSeries &series, std::uint64_t after_seq, std::int32_t from_day) {
+  // Sequence numbers are positions, so only the day needs a search.
+  const auto after = static_cast<std::size_t>(std::min<std::uint64_t>(after_seq, series.size()));
+  const std::size_t from =
+      series.rows_between(from_day, std::numeric_limits<std::int32_t>::max()).first;
+  return std::max(after, from);
+}
+
+std::uint64_t resume_seq(const marketdata::MultiStockRequest &request, const std::string &symbol) {
+  const auto it = request.start_after_seq().find(symbol);
+  return it != request.start_after_seq().end() ? it->second : 0;
+}
+
+bool check_follow(bool follow, const BarSpec &bars, std::string &error) {
+  if (follow && bars.any()) {
+    error = "Only rows can be followed, not bars";
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> requested_symbols(const marketdata::MultiStockRequest &request) {
+  std::vector<std::string> symbols;
+  for (const std::string &symbol : request.symbols()) {
+    if (std::find(symbols.begin(), symbols.end(), symbol) == symbols.end()) {
+      symbols.push_back(symbol);
+    }
+  }
+  return symbols;
+}
+
+namespace {
+
+std::vector<std::size_t> sizes(const std::vector<StockSeries> &series) {
+  std::vector<std::size_t> out;
+  out.reserve(series.size());
+  for (const StockSeries &s : series) out.push_back(s.size());
+  return out;
+}
+
+}  // namespace
+
+MultiSymbolStream::MultiSymbolStream(std::vector<std::string> symbols,
+                                     std::vector<StockSeries> series,
+                                     std::uint32_t max_batch,
+                                     marketdata::Encoding encoding,
+                                     std::vector<IndicatorSet> indicators,
+                                     std::vector<std::size_t> starts)
+    : m_symbols(std::move(symbols)),
+      m_ends(sizes(series)),
+      m_merge(std::move(series), std::move(starts)),
+      m_max_batch(max_batch == 0 ? kDefaultMaxBatch : std::min(max_batch, kMaxBatch)),
+      m_indicators(std::move(indicators)) {
+  if (encoding == marketdata::COMPACT) m_compact.emplace(m_symbols.size());
+}
+
+bool MultiSymbolStream::extend(std::vector<StockSeries> series,
+                               std::vector<IndicatorSet> indicators) {
+  bool grew = false;
+  for (std::size_t i = 0; i < series.size() && i < m_ends.size(); ++i) {
+    grew = grew || series[i].size() > m_ends[i];
+  }
+  if (!grew) return false;
+
+  // The encoder is kept: the client's decoder continues from the last rows.
+  std::vector<std::size_t> starts = std::exchange(m_ends, sizes(series));
+  m_merge = SeriesMerge(std::move(series), std::move(starts));
+  if (!m_indicators.empty()) m_indicators = std::move(indicators);
+  return true;
+}
+
+void MultiSymbolStream::next_batch(marketdata::StockPriceBatch &batch, bool span_days) {
+  // Clear() keeps the messages for reuse.
+  auto &prices = *batch.mutable_prices();
+  auto &compact_prices = *batch.mutable_compact_prices();
+  prices.Clear();
+  compact_prices.Clear();
+  m_sources.clear();
+  if (m_merge.done()) return;
+
+  const std::int32_t day = m_merge.epoch_day();
+  for (std::uint32_t n = 0; n < m_max_batch && !m_merge.done() &&
+                            (span_days || m_merge.epoch_day() == day);
+       ++n, m_merge.next()) {
+    const auto source = static_cast<std::uint32_t>(m_merge.source());
+    m_sources.push_back(source);
+    marketdata::Indicators *indicators = nullptr;
+    if (m_compact) {
+      marketdata::CompactPrice *compact = compact_prices.Add();
+      m_compact->encode(source, m_merge.row(), wall_clock_ns(), *compact,
+                        m_merge.position() + 1);
+      if (!m_indicators.empty()) indicators = compact->mutable_indicators();
+    } else {
+      marketdata::StockPrice *price = prices.Add();
+      price->set_symbol(m_symbols[source]);
+      fill_price(*price, m_merge.row(), m_merge.position() + 1);
+      if (!m_indicators.empty()) indicators = price->mutable_indicators();
+    }
+    if (indicators) m_indicators[source].fill(m_merge.position(), *indicators);
+  }
+}
+
+const ReplayOptions &MarketDataServiceImpl::replay() const {
+  return m_replay;
+}
+
+bool parse_range_query(const marketdata::RangeRequest &request, RangeQuery &query,
+                       std::string &error) {
+  if (!request.from_date().empty()) {
+    const auto day = parse_date(request.from_date());
+    if (!day) {
+      error = "Invalid from_date: " + request.from_date();
+      return false;
+    }
+    query.first_day = *day;
+  }
+  if (!request.to_date().empty()) {
+    const auto day = parse_date(request.to_date());
+    if (!day) {
+      error = "Invalid to_date: " + request.to_date();
+      return false;
+    }
+    query.last_day = *day;
+  }
+  if (query.first_day > query.last_day) {
+    error = "from_date is after to_date";
+    return false;
+  }
+
+  query.columns = 0;
+  for (const int column : request.columns()) {
+    if (column == marketdata::RangeRequest::COLUMN_UNSPECIFIED ||
+        !marketdata::RangeRequest::Column_IsValid(column)) {
+      error = "Invalid column: " + std::to_string(column);
+      return false;
+    }
+    query.columns |= 1u << column;
+  }
+  if (query.columns == 0) {
+    for (int column = marketdata::RangeRequest::ADJ_CLOSE;
+         column <= marketdata::RangeRequest::VOLUME; ++column) {
+      query.columns |= 1u << column;
+    }
+  }
+
+  query.chunk_rows = request.max_rows() == 0
+                         ? RangeQuery::kDefaultChunkRows
+                         : std::min(request.max_rows(), RangeQuery::kMaxChunkRows);
+  return true;
+}
+
+RangeCursor::RangeCursor(StockSeries series, const RangeQuery &query)
+    : m_series(std::move(series)), m_query(query) {
+  std::tie(m_begin, m_end) = m_series.rows_between(query.first_day, query.last_day);
+  m_next = m_begin;
+}
+
+namespace {
+
+// Copies rows [first, last) of `column` into `out`, in one go.
+template <class T, class Field>
+void copy_column(std::span<const T> column, std::size_t first, std::size_t last, Field &out) {
+  out.Clear();
+  out.Add(column.begin() + first, column.begin() + last);
 }
 
-const std::unordered_map<std::string, std::vector<StockData>> &
-MarketDataServiceImpl::getStockData() const {
+}  // namespace
+
+void RangeCursor::next_chunk(marketdata::RangeChunk &chunk) {
+  using Request = marketdata::RangeRequest;
+  const std::size_t first = m_next;
+  const std::size_t last = std::min<std::size_t>(m_end, first + m_query.chunk_rows);
+  m_next = last;
+
+  // Clear() keeps the capacity of the repeated fields for the next chunk.
+  chunk.Clear();
+  const PriceColumnsView &columns = m_series.columns();
+  copy_column(columns.date, first, last, *chunk.mutable_epoch_day());
+  if (m_query.has(Request::ADJ_CLOSE)) {
+    copy_column(columns.adj_close, first, last, *chunk.mutable_adjusted_close());
+  }
+  if (m_query.has(Request::CLOSE)) copy_column(columns.close, first, last, *chunk.mutable_close());
+  if (m_query.has(Request::HIGH)) copy_column(columns.high, first, last, *chunk.mutable_high());
+  if (m_query.has(Request::LOW)) copy_column(columns.low, first, last, *chunk.mutable_low());
+  if (m_query.has(Request::OPEN)) copy_column(columns.open, first, last, *chunk.mutable_open());
+  if (m_query.has(Request::VOLUME)) {
+    copy_column(columns.volume, first, last, *chunk.mutable_volume());
+  }
+}
+
+ServerMetrics &MarketDataServiceImpl::metrics() const {
+  return m_metrics;
+}
+
+IndicatorSet MarketDataServiceImpl::indicators(const StockSeries &series,
+                                               const IndicatorWindows &windows) const {
+  return m_indicators.get(series, windows);
+}
+
+StockSeries MarketDataServiceImpl::bars(const std::string &symbol, const StockSeries &series,
+                                        const BarSpec &spec) const {
+  if (!spec.any() || series.empty()) return series;
+  return m_bars.bars(symbol, series, spec);
+}
+
+const StockStore &MarketDataServiceImpl::getStockData() const {
   return  m_stock_data;
 }
 
-const std::vector<StockData> &MarketDataServiceImpl::getStockData(
-    const std::string &symbol) const {
-  static const std::vector<StockData> empty;
-  auto it = m_stock_data.find(symbol);
-  return (it != m_stock_data.end()) ? it->second : empty;
+StockSeries MarketDataServiceImpl::getStockData(const std::string &symbol) const {
+  return m_stock_data.series(symbol);
+}
+
+StockSeries MarketDataServiceImpl::waitForStockData(const std::string &symbol,
+                                                    std::chrono::milliseconds timeout) const {
+  StockSeries stocks;
+  std::unique_lock<std::mutex> lock(m_load_mutex);
+  m_loaded.wait_for(lock, timeout, [&] {
+    stocks = m_stock_data.series(symbol);
+    return !stocks.empty() || m_loads_in_progress == 0;
+  });
+  return stocks;
+}
+
+std::uint64_t MarketDataServiceImpl::publications() const {
+  std::lock_guard<std::mutex> lock(m_load_mutex);
+  return m_publications;
+}
+
+void MarketDataServiceImpl::waitForPublication(std::uint64_t seen,
+                                               std::chrono::milliseconds timeout) const {
+  std::unique_lock<std::mutex> lock(m_load_mutex);
+  m_loaded.wait_for(lock, timeout, [&] { return m_publications > seen; });
+}
+
+bool MarketDataServiceImpl::follow(MultiSymbolStream &stream,
+                                   const std::vector<StockStore::Handle> &symbols,
+                                   const IndicatorWindows &windows) const {
+  std::vector<StockSeries> series;
+  std::vector<IndicatorSet> indicators;
+  for (const auto &symbol : symbols) {
+    series.push_back(symbol.latest());
+    if (windows.any()) indicators.push_back(this->indicators(series.back(), windows));
+  }
+  return stream.extend(std::move(series), std::move(indicators));
+}
+
+bool MarketDataServiceImpl::publish(const marketdata::StockPriceBatch &batch, std::size_t &rows,
+                                    std::string &error) {
+  if (batch.compact_prices_size() > 0) {
+    error = "Publish takes FULL prices";
+    return false;
+  }
+
+  // The rows of each symbol, in the order of the message.
+  std::vector<StockStore::SymbolRows> symbols;
+  for (const auto &price : batch.prices()) {
+    if (price.symbol().empty()) {
+      error = "Published row without a symbol";
+      return false;
+    }
+    auto it = std::find_if(symbols.begin(), symbols.end(),
+                           [&](const auto &entry) { return entry.first == price.symbol(); });
+    if (it == symbols.end()) it = symbols.emplace(symbols.end(), price.symbol(), PriceColumns());
+    it->second.append(StockData(price.epoch_day(), price.adjustedclose(), price.close(),
+                                price.high(), price.low(), price.open(), price.volume()));
+  }
+
+  std::vector<std::pair<std::string, std::size_t>> counts;
+  for (const auto &[symbol, columns] : symbols) counts.emplace_back(symbol, columns.size());
+  // All the symbols or none.
+  if (!m_stock_data.append(std::move(symbols), error)) return false;
+
+  for (const auto &[symbol, n] : counts) {
+    m_bars.update(symbol, m_stock_data.series(symbol));
+    m_metrics.record_publish(symbol, n);
+    rows += n;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_load_mutex);
+    ++m_publications;
+  }
+  m_loaded.notify_all();
+  return true;
+}
+
+grpc::Status MarketDataServiceImpl::Publish(grpc::ServerContext *,
+                                            grpc::ServerReader<marketdata::StockPriceBatch> *reader,
+                                            marketdata::PublishReply *reply)
+{
+  marketdata::StockPriceBatch batch;
+  std::size_t rows = 0;
+  std::string error;
+  while (reader->Read(&batch)) {
+    if (!publish(batch, rows, error)) {
+      UTIL_LOG(info, "[Server] Publish rejected after {} rows: {}", rows, error);
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+    }
+  }
+  reply->set_rows(rows);
+  UTIL_LOG(info, "[Server] Published {} rows", rows);
+  return grpc::Status::OK;
 }
 
 grpc::Status MarketDataServiceImpl::Subscribe(
     grpc::ServerContext *context, const marketdata::StockRequest *request,
     grpc::ServerWriter<marketdata::StockPrice> *writer)
 {
-  std::cout << "[Server] Client subscribed to: " << request->symbol() << "\n";
+  ReplayOptions replay;
+  std::string error;
+  IndicatorWindows windows;
+  BarSpec bar;
+  if (!replay_for(m_replay, request->replay(), replay, error) ||
+      !indicator_windows(request->indicators(), windows, error) ||
+      !bar_spec(request->resolution(), request->bar_rows(), bar, error) ||
+      !check_follow(request->follow(), bar, error)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+  }
+
+  UTIL_LOG(info, "[Server] Client subscribed to: {}", request->symbol());
 
-  // Random number generator for generating delays
-  std::mt19937 rng(std::random_device{}());
+  StockSeries stocks = getStockData(request->symbol());
 
-  const std::vector<StockData>& stocks = getStockData(request->symbol());
+  // The symbol may not be loaded yet.
+  while (stocks.empty() && loading() && !context->IsCancelled()) {
+    stocks = waitForStockData(request->symbol(), std::chrono::milliseconds(100));
+  }
 
   if (stocks.empty()) {
     return grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found");
   }
+  stocks = bars(request->symbol(), stocks, bar);
+
+  // This engine parks its thread on every stream by design; the async
+  // engine schedules the same deadlines on a timer wheel.
+  IndicatorSet indicators = this->indicators(stocks, windows);
+  ServerMetrics::Stream active(m_metrics);
+  const ServerMetrics::Symbol sent = m_metrics.symbol(request->symbol());
 
-  for (const auto &stock_data : stocks) {
-    if (context->IsCancelled()) break;
+  ReplayClock schedule(replay, request->symbol());
+  PriceMessage message(request->symbol(), request->encoding());
+  const StockStore::Handle symbol = m_stock_data.handle(request->symbol());
+  std::size_t i = resume_row(stocks, request->start_after_seq(), request->start_epoch_day());
+  bool live = false;  // following: rows are sent as they are published
+  for (; !context->IsCancelled(); ++i) {
+    // Following: waits for rows published after the last one sent.
+    while (i == stocks.size() && request->follow() && !context->IsCancelled()) {
+      const std::uint64_t seen = publications();
+      StockSeries latest = symbol.latest();
+      if (latest.size() <= i) {
+        waitForPublication(seen, std::chrono::milliseconds(100));
+        continue;
+      }
+      stocks = std::move(latest);
+      indicators = this->indicators(stocks, windows);
+      live = true;
+    }
+    if (i == stocks.size() || context->IsCancelled()) break;
 
-    marketdata::StockPrice price;
-    auto now_ns =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch())
-            .count();
+    const StockData stock_data = stocks[i];
+    if (!live) {
+      const auto due = schedule.next(stock_data.epoch_day());
+      if (due > ReplayClock::clock::now()) std::this_thread::sleep_until(due);
+    }
 
-    price.set_symbol(request->symbol());
-    price.set_adjustedclose(stock_data.adj_close());
-    price.set_close(stock_data.close());
-    price.set_high(stock_data.high());
-    price.set_low(stock_data.low());
-    price.set_open(stock_data.open());
-    price.set_volume(stock_data.volume());
-    price.set_timestamp_ns(now_ns);
+    const marketdata::StockPrice &price = message.fill(stock_data, i, indicators);
+    const auto write_start = ServerMetrics::clock::now();
+    if (!writer->Write(price)) break;
+    m_metrics.record_write(ServerMetrics::clock::now() - write_start);
+    // Write() serialized the message, which cached its size.
+    sent.sent(1, static_cast<std::size_t>(price.GetCachedSize()));
+    UTIL_LOG(debug, "[Server] Sent update for {}, Date: {}, Adj Close: {}, Close: {}, "
+                    "High: {}, Low: {}, Open: {}, Volume: {}",
+             request->symbol(), LoggedDate{stock_data.epoch_day()}, stock_data.adj_close(),
+             stock_data.close(), stock_data.high(), stock_data.low(), stock_data.open(),
+             stock_data.volume());
+  }
 
-    std::uniform_real_distribution<double> time_ms(100., 1000.);
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(static_cast<int>(time_ms(rng))));
+  if (context->IsCancelled()) active.cancelled();
+  UTIL_LOG(info, "[Server] Subscription ended for: {}", request->symbol());
 
-    writer->Write(price);
-    {
-      std::lock_guard<std::mutex> lock(cout_mutex);
-      std::cout << "[Server] Sent update for " << request->symbol() << ", " <<
-        "Date: "      << stock_data.date()      << ", " <<
-        "Adj Close: " << price.adjustedclose()  << ", " <<
-        "Close: "     << price.close()     << ", " <<
-        "High: "      << price.high()      << ", " <<
-        "Low: "       << price.low()       << ", " <<
-        "Open: "      << price.open()      << ", " <<
-        "Volume: "    << price.volume()    << std::endl;
+  return grpc::Status::OK;
+}
+
+grpc::Status MarketDataServiceImpl::SubscribeMany(
+    grpc::ServerContext *context, const marketdata::MultiStockRequest *request,
+    grpc::ServerWriter<marketdata::StockPriceBatch> *writer)
+{
+  std::vector<std::string> symbols = requested_symbols(*request);
+  if (symbols.empty()) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "No symbols requested");
+  }
+
+  ReplayOptions replay;
+  std::string error;
+  IndicatorWindows windows;
+  BarSpec bar;
+  if (!replay_for(m_replay, request->replay(), replay, error) ||
+      !indicator_windows(request->indicators(), windows, error) ||
+      !bar_spec(request->resolution(), request->bar_rows(), bar, error) ||
+      !check_follow(request->follow(), bar, error)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+  }
+
+  UTIL_LOG(info, "[Server] Client subscribed to {} symbols", symbols.size());
+
+  std::vector<StockSeries> series;
+  std::vector<IndicatorSet> indicators;
+  std::vector<std::size_t> starts;
+  for (const auto &symbol : symbols) {
+    StockSeries stocks = getStockData(symbol);
+    while (stocks.empty() && loading() && !context->IsCancelled()) {
+      stocks = waitForStockData(symbol, std::chrono::milliseconds(100));
+    }
+    if (stocks.empty()) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found: " + symbol);
+    }
+    stocks = bars(symbol, stocks, bar);
+    if (windows.any()) indicators.push_back(this->indicators(stocks, windows));
+    starts.push_back(
+        resume_row(stocks, resume_seq(*request, symbol), request->start_epoch_day()));
+    series.push_back(std::move(stocks));
+  }
+
+  ServerMetrics::Stream active(m_metrics);
+  std::vector<ServerMetrics::Symbol> sent;
+  for (const auto &symbol : symbols) sent.push_back(m_metrics.symbol(symbol));
+
+  ReplayClock schedule(replay, symbols.front());
+  MultiSymbolStream stream(std::move(symbols), std::move(series), request->max_batch(),
+                           request->encoding(), std::move(indicators), std::move(starts));
+  const bool span_days = replay.mode == ReplayMode::Afap;
+  marketdata::StockPriceBatch batch;
+  std::vector<StockStore::Handle> followed;
+  if (request->follow()) {
+    for (const auto &symbol : stream.symbols()) followed.push_back(m_stock_data.handle(symbol));
+  }
+
+  bool live = false;  // following: rows are sent as they are published
+  while (!context->IsCancelled()) {
+    if (stream.done()) {
+      if (!request->follow()) break;
+      const std::uint64_t seen = publications();
+      if (!follow(stream, followed, windows)) {
+        waitForPublication(seen, std::chrono::milliseconds(100));
+        continue;
+      }
+      live = true;
     }
+    if (!live) {
+      const auto due = schedule.next(stream.epoch_day());
+      if (due > ReplayClock::clock::now()) std::this_thread::sleep_until(due);
+    }
+    stream.next_batch(batch, span_days || live);
+    const auto write_start = ServerMetrics::clock::now();
+    if (!writer->Write(batch)) break;
+    m_metrics.record_write(ServerMetrics::clock::now() - write_start);
+    ServerMetrics::count_batch(sent, stream.sources(), batch);
+  }
+
+  if (context->IsCancelled() || !stream.done()) active.cancelled();
+  UTIL_LOG(info, "[Server] Multi-symbol subscription ended");
+  return grpc::Status::OK;
+}
+
+grpc::Status MarketDataServiceImpl::QueryRange(
+    grpc::ServerContext *context, const marketdata::RangeRequest *request,
+    grpc::ServerWriter<marketdata::RangeChunk> *writer)
+{
+  RangeQuery query;
+  std::string error;
+  if (!parse_range_query(*request, query, error)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+  }
+
+  StockSeries stocks = getStockData(request->symbol());
+  while (stocks.empty() && loading() && !context->IsCancelled()) {
+    stocks = waitForStockData(request->symbol(), std::chrono::milliseconds(100));
   }
+  if (stocks.empty()) {
+    return grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found");
+  }
+
+  ServerMetrics::Stream active(m_metrics);
+  const ServerMetrics::Symbol sent = m_metrics.symbol(request->symbol());
+  RangeCursor cursor(std::move(stocks), query);
+  UTIL_LOG(info, "[Server] Range query of {} rows of {}", cursor.rows(), request->symbol());
+
+  marketdata::RangeChunk chunk;
+  while (!cursor.done() && !context->IsCancelled()) {
+    cursor.next_chunk(chunk);
+    const auto write_start = ServerMetrics::clock::now();
+    if (!writer->Write(chunk)) break;
+    m_metrics.record_write(ServerMetrics::clock::now() - write_start);
+    sent.sent(static_cast<std::size_t>(chunk.epoch_day_size()),
+              static_cast<std::size_t>(chunk.GetCachedSize()));
+  }
+  if (!cursor.done()) active.cancelled();
+  return grpc::Status::OK;
+}
+
+grpc::Status MarketDataServiceImpl::GetStats(grpc::ServerContext *,
+                                             const marketdata::StatsRequest *request,
+                                             marketdata::StatsReply *reply)
+{
+  m_metrics.fill(request->prefix(), *reply);
+  return grpc::Status::OK;
+}
 
-  std::cout << "[Server] Subscription ended for: " << request->symbol()
-            << std::endl;
+grpc::Status MarketDataServiceImpl::SubscribeSharedMemory(grpc::ServerContext *context,
+                                                          const marketdata::SharedMemoryRequest *request,
+                                                          marketdata::SharedMemoryReply *reply)
+{
+  return subscribe_shared_memory(context, *request, *reply);
+}
+
+grpc::Status MarketDataServiceImpl::subscribe_shared_memory(
+    grpc::ServerContext *context, const marketdata::SharedMemoryRequest &request,
+    marketdata::SharedMemoryReply &reply) const
+{
+  if (!m_shared_memory) {
+    return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                        "Shared-memory transport not enabled");
+  }
+  if (request.symbols().empty()) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "No symbols requested");
+  }
 
+  // Every symbol is found before any replay starts.
+  std::vector<StockSeries> series;
+  for (const std::string &symbol : request.symbols()) {
+    StockSeries stocks = getStockData(symbol);
+    while (stocks.empty() && loading() && !context->IsCancelled()) {
+      stocks = waitForStockData(symbol, std::chrono::milliseconds(100));
+    }
+    if (stocks.empty()) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found: " + symbol);
+    }
+    series.push_back(std::move(stocks));
+  }
+
+  for (int i = 0; i < request.symbols_size(); ++i) {
+    UTIL_LOG(info, "[Server] Client subscribed to {} over shared memory", request.symbols(i));
+    std::uint32_t ring = 0;
+    std::uint64_t position = 0;
+    const grpc::Status status =
+        m_shared_memory->subscribe(request.symbols(i), series[i], ring, position);
+    if (!status.ok()) return status;
+    reply.add_rings(ring);
+    reply.add_positions(position);
+  }
+  reply.set_segment(m_shared_memory->name());
   return grpc::Status::OK;
-}
\ No newline at end of file
+}
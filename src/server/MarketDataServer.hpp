@@ -2,37 +2,151 @@
 #define MARKET_DATA_SERVER_HPP
 
 #include "marketdata.grpc.pb.h"
+#include "Analytics.hpp"
+#include "Bars.hpp"
+#include "CompactEncoder.hpp"
+#include "Replay.hpp"
+#include "ServerMetrics.hpp"
+#include "Snapshot.hpp"
+#include "StockStore.hpp"
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <vector>
 
-class StockData {
+namespace util { class thread_pool; }
+class SharedMemoryFeed;
+
+// Wall-clock time in nanoseconds since the epoch, the timestamp of updates.
+std::int64_t wall_clock_ns();
+
+// Sets the fields of `price` (except the symbol) from `row`, stamped with
+// the current time. `seq` is the sequence number of the row, i.e. its index
+// in the symbol's history + 1.
+void fill_price(marketdata::StockPrice &price, const StockData &row, std::uint64_t seq);
+
+// Same, in the encoding of a single-symbol subscription: only `compact` is
+// set if the subscription negotiated COMPACT (`compact` is its encoder).
+void fill_price(marketdata::StockPrice &price, const StockData &row, std::uint64_t seq,
+                CompactEncoder *compact);
+
+// The StockPrice message of a single-symbol stream, reused for every row.
+// The symbol is set once and every other field is overwritten per row, so
+// after the first row filling the message allocates nothing.
+class PriceMessage {
+ public:
+  PriceMessage(const std::string &symbol, marketdata::Encoding encoding);
+
+  // The message of row `i` of the stream (sequence number i + 1), with its
+  // indicators if `indicators` has some.
+  const marketdata::StockPrice &fill(const StockData &row, std::size_t i,
+                                     const IndicatorSet &indicators);
+
+ private:
+  marketdata::StockPrice m_price;
+  std::optional<CompactEncoder> m_compact;
+};
+
+// Index of the first row of a resumed stream: the row after sequence number
+// `after_seq`, or the first row of trading day `from_day` or later (binary
+// search on the dates) if that comes later. series.size() if none is left.
+std::size_t resume_row(const StockSeries &series, std::uint64_t after_seq, std::int32_t from_day);
+
+// Returns false with `error` set if a stream asks to follow bars: only rows
+// are published.
+bool check_follow(bool follow, const BarSpec &bars, std::string &error);
+
+// The symbols of a SubscribeMany request, without duplicates, in order.
+std::vector<std::string> requested_symbols(const marketdata::MultiStockRequest &request);
+
+// The start_after_seq of `symbol` in a SubscribeMany request (0 if none).
+std::uint64_t resume_seq(const marketdata::MultiStockRequest &request, const std::string &symbol);
+
+// Position in a SubscribeMany stream: the rows of its symbols merged in
+// date order, cut into StockPriceBatch messages.
+class MultiSymbolStream {
+ public:
+  static constexpr std::uint32_t kDefaultMaxBatch = 64;
+  static constexpr std::uint32_t kMaxBatch = 1024;
+
+  MultiSymbolStream() = default;
+  // `series[i]` is the history of `symbols[i]`; `max_batch` 0 means the default.
+  // `indicators`, if not empty, holds the indicators to send for each symbol;
+  // `starts`, if not empty, the first row to send of each symbol.
+  MultiSymbolStream(std::vector<std::string> symbols, std::vector<StockSeries> series,
+                    std::uint32_t max_batch, marketdata::Encoding encoding = marketdata::FULL,
+                    std::vector<IndicatorSet> indicators = {},
+                    std::vector<std::size_t> starts = {});
+
+  bool done() const { return m_merge.done(); }
+  // Trading day of the next row. Requires !done().
+  std::int32_t epoch_day() const { return m_merge.epoch_day(); }
+
+  // Replaces the content of `batch` with the next rows: at most max_batch
+  // of them, all of the same trading day unless `span_days` (i.e. when the
+  // stream is replayed as fast as possible). The messages of `batch` are reused. Under COMPACT
+  // the rows go to compact_prices, with the index of `symbols` as id.
+  void next_batch(marketdata::StockPriceBatch &batch, bool span_days);
+
+  // The index in `symbols` of each row of the last batch.
+  const std::vector<std::uint32_t> &sources() const { return m_sources; }
+
+  const std::vector<std::string> &symbols() const { return m_symbols; }
+
+  // Continues a done stream with the rows added to its series since: `series`
+  // are newer versions of them, in the same order, and `indicators` (if the
+  // stream has some) their indicators. Returns false, leaving the stream
+  // as it is, if no series has more rows.
+  bool extend(std::vector<StockSeries> series, std::vector<IndicatorSet> indicators = {});
+
+ private:
+  std::vector<std::string> m_symbols;
+  std::vector<std::size_t> m_ends;  // rows of each series
+  std::vector<std::uint32_t> m_sources;
+  SeriesMerge m_merge;
+  std::uint32_t m_max_batch = kDefaultMaxBatch;
+  std::optional<CompactEncoder> m_compact;
+  std::vector<IndicatorSet> m_indicators;
+};
+
+// A parsed QueryRange request.
+struct RangeQuery {
+  static constexpr std::uint32_t kDefaultChunkRows = 1024;
+  static constexpr std::uint32_t kMaxChunkRows = 16384;  // ~850KB per chunk
+
+  std::int32_t first_day = std::numeric_limits<std::int32_t>::min();
+  std::int32_t last_day = std::numeric_limits<std::int32_t>::max();
+  std::uint32_t columns = 0;  // bit per RangeRequest::Column
+  std::uint32_t chunk_rows = kDefaultChunkRows;
+
+  bool has(marketdata::RangeRequest::Column column) const { return columns & (1u << column); }
+};
+
+// Returns false with `error` set if the dates or columns of `request` are invalid.
+bool parse_range_query(const marketdata::RangeRequest &request, RangeQuery &query,
+                       std::string &error);
+
+// Position in a QueryRange stream: the rows of the range, cut into chunks.
+class RangeCursor {
  public:
-  StockData(const std::string &date, double adjusted_close, double close,
-            double high, double low, double open, double volume)
-      : m_date(date),
-        m_adj_close(adjusted_close),
-        m_close(close),
-        m_high(high),
-        m_low(low),
-        m_open(open),
-        m_volume(volume) {}
-
-  const std::string &date() const { return m_date; }
-  double open() const { return m_open; }
-  double high() const { return m_high; }
-  double low() const { return m_low; }
-  double close() const { return m_close; }
-  double adj_close() const { return m_adj_close; }
-  long long volume() const { return m_volume; }
+  RangeCursor() = default;
+  RangeCursor(StockSeries series, const RangeQuery &query);
+
+  bool done() const { return m_next == m_end; }
+  std::size_t rows() const { return m_end - m_begin; }
+
+  // Replaces the content of `chunk` with the next rows, at most chunk_rows.
+  void next_chunk(marketdata::RangeChunk &chunk);
 
  private:
-  std::string m_date;
-  double m_adj_close;
-  double m_close;
-  double m_high;
-  double m_low;
-  double m_open;
-  long long m_volume;
+  StockSeries m_series;
+  RangeQuery m_query;
+  std::size_t m_begin = 0;
+  std::size_t m_next = 0;
+  std::size_t m_end = 0;
 };
 
 class MarketDataServiceImpl final : public marketdata::MarketData::Service
@@ -42,13 +156,114 @@ class MarketDataServiceImpl final : public marketdata::MarketData::Service
                             const marketdata::StockRequest *request,
                             grpc::ServerWriter<marketdata::StockPrice> *writer) override;
 
+    grpc::Status SubscribeMany(grpc::ServerContext *context,
+                               const marketdata::MultiStockRequest *request,
+                               grpc::ServerWriter<marketdata::StockPriceBatch> *writer) override;
+
+    grpc::Status QueryRange(grpc::ServerContext *context,
+                            const marketdata::RangeRequest *request,
+                            grpc::ServerWriter<marketdata::RangeChunk> *writer) override;
+
+    grpc::Status GetStats(grpc::ServerContext *context,
+                          const marketdata::StatsRequest *request,
+                          marketdata::StatsReply *reply) override;
+
+    grpc::Status SubscribeSharedMemory(grpc::ServerContext *context,
+                                       const marketdata::SharedMemoryRequest *request,
+                                       marketdata::SharedMemoryReply *reply) override;
+
+    grpc::Status Publish(grpc::ServerContext *context,
+                         grpc::ServerReader<marketdata::StockPriceBatch> *reader,
+                         marketdata::PublishReply *reply) override;
+
+    // Appends the rows of one Publish message, adding their number to
+    // `rows`. Returns false with `error` set, publishing nothing, if the
+    // message is invalid.
+    bool publish(const marketdata::StockPriceBatch &batch, std::size_t &rows,
+                 std::string &error);
+
+    // SubscribeSharedMemory of both engines: waits for the symbols to load,
+    // then hands out their rings of the shared-memory feed.
+    grpc::Status subscribe_shared_memory(grpc::ServerContext *context,
+                                         const marketdata::SharedMemoryRequest &request,
+                                         marketdata::SharedMemoryReply &reply) const;
+
+    // Enables SubscribeSharedMemory; `feed` must outlive the servers.
+    void set_shared_memory(SharedMemoryFeed *feed);
+
     void load_data(const std::string &file);
 
-    const std::unordered_map<std::string, std::vector<StockData>>& getStockData() const;
-    const std::vector<StockData>& getStockData(const std::string& symbol) const;
+    // Loads `files` in parallel on `pool`, each file into its own buffer.
+    // A symbol is served as soon as its file is loaded; returns once all
+    // the files are. Loading while it runs.
+    void load_files(const std::vector<std::string> &files, util::thread_pool &pool);
+
+    // Bracket a load phase, e.g. from before the server accepts calls until
+    // its data is in: in between, a subscriber of an unknown symbol waits
+    // for it instead of getting NOT_FOUND. Brackets may nest.
+    void begin_loading();
+    void end_loading();
+
+    // True inside a load phase, i.e. unknown symbols may still appear.
+    bool loading() const;
+
+    // Writes the loaded data, read from `sources`, to a binary snapshot (see
+    // Snapshot.hpp).
+    bool save_snapshot(const std::string &path,
+                       const std::vector<SnapshotSource> &sources) const;
+
+    // Serves the symbols of a snapshot straight from its memory mapping.
+    // `verify_data` also checks the checksum of the column data, which reads
+    // the whole file. Returns false if the snapshot is missing or invalid.
+    // Loading while it runs.
+    bool load_snapshot(const std::string &path, bool verify_data = false);
+
+    // Pacing of the subscriptions that do not choose their own (see Replay.hpp).
+    void set_replay(const ReplayOptions &replay);
+    const ReplayOptions& replay() const;
+
+    // Recorded by both engines; the hot paths only touch per-thread shards.
+    ServerMetrics& metrics() const;
+
+    // The indicator columns of `series`, computed on first request.
+    IndicatorSet indicators(const StockSeries &series, const IndicatorWindows &windows) const;
+
+    // The bars of `series`, a version of `symbol`'s history, at `spec`; the
+    // series itself for daily rows.
+    StockSeries bars(const std::string &symbol, const StockSeries &series,
+                     const BarSpec &spec) const;
+
+    const StockStore& getStockData() const;
+    StockSeries getStockData(const std::string& symbol) const;
+
+    // Like getStockData, but while loading waits up to `timeout` for the symbol.
+    StockSeries waitForStockData(const std::string& symbol,
+                                 std::chrono::milliseconds timeout) const;
+
+    // Number of Publish messages applied so far.
+    std::uint64_t publications() const;
+
+    // Waits up to `timeout` for publications() to exceed `seen`.
+    void waitForPublication(std::uint64_t seen, std::chrono::milliseconds timeout) const;
+
+    // Continues a following SubscribeMany stream that sent all its rows
+    // with the rows published since (see MultiSymbolStream::extend).
+    // `symbols` are the stream's symbols, resolved once.
+    bool follow(MultiSymbolStream &stream, const std::vector<StockStore::Handle> &symbols,
+                const IndicatorWindows &windows) const;
     
     private:
-        std::unordered_map<std::string, std::vector<StockData>> m_stock_data;
+        StockStore m_stock_data;
+        ReplayOptions m_replay;
+        mutable IndicatorCache m_indicators;
+        mutable BarStore m_bars;
+        mutable ServerMetrics m_metrics;
+        SharedMemoryFeed *m_shared_memory = nullptr;
+
+        mutable std::mutex m_load_mutex;
+        mutable std::condition_variable m_loaded;  // a file, a load_files() or a Publish message completed
+        unsigned int m_loads_in_progress = 0;  // open load phases
+        std::uint64_t m_publications = 0;
 };
 
 #endif
\ No newline at end of file
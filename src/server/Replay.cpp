@@ -0,0 +1,240 @@
+#include "Replay.hpp"
+#include <charconv>
+#include <cmath>
+#include <random>
+#include <vector>
+
+ReplayOptions ReplayOptions::afap() {
+  ReplayOptions options;
+  options.mode = ReplayMode::Afap;
+  return options;
+}
+
+ReplayOptions ReplayOptions::fixed_rate(double messages_per_second) {
+  ReplayOptions options;
+  options.mode = ReplayMode::FixedRate;
+  options.rate = messages_per_second;
+  return options;
+}
+
+ReplayOptions ReplayOptions::historical(double days_per_second) {
+  ReplayOptions options;
+  options.mode = ReplayMode::Historical;
+  options.rate = days_per_second;
+  return options;
+}
+
+ReplayOptions ReplayOptions::uniform(std::chrono::microseconds min_delay,
+                                     std::chrono::microseconds max_delay, std::uint64_t seed) {
+  ReplayOptions options;
+  options.mode = ReplayMode::UniformJitter;
+  options.min_delay = min_delay;
+  options.max_delay = max_delay;
+  options.seed = seed;
+  return options;
+}
+
+ReplayOptions ReplayOptions::exponential(std::chrono::microseconds min_delay,
+                                         std::chrono::microseconds max_delay, std::uint64_t seed) {
+  ReplayOptions options = uniform(min_delay, max_delay, seed);
+  options.mode = ReplayMode::ExponentialJitter;
+  return options;
+}
+
+namespace {
+
+bool valid(const ReplayOptions &options, std::string &error) {
+  switch (options.mode) {
+    case ReplayMode::Afap:
+      return true;
+    case ReplayMode::FixedRate:
+    case ReplayMode::Historical:
+      if (!(options.rate > 0) || !std::isfinite(options.rate)) {
+        error = "Replay rate must be positive";
+        return false;
+      }
+      return true;
+    case ReplayMode::UniformJitter:
+    case ReplayMode::ExponentialJitter:
+      if (options.min_delay.count() < 0 || options.min_delay > options.max_delay) {
+        error = "Replay delays must satisfy 0 <= min <= max";
+        return false;
+      }
+      return true;
+  }
+  return false;
+}
+
+template <class T>
+bool parse_number(std::string_view text, T &value) {
+  const char *end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+std::vector<std::string_view> split(std::string_view text, char separator) {
+  std::vector<std::string_view> parts;
+  std::size_t begin = 0;
+  while (true) {
+    const std::size_t end = text.find(separator, begin);
+    parts.push_back(text.substr(begin, end - begin));
+    if (end == std::string_view::npos) return parts;
+    begin = end + 1;
+  }
+}
+
+std::uint64_t splitmix64(std::uint64_t &state) {
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// FNV-1a: std::hash is not specified, so it could change the sequences.
+std::uint64_t stable_hash(std::string_view text) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : text) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+}  // namespace
+
+bool parse_replay(std::string_view spec, ReplayOptions &options, std::string &error) {
+  const std::vector<std::string_view> parts = split(spec, ':');
+  const std::string_view mode = parts[0];
+  ReplayOptions parsed;
+
+  bool ok = false;
+  if (mode == "afap") {
+    parsed = ReplayOptions::afap();
+    ok = parts.size() == 1;
+  } else if (mode == "rate" || mode == "historical") {
+    double rate = 0;
+    ok = parts.size() == 2 && parse_number(parts[1], rate);
+    parsed = mode == "rate" ? ReplayOptions::fixed_rate(rate) : ReplayOptions::historical(rate);
+  } else if (mode == "uniform" || mode == "exponential") {
+    std::int64_t min_us = 0;
+    std::int64_t max_us = 0;
+    ok = parts.size() == 3 && parse_number(parts[1], min_us) && parse_number(parts[2], max_us);
+    parsed = ReplayOptions::uniform(std::chrono::microseconds(min_us),
+                                    std::chrono::microseconds(max_us));
+    if (mode == "exponential") parsed.mode = ReplayMode::ExponentialJitter;
+  }
+
+  if (!ok) {
+    error = "Invalid replay spec: " + std::string(spec);
+    return false;
+  }
+  if (!valid(parsed, error)) return false;
+
+  parsed.seed = options.seed;
+  options = parsed;
+  return true;
+}
+
+bool replay_for(const ReplayOptions &server_default, const marketdata::Replay &request,
+                ReplayOptions &options, std::string &error) {
+  options = server_default;
+  if (request.seed() != 0) options.seed = request.seed();
+
+  switch (request.mode()) {
+    case marketdata::Replay::SERVER_DEFAULT:
+      return true;
+    case marketdata::Replay::AFAP:
+      options.mode = ReplayMode::Afap;
+      break;
+    case marketdata::Replay::FIXED_RATE:
+      options.mode = ReplayMode::FixedRate;
+      options.rate = request.rate();
+      break;
+    case marketdata::Replay::HISTORICAL:
+      options.mode = ReplayMode::Historical;
+      options.rate = request.rate();
+      break;
+    case marketdata::Replay::UNIFORM_JITTER:
+    case marketdata::Replay::EXPONENTIAL_JITTER:
+      options.mode = request.mode() == marketdata::Replay::UNIFORM_JITTER
+                         ? ReplayMode::UniformJitter
+                         : ReplayMode::ExponentialJitter;
+      options.min_delay = std::chrono::microseconds(request.min_delay_us());
+      options.max_delay = std::chrono::microseconds(request.max_delay_us());
+      break;
+    default:
+      error = "Unknown replay mode";
+      return false;
+  }
+  return valid(options, error);
+}
+
+ReplayClock::ReplayClock(const ReplayOptions &options, std::string_view stream_key)
+    : m_options(options) {
+  if (m_options.seed != 0) {
+    m_rng = m_options.seed ^ stable_hash(stream_key);
+  } else {
+    std::random_device device;
+    m_rng = (static_cast<std::uint64_t>(device()) << 32) ^ device();
+  }
+}
+
+ReplayClock::clock::time_point ReplayClock::next(std::int32_t epoch_day) {
+  if (m_options.mode == ReplayMode::Afap) return clock::time_point::min();
+
+  if (!m_started) {
+    m_started = true;
+    m_start = m_last = clock::now();
+    m_day = epoch_day;
+  }
+
+  using seconds = std::chrono::duration<double>;
+  const std::uint64_t k = m_count++;
+
+  switch (m_options.mode) {
+    case ReplayMode::FixedRate:
+      m_last = m_start + std::chrono::duration_cast<clock::duration>(seconds(k / m_options.rate));
+      break;
+    case ReplayMode::Historical:
+      // Trading days, not calendar days: a weekend takes no time.
+      if (epoch_day != m_day) {
+        m_day = epoch_day;
+        ++m_days;
+      }
+      m_last = m_start +
+               std::chrono::duration_cast<clock::duration>(seconds(m_days / m_options.rate));
+      break;
+    default:
+      m_last += next_jitter();
+      break;
+  }
+  return m_last;
+}
+
+std::uint64_t ReplayClock::next_random() { return splitmix64(m_rng); }
+
+std::chrono::nanoseconds ReplayClock::next_jitter() {
+  const std::int64_t min_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.min_delay).count();
+  const std::int64_t max_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.max_delay).count();
+
+  if (m_options.mode == ReplayMode::UniformJitter) {
+    // Whole microseconds, like the delays of the options.
+    const auto span_us = static_cast<std::uint64_t>((max_ns - min_ns) / 1000);
+    return std::chrono::nanoseconds(
+        min_ns + static_cast<std::int64_t>(next_random() % (span_us + 1)) * 1000);
+  }
+
+  // Inverse transform sampling of an exponential shifted by min_delay.
+  const double u = static_cast<double>(next_random() >> 11) * 0x1.0p-53;  // [0, 1)
+  const double mean_excess = (max_ns - min_ns) / 2.0;
+  return std::chrono::nanoseconds(min_ns + std::llround(-std::log1p(-u) * mean_excess));
+}
+
+std::chrono::system_clock::time_point system_deadline(ReplayClock::clock::time_point deadline) {
+  using std::chrono::system_clock;
+  const auto now = ReplayClock::clock::now();
+  if (deadline <= now) return system_clock::now();
+  if (deadline == ReplayClock::clock::time_point::max()) return system_clock::time_point::max();
+  return system_clock::now() + std::chrono::duration_cast<system_clock::duration>(deadline - now);
+}
@@ -0,0 +1,92 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "marketdata.pb.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// How a stream spaces its updates in time.
+enum class ReplayMode {
+  Afap,              // as fast as possible, no pacing
+  FixedRate,         // `rate` stream messages per second
+  Historical,        // `rate` trading days per second
+  UniformJitter,     // uniform delays in [min_delay, max_delay]
+  ExponentialJitter  // exponential delays of mean (min_delay + max_delay) / 2,
+                     // at least min_delay
+};
+
+struct ReplayOptions {
+  ReplayMode mode = ReplayMode::UniformJitter;
+  double rate = 0;
+  std::chrono::microseconds min_delay = std::chrono::milliseconds(100);
+  std::chrono::microseconds max_delay = std::chrono::milliseconds(1000);
+  // Jitter modes: streams of the same symbol and seed get the same delays.
+  // 0 draws a random seed per stream.
+  std::uint64_t seed = 0;
+
+  static ReplayOptions afap();
+  static ReplayOptions fixed_rate(double messages_per_second);
+  static ReplayOptions historical(double days_per_second);
+  static ReplayOptions uniform(std::chrono::microseconds min_delay,
+                               std::chrono::microseconds max_delay, std::uint64_t seed = 0);
+  static ReplayOptions exponential(std::chrono::microseconds min_delay,
+                                   std::chrono::microseconds max_delay, std::uint64_t seed = 0);
+};
+
+// Parses a command-line replay spec:
+//   afap | rate:N | historical:DAYS_PER_SEC
+//   | uniform:MIN_US:MAX_US | exponential:MIN_US:MAX_US
+// keeping the seed of `options`. Returns false with `error` set if invalid.
+bool parse_replay(std::string_view spec, ReplayOptions &options, std::string &error);
+
+// The replay of a request: the server default overridden by the fields of
+// `request` (a SERVER_DEFAULT mode keeps the default). Returns false with
+// `error` set if the request is invalid.
+bool replay_for(const ReplayOptions &server_default, const marketdata::Replay &request,
+                ReplayOptions &options, std::string &error);
+
+// Schedule of one stream: the time at which each of its updates is due.
+//
+// Deadlines are absolute, derived from the start of the stream rather than
+// from the previous write, so that a stream which falls behind (e.g. behind
+// a slow consumer) catches up instead of drifting, and a replay at a given
+// rate takes the same time whatever the per-message overhead. The jitter
+// generator is an 8-byte splitmix64 rather than a std::mt19937 (~5KB), so
+// that each of thousands of streams can own one, and its delays are computed
+// without std:: distributions, whose output differs between standard
+// libraries.
+class ReplayClock {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  ReplayClock() = default;
+  // `stream_key` (e.g. the symbol) selects the jitter sequence of a seed.
+  ReplayClock(const ReplayOptions &options, std::string_view stream_key);
+
+  // Deadline of the next update, whose row is of trading day `epoch_day`.
+  // The first call starts the stream. Under AFAP every update is already due.
+  clock::time_point next(std::int32_t epoch_day);
+
+  const ReplayOptions &options() const { return m_options; }
+
+ private:
+  std::chrono::nanoseconds next_jitter();
+  std::uint64_t next_random();
+
+  ReplayOptions m_options = ReplayOptions::afap();
+  std::uint64_t m_rng = 0;
+  bool m_started = false;
+  clock::time_point m_start;
+  clock::time_point m_last;
+  std::uint64_t m_count = 0;
+  std::int32_t m_day = 0;       // trading day of the last update
+  std::uint64_t m_days = 0;     // trading days since the first update
+};
+
+// `deadline` on the system clock, for APIs such as grpc::Alarm that take
+// wall-clock deadlines. time_point::min() and max() saturate.
+std::chrono::system_clock::time_point system_deadline(ReplayClock::clock::time_point deadline);
+
+#endif
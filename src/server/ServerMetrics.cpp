@@ -0,0 +1,80 @@
+#include "ServerMetrics.hpp"
+#include "MarketDataServer.hpp"
+#include <filesystem>
+
+ServerMetrics::ServerMetrics()
+    : m_subscriptions(m_registry.counter("subscriptions_total")),
+      m_active(m_registry.gauge("subscriptions_active")),
+      m_cancelled(m_registry.counter("streams_cancelled")),
+      m_write_latency(m_registry.histogram("write_latency_ns")),
+      m_fanout_queue_depth(m_registry.histogram("fanout_queue_depth")),
+      m_fanout_dropped(m_registry.counter("fanout_ticks_dropped")) {}
+
+ServerMetrics::Stream::Stream(ServerMetrics &metrics) : m_metrics(metrics) {
+  m_metrics.m_subscriptions.add();
+  m_metrics.m_active.add();
+}
+
+ServerMetrics::Stream::~Stream() {
+  m_metrics.m_active.sub();
+  if (m_cancelled) m_metrics.m_cancelled.add();
+}
+
+ServerMetrics::Symbol ServerMetrics::symbol(std::string_view symbol) {
+  return Symbol{&m_registry.counter("updates_sent", symbol),
+                &m_registry.counter("bytes_sent", symbol)};
+}
+
+void ServerMetrics::record_load(std::string_view file, std::size_t rows,
+                                clock::duration elapsed) {
+  const std::string name = std::filesystem::path(file).filename().string();
+  m_registry.counter("load_time_us", name)
+      .add(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+  m_registry.counter("rows_loaded", name).add(rows);
+}
+
+void ServerMetrics::record_publish(std::string_view symbol, std::size_t rows) {
+  m_registry.counter("rows_published", symbol).add(rows);
+}
+
+void ServerMetrics::count_batch(std::span<const Symbol> symbols,
+                                std::span<const std::uint32_t> sources,
+                                const marketdata::StockPriceBatch &batch) {
+  // Serializing the batch cached the size of every row.
+  for (int i = 0; i < batch.prices_size(); ++i) {
+    symbols[sources[i]].sent(1, static_cast<std::size_t>(batch.prices(i).GetCachedSize()));
+  }
+  for (int i = 0; i < batch.compact_prices_size(); ++i) {
+    symbols[sources[i]].sent(1,
+                             static_cast<std::size_t>(batch.compact_prices(i).GetCachedSize()));
+  }
+}
+
+void ServerMetrics::fill(std::string_view prefix, marketdata::StatsReply &reply) const {
+  reply.set_timestamp_ns(wall_clock_ns());
+  for (const auto &sample : m_registry.snapshot(prefix)) {
+    marketdata::Metric *metric = reply.add_metrics();
+    metric->set_name(sample.name);
+    metric->set_label(sample.label);
+    switch (sample.type) {
+      case util::metrics_registry::kind::counter:
+        metric->set_kind(marketdata::Metric::COUNTER);
+        metric->set_value(sample.value);
+        break;
+      case util::metrics_registry::kind::gauge:
+        metric->set_kind(marketdata::Metric::GAUGE);
+        metric->set_value(sample.value);
+        break;
+      case util::metrics_registry::kind::histogram:
+        metric->set_kind(marketdata::Metric::HISTOGRAM);
+        metric->set_count(sample.count);
+        metric->set_mean(sample.mean);
+        metric->set_p50(sample.p50);
+        metric->set_p99(sample.p99);
+        metric->set_p999(sample.p999);
+        metric->set_max(sample.max);
+        break;
+    }
+  }
+}
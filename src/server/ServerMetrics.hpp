@@ -0,0 +1,96 @@
+#ifndef SERVER_METRICS_HPP
+#define SERVER_METRICS_HPP
+
+#include "marketdata.pb.h"
+#include "utilities/metrics.hpp"
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// The metrics of the server, kept in a util::metrics_registry:
+//
+//   subscriptions_total, subscriptions_active   streams (of any method) started, running
+//   streams_cancelled                           streams cancelled by the client or broken
+//   updates_sent{symbol}, bytes_sent{symbol}    rows written and their payload bytes
+//   write_latency_ns                            from a Write() to its completion
+//   fanout_queue_depth                          ticks queued behind an in-flight Write
+//   fanout_ticks_dropped                        dropped or conflated for a slow consumer
+//   load_time_us{file}, rows_loaded{file}       per CSV file or snapshot
+//   rows_published{symbol}                      rows appended by Publish
+//
+// Recording is a relaxed atomic add on a per-thread shard, i.e. a few ns,
+// so the metrics are always on. The streams look their per-symbol metrics
+// up once, when they start.
+class ServerMetrics {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  // The metrics of one symbol.
+  struct Symbol {
+    util::sharded_counter *updates = nullptr;
+    util::sharded_counter *bytes = nullptr;
+
+    void sent(std::size_t rows, std::size_t payload) const {
+      updates->add(rows);
+      bytes->add(payload);
+    }
+  };
+
+  // Counts a stream as active while it exists.
+  class Stream {
+   public:
+    explicit Stream(ServerMetrics &metrics);
+    ~Stream();
+
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+
+    // The stream did not end normally: the client cancelled it or the
+    // connection broke.
+    void cancelled() { m_cancelled = true; }
+
+   private:
+    ServerMetrics &m_metrics;
+    bool m_cancelled = false;
+  };
+
+  ServerMetrics();
+
+  Symbol symbol(std::string_view symbol);
+
+  void record_write(clock::duration elapsed) {
+    m_write_latency.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+  void record_load(std::string_view file, std::size_t rows, clock::duration elapsed);
+  void record_publish(std::string_view symbol, std::size_t rows);
+
+  // Counts the rows of a serialized StockPriceBatch per symbol. `sources`
+  // holds the index in `symbols` of each row (see MultiSymbolStream).
+  static void count_batch(std::span<const Symbol> symbols,
+                          std::span<const std::uint32_t> sources,
+                          const marketdata::StockPriceBatch &batch);
+
+  util::sharded_histogram &fanout_queue_depth() { return m_fanout_queue_depth; }
+  util::sharded_counter &fanout_dropped() { return m_fanout_dropped; }
+
+  util::metrics_registry &registry() { return m_registry; }
+  const util::metrics_registry &registry() const { return m_registry; }
+
+  // The metrics whose name starts with `prefix`.
+  void fill(std::string_view prefix, marketdata::StatsReply &reply) const;
+
+ private:
+  util::metrics_registry m_registry;
+  util::sharded_counter &m_subscriptions;
+  util::sharded_gauge &m_active;
+  util::sharded_counter &m_cancelled;
+  util::sharded_histogram &m_write_latency;
+  util::sharded_histogram &m_fanout_queue_depth;
+  util::sharded_counter &m_fanout_dropped;
+};
+
+#endif
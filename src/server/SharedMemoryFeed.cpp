@@ -0,0 +1,174 @@
+#include "SharedMemoryFeed.hpp"
+#include "utilities/logger.hpp"
+#include "utilities/thread_affinity.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <new>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// True if the segment was left behind by a server that has exited. A pid
+// reused since makes it look live: start() then fails rather than unlinking
+// a segment that may still be served.
+bool left_by_dead_writer(const void *base, std::size_t size) {
+#ifdef _WIN32
+  (void)base, (void)size;
+  return false;
+#else
+  if (size < sizeof(SharedFeedLayout::Header)) return false;
+  const std::int64_t pid = SharedFeedLayout::header(base).writer_pid;
+  return pid > 0 && ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+#endif
+}
+
+}  // namespace
+
+SharedMemoryFeed::SharedMemoryFeed(const MarketDataServiceImpl &data, SharedMemoryOptions options)
+    : m_data(data), m_options(std::move(options)) {
+  m_options.max_symbols = std::max(1u, m_options.max_symbols);
+}
+
+SharedMemoryFeed::~SharedMemoryFeed() { stop(); }
+
+bool SharedMemoryFeed::start(std::string &error) {
+  const std::size_t ring_bytes = SharedFeedLayout::Ring::bytes(m_options.ring_capacity);
+  if (!m_memory.create(m_options.name,
+                       SharedFeedLayout::bytes(m_options.max_symbols, m_options.ring_capacity),
+                       error, left_by_dead_writer)) {
+    return false;
+  }
+
+  // The segment is formatted before its name is handed to any subscriber.
+  void *base = m_memory.data();
+  auto *header = new (base) SharedFeedLayout::Header{};
+#ifndef _WIN32
+  header->writer_pid = ::getpid();
+#endif
+  header->max_symbols = m_options.max_symbols;
+  header->ring_bytes = ring_bytes;
+  for (std::uint32_t i = 0; i < m_options.max_symbols; ++i) {
+    new (&SharedFeedLayout::entry(base, i)) SharedFeedLayout::Entry{};
+    SharedFeedLayout::Ring::create(SharedFeedLayout::ring(base, i), m_options.ring_capacity);
+  }
+  header->version = SharedFeedLayout::kVersion;
+  header->magic = SharedFeedLayout::kMagic;
+
+  m_replays.reserve(m_options.max_symbols);
+  m_writer = std::thread([this] { run(); });
+  UTIL_LOG(info, "[Server] Shared-memory feed {}: {} rings of {} ticks", m_options.name,
+           m_options.max_symbols,
+           SharedFeedLayout::Ring::attach(SharedFeedLayout::ring(base, 0)).capacity());
+  return true;
+}
+
+void SharedMemoryFeed::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wakeup.notify_all();
+  if (m_writer.joinable()) m_writer.join();
+  m_memory.close();
+}
+
+grpc::Status SharedMemoryFeed::subscribe(const std::string &symbol, const StockSeries &rows,
+                                         std::uint32_t &ring, std::uint64_t &position) {
+  if (rows.empty()) return grpc::Status(grpc::StatusCode::NOT_FOUND, "Symbol not found: " + symbol);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_stopping || !m_memory) {
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Shared-memory feed stopped");
+  }
+
+  auto it = m_rings.find(symbol);
+  if (it == m_rings.end()) {
+    if (m_replays.size() == m_options.max_symbols) {
+      return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                          "No shared-memory ring left for " + symbol);
+    }
+    const auto index = static_cast<std::uint32_t>(m_replays.size());
+    SharedFeedLayout::Entry &entry = SharedFeedLayout::entry(m_memory.data(), index);
+    symbol.copy(entry.symbol, SharedFeedLayout::kMaxSymbolLength);
+
+    Replay &replay = m_replays.emplace_back();
+    replay.symbol = symbol;
+    replay.index = index;
+    replay.ring = SharedFeedLayout::Ring::attach(SharedFeedLayout::ring(m_memory.data(), index));
+    replay.metrics = m_data.metrics().symbol(symbol);
+    it = m_rings.emplace(symbol, index).first;
+  }
+
+  ring = it->second;
+  Replay &replay = m_replays[ring];
+  position = replay.ring.head();
+  if (!replay.live) {
+    replay.rows = rows;
+    replay.next = 0;
+    replay.schedule = ReplayClock(m_data.replay(), symbol);
+    replay.due = replay.schedule.next(rows[0].epoch_day());
+    replay.live = true;
+    lock.unlock();
+    m_wakeup.notify_all();
+  }
+  return grpc::Status::OK;
+}
+
+void SharedMemoryFeed::publish(Replay &replay) {
+  const StockData row = replay.rows[replay.next];
+  Tick tick;
+  tick.symbol_id = replay.index;
+  tick.epoch_day = row.epoch_day();
+  tick.adj_close = row.adj_close();
+  tick.close = row.close();
+  tick.high = row.high();
+  tick.low = row.low();
+  tick.open = row.open();
+  tick.volume = row.volume();
+  tick.seq = replay.next + 1;
+  tick.timestamp_ns = wall_clock_ns();
+  replay.ring.push(tick);
+  replay.metrics.sent(1, sizeof(Tick));
+  UTIL_LOG(debug, "[Server] Published {} #{} to shared memory", replay.symbol, tick.seq);
+
+  if (++replay.next < replay.rows.size()) {
+    replay.due = replay.schedule.next(replay.rows[replay.next].epoch_day());
+  }
+}
+
+void SharedMemoryFeed::run() {
+  util::set_current_thread_name("md-shm-writer");
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopping) {
+    Replay *next = nullptr;
+    for (Replay &replay : m_replays) {
+      if (replay.live && (!next || replay.due < next->due)) next = &replay;
+    }
+
+    if (!next) {
+      m_wakeup.wait(lock);
+    } else if (next->due > clock::now()) {
+      // Woken early by a new replay, whose first tick may be due sooner.
+      m_wakeup.wait_until(lock, next->due);
+    } else if (next->next + 1 < next->rows.size()) {
+      // Published unlocked, so that subscribe() never waits behind a
+      // burst; m_replays never reallocates (reserved in start()).
+      lock.unlock();
+      publish(*next);
+      lock.lock();
+    } else {
+      // The last tick goes out with the end of the replay, under the lock:
+      // a subscriber either gets it or starts a new replay.
+      publish(*next);
+      SharedFeedLayout::entry(m_memory.data(), next->index)
+          .end.store(next->ring.head(), std::memory_order_release);
+      next->rows = StockSeries();
+      next->live = false;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef SHARED_MEMORY_FEED_HPP
+#define SHARED_MEMORY_FEED_HPP
+
+#include "MarketDataServer.hpp"
+#include "common/SharedFeedLayout.hpp"
+#include "utilities/shared_memory.hpp"
+#include <grpcpp/grpcpp.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SharedMemoryOptions {
+  std::string name = "/marketdata";  // of the POSIX shared-memory object
+  std::uint32_t max_symbols = 64;    // rings in the segment
+  std::size_t ring_capacity = 4096;  // ticks per ring, rounded up to a power of two
+};
+
+// Same-host transport: replays each requested symbol once into its ring of
+// a shared-memory segment (see SharedFeedLayout), which local subscribers
+// map read-only and poll. There is no socket, no serialization and no
+// per-subscriber state on the server.
+//
+// Like the FanoutBus, the subscribers of a symbol share one replay, paced
+// by the server's replay options. Unlike it, the writer never waits for a
+// subscriber: one that falls a ring behind loses ticks, and counts them.
+// Subscriptions are still set up through the MarketData service
+// (SubscribeSharedMemory), which hands out the ring of each symbol.
+//
+// One writer thread serves every ring, sleeping until the next tick due.
+class SharedMemoryFeed
+{
+    public:
+    SharedMemoryFeed(const MarketDataServiceImpl &data, SharedMemoryOptions options = {});
+    ~SharedMemoryFeed();
+
+    SharedMemoryFeed(const SharedMemoryFeed &) = delete;
+    SharedMemoryFeed &operator=(const SharedMemoryFeed &) = delete;
+
+    // Creates the segment and starts the writer thread. A segment of the
+    // same name is replaced only if the server that wrote it has exited.
+    // Returns false with `error` set if the segment cannot be created.
+    bool start(std::string &error);
+
+    // Stops the writer and removes the segment; mapped readers keep their
+    // mapping but see no new ticks.
+    void stop();
+
+    // Starts replaying `rows`, the history of `symbol`, into the symbol's
+    // ring unless a replay of it is already running. Sets `ring` to the
+    // index of the ring and `position` to the position of the next tick in
+    // it, i.e. where a new subscriber starts reading.
+    grpc::Status subscribe(const std::string &symbol, const StockSeries &rows,
+                           std::uint32_t &ring, std::uint64_t &position);
+
+    const std::string &name() const { return m_options.name; }
+
+    private:
+    using clock = ReplayClock::clock;
+
+    // While `live`, only the writer thread touches the replay state.
+    struct Replay {
+      std::string symbol;
+      std::uint32_t index = 0;
+      SharedFeedLayout::Ring ring;
+      ServerMetrics::Symbol metrics;
+      StockSeries rows;
+      std::size_t next = 0;
+      ReplayClock schedule;
+      clock::time_point due;
+      bool live = false;
+    };
+
+    void run();
+    void publish(Replay &replay);  // the next tick
+
+    const MarketDataServiceImpl &m_data;
+    SharedMemoryOptions m_options;
+    util::shared_memory m_memory;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;  // a replay started, or stop()
+    std::vector<Replay> m_replays;     // by ring
+    std::unordered_map<std::string, std::uint32_t> m_rings;
+    bool m_stopping = false;
+    std::thread m_writer;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'D', 'S', 'N', 'A', 'P', 0, 0};
+constexpr std::uint32_t kByteOrder = 0x01020304;
+
+// Bytes of the header covered by index_checksum.
+constexpr std::size_t kHeaderChecksummed = offsetof(SnapshotHeader, index_checksum);
+
+constexpr std::uint64_t align8(std::uint64_t n) { return (n + 7) & ~std::uint64_t(7); }
+
+constexpr std::uint64_t columns_bytes(std::uint64_t rows) {
+  return align8(rows * (5 * sizeof(double) + sizeof(std::int64_t) + sizeof(std::int32_t)));
+}
+
+// FNV-1a over 64-bit words rather than bytes, so that verifying a multi-GB
+// snapshot runs at memory speed. Sizes must be multiples of 8.
+class Checksum {
+ public:
+  void update(const void *data, std::size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    for (std::size_t i = 0; i + 8 <= size; i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, bytes + i, 8);
+      m_hash = (m_hash ^ word) * 0x100000001b3ULL;
+    }
+  }
+  std::uint64_t value() const { return m_hash; }
+
+ private:
+  std::uint64_t m_hash = 0xcbf29ce484222325ULL;
+};
+
+// Writes and checksums a section, padded with zeros to 8 bytes.
+void put(std::ofstream &out, Checksum &checksum, const void *data, std::size_t size) {
+  static const char zeros[8] = {};
+  out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+  checksum.update(data, size & ~std::size_t(7));
+
+  if (const std::size_t tail = size & 7) {
+    char last[8] = {};
+    std::memcpy(last, static_cast<const char *>(data) + size - tail, tail);
+    out.write(zeros, static_cast<std::streamsize>(8 - tail));
+    checksum.update(last, 8);
+  }
+}
+
+template <class T>
+void put(std::ofstream &out, Checksum &checksum, std::span<const T> column) {
+  put(out, checksum, column.data(), column.size_bytes());
+}
+
+}  // namespace
+
+std::vector<SnapshotSource> snapshot_sources(const std::vector<std::string> &files) {
+  std::vector<SnapshotSource> sources;
+  for (const std::string &file : files) {
+    std::error_code ec;
+    const std::uintmax_t size = std::filesystem::file_size(file, ec);
+    sources.push_back({std::filesystem::path(file).filename().string(), ec ? 0 : size});
+  }
+  std::sort(sources.begin(), sources.end(),
+            [](const SnapshotSource &a, const SnapshotSource &b) { return a.name < b.name; });
+  return sources;
+}
+
+bool write_snapshot(const StockStore &store, const std::vector<SnapshotSource> &sources,
+                    const std::string &path, std::string &error) {
+  struct Symbol {
+    std::string name;
+    StockSeries series;
+  };
+  std::vector<Symbol> symbols;
+  for (SymbolTable::Id id = 0; id < store.size(); ++id) {
+    symbols.push_back({store.symbol(id), store.series(id)});
+  }
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kSnapshotVersion;
+  header.byte_order = kByteOrder;
+  header.symbol_count = symbols.size();
+  header.source_count = sources.size();
+
+  const std::uint64_t names_offset = sizeof(SnapshotHeader) +
+                                     symbols.size() * sizeof(SnapshotIndexEntry) +
+                                     sources.size() * sizeof(SnapshotSourceEntry);
+  std::vector<SnapshotIndexEntry> index(symbols.size());
+  std::string names;
+  std::uint64_t data_size = 0;
+  for (std::size_t i = 0; i < symbols.size(); ++i) {
+    index[i].name_offset = names_offset + names.size();
+    index[i].name_size = static_cast<std::uint32_t>(symbols[i].name.size());
+    index[i].rows = symbols[i].series.size();
+    index[i].columns_offset = data_size;  // relative until data_offset is known
+    names += symbols[i].name;
+    data_size += columns_bytes(index[i].rows);
+  }
+  std::vector<SnapshotSourceEntry> source_index(sources.size());
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    source_index[i].name_offset = names_offset + names.size();
+    source_index[i].name_size = static_cast<std::uint32_t>(sources[i].name.size());
+    source_index[i].file_size = sources[i].size;
+    names += sources[i].name;
+  }
+  header.data_offset = align8(names_offset + names.size());
+  header.file_size = header.data_offset + data_size;
+  for (auto &entry : index) entry.columns_offset += header.data_offset;
+
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      error = "cannot create " + tmp_path;
+      return false;
+    }
+
+    Checksum index_checksum;
+    index_checksum.update(&header, kHeaderChecksummed);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));  // rewritten below
+    put(out, index_checksum, index.data(), index.size() * sizeof(SnapshotIndexEntry));
+    put(out, index_checksum, source_index.data(),
+        source_index.size() * sizeof(SnapshotSourceEntry));
+    put(out, index_checksum, names.data(), names.size());
+
+    Checksum data_checksum;
+    for (const Symbol &symbol : symbols) {
+      const PriceColumnsView &columns = symbol.series.columns();
+      put(out, data_checksum, columns.adj_close);
+      put(out, data_checksum, columns.close);
+      put(out, data_checksum, columns.high);
+      put(out, data_checksum, columns.low);
+      put(out, data_checksum, columns.open);
+      put(out, data_checksum, columns.volume);
+      put(out, data_checksum, columns.date);
+    }
+
+    header.index_checksum = index_checksum.value();
+    header.data_checksum = data_checksum.value();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+      error = "failed to write " + tmp_path;
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    error = "cannot rename " + tmp_path + ": " + ec.message();
+    return false;
+  }
+  return true;
+}
+
+Snapshot::Snapshot(const std::string &path) : m_file(path, MappedFile::Access::Random) {}
+
+std::shared_ptr<const Snapshot> Snapshot::open(const std::string &path, bool verify_data,
+                                               std::string &error) {
+  auto snapshot = std::make_shared<Snapshot>(path);
+  const std::string_view file = snapshot->m_file.data();
+  if (!snapshot->m_file.is_open()) {
+    error = "cannot open " + path;
+    return nullptr;
+  }
+
+  SnapshotHeader header;
+  if (file.size() < sizeof(header)) {
+    error = "truncated header";
+    return nullptr;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    error = "not a snapshot";
+    return nullptr;
+  }
+  if (header.version != kSnapshotVersion) {
+    error = "unsupported version " + std::to_string(header.version);
+    return nullptr;
+  }
+  if (header.byte_order != kByteOrder) {
+    error = "written with another byte order";
+    return nullptr;
+  }
+  if (header.file_size != file.size() || header.data_offset < sizeof(header) ||
+      header.data_offset > file.size() ||
+      header.symbol_count > (header.data_offset - sizeof(header)) / sizeof(SnapshotIndexEntry) ||
+      header.source_count > (header.data_offset - sizeof(header) -
+                             header.symbol_count * sizeof(SnapshotIndexEntry)) /
+                                sizeof(SnapshotSourceEntry)) {
+    error = "truncated or inconsistent file";
+    return nullptr;
+  }
+
+  Checksum index_checksum;
+  index_checksum.update(&header, kHeaderChecksummed);
+  index_checksum.update(file.data() + sizeof(header), header.data_offset - sizeof(header));
+  if (index_checksum.value() != header.index_checksum) {
+    error = "index checksum mismatch";
+    return nullptr;
+  }
+
+  for (std::size_t i = 0; i < header.symbol_count; ++i) {
+    const SnapshotIndexEntry &entry = snapshot->entry(i);
+    if (entry.rows > header.file_size ||
+        entry.name_offset + entry.name_size > header.data_offset ||
+        entry.columns_offset < header.data_offset || entry.columns_offset % 8 != 0 ||
+        entry.columns_offset + columns_bytes(entry.rows) > header.file_size) {
+      error = "index entry " + std::to_string(i) + " out of bounds";
+      return nullptr;
+    }
+  }
+  for (std::size_t i = 0; i < header.source_count; ++i) {
+    const SnapshotSourceEntry &source = snapshot->source(i);
+    if (source.name_offset + source.name_size > header.data_offset) {
+      error = "source entry " + std::to_string(i) + " out of bounds";
+      return nullptr;
+    }
+  }
+
+  if (verify_data) {
+    Checksum data_checksum;
+    data_checksum.update(file.data() + header.data_offset, header.file_size - header.data_offset);
+    if (data_checksum.value() != header.data_checksum) {
+      error = "data checksum mismatch";
+      return nullptr;
+    }
+  }
+
+  return snapshot;
+}
+
+std::size_t Snapshot::size() const {
+  return header().symbol_count;
+}
+
+std::string_view Snapshot::symbol(std::size_t i) const {
+  const SnapshotIndexEntry &e = entry(i);
+  return m_file.data().substr(e.name_offset, e.name_size);
+}
+
+StockSeries Snapshot::series(std::size_t i) const {
+  const SnapshotIndexEntry &e = entry(i);
+  const std::size_t rows = e.rows;
+  const char *base = m_file.data().data() + e.columns_offset;
+
+  auto doubles = [&](std::size_t column) {
+    return std::span<const double>(
+        reinterpret_cast<const double *>(base + column * rows * sizeof(double)), rows);
+  };
+
+  PriceColumnsView columns;
+  columns.adj_close = doubles(0);
+  columns.close = doubles(1);
+  columns.high = doubles(2);
+  columns.low = doubles(3);
+  columns.open = doubles(4);
+  columns.volume = std::span<const std::int64_t>(
+      reinterpret_cast<const std::int64_t *>(base + 5 * rows * sizeof(double)), rows);
+  columns.date = std::span<const std::int32_t>(
+      reinterpret_cast<const std::int32_t *>(base + 5 * rows * sizeof(double) +
+                                             rows * sizeof(std::int64_t)),
+      rows);
+  return StockSeries(columns, shared_from_this());
+}
+
+std::vector<SnapshotSource> Snapshot::sources() const {
+  std::vector<SnapshotSource> sources;
+  for (std::size_t i = 0; i < header().source_count; ++i) {
+    const SnapshotSourceEntry &e = source(i);
+    sources.push_back({std::string(m_file.data().substr(e.name_offset, e.name_size)), e.file_size});
+  }
+  return sources;
+}
+
+const SnapshotHeader &Snapshot::header() const {
+  return *reinterpret_cast<const SnapshotHeader *>(m_file.data().data());
+}
+
+const SnapshotSourceEntry &Snapshot::source(std::size_t i) const {
+  return reinterpret_cast<const SnapshotSourceEntry *>(
+      m_file.data().data() + sizeof(SnapshotHeader) +
+      header().symbol_count * sizeof(SnapshotIndexEntry))[i];
+}
+
+const SnapshotIndexEntry &Snapshot::entry(std::size_t i) const {
+  return reinterpret_cast<const SnapshotIndexEntry *>(m_file.data().data() +
+                                                      sizeof(SnapshotHeader))[i];
+}
@@ -0,0 +1,103 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "MappedFile.hpp"
+#include "StockStore.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary snapshot of a StockStore, served in place from a memory mapping.
+//
+// Layout, in host byte order, every section aligned to 8 bytes:
+//
+//   SnapshotHeader
+//   SnapshotIndexEntry[symbol_count]
+//   SnapshotSourceEntry[source_count]
+//   symbol names then source file names, back to back, padded to 8 bytes
+//   per symbol: adj_close, close, high, low, open (double[rows]),
+//               volume (int64[rows]), date (int32[rows], padded to 8 bytes)
+//
+// The header and the index are checksummed separately from the column data:
+// the former is verified on every open, the latter only on request since it
+// means reading the whole file.
+//
+// The sources are the CSV files the snapshot was written from, by file name
+// and size, so that a server can tell whether its CSV directory still holds
+// the same files.
+constexpr std::uint32_t kSnapshotVersion = 2;
+
+struct SnapshotHeader {
+  char magic[8];                // "MDSNAP\0\0"
+  std::uint32_t version;        // kSnapshotVersion
+  std::uint32_t byte_order;     // 0x01020304 as stored by the writer
+  std::uint64_t symbol_count;
+  std::uint64_t source_count;
+  std::uint64_t data_offset;    // first byte of the column data
+  std::uint64_t file_size;
+  std::uint64_t index_checksum; // fields above, index and names
+  std::uint64_t data_checksum;  // column data
+};
+
+struct SnapshotIndexEntry {
+  std::uint64_t name_offset;
+  std::uint32_t name_size;
+  std::uint32_t reserved;
+  std::uint64_t rows;
+  std::uint64_t columns_offset;
+};
+
+struct SnapshotSourceEntry {
+  std::uint64_t name_offset;
+  std::uint32_t name_size;
+  std::uint32_t reserved;
+  std::uint64_t file_size;
+};
+
+// A CSV file a snapshot was written from.
+struct SnapshotSource {
+  std::string name;  // file name, without the directory
+  std::uint64_t size = 0;
+
+  bool operator==(const SnapshotSource &) const = default;
+};
+
+// The sources of `files`, sorted by name. A file that cannot be read has
+// size 0.
+std::vector<SnapshotSource> snapshot_sources(const std::vector<std::string> &files);
+
+// Writes `store`, loaded from `sources`, to `path` (through a temporary file
+// renamed into place, so readers never see a partial snapshot). Returns
+// false and sets `error` on failure.
+bool write_snapshot(const StockStore &store, const std::vector<SnapshotSource> &sources,
+                    const std::string &path, std::string &error);
+
+class Snapshot : public std::enable_shared_from_this<Snapshot> {
+ public:
+  // Maps and validates `path`. Returns nullptr and sets `error` on failure.
+  static std::shared_ptr<const Snapshot> open(const std::string &path, bool verify_data,
+                                              std::string &error);
+
+  std::size_t size() const;  // number of symbols
+  std::string_view symbol(std::size_t i) const;
+
+  // Columns of the i-th symbol, pointing into the mapping; the series keeps
+  // the snapshot mapped.
+  StockSeries series(std::size_t i) const;
+
+  // The files the snapshot was written from, sorted by name.
+  std::vector<SnapshotSource> sources() const;
+
+  explicit Snapshot(const std::string &path);  // use open()
+
+ private:
+  const SnapshotHeader &header() const;
+  const SnapshotIndexEntry &entry(std::size_t i) const;
+  const SnapshotSourceEntry &source(std::size_t i) const;
+
+  MappedFile m_file;
+};
+
+#endif
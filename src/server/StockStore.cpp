@@ -0,0 +1,326 @@
+#include "StockStore.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+
+std::optional<std::int32_t> parse_date(std::string_view date) {
+  if (date.size() != 10 || date[4] != '-' || date[7] != '-') return std::nullopt;
+
+  int y = 0;
+  unsigned m = 0, d = 0;
+  auto parse = [&](std::size_t pos, std::size_t len, auto &out) {
+    auto [ptr, ec] = std::from_chars(date.data() + pos, date.data() + pos + len, out);
+    return ec == std::errc() && ptr == date.data() + pos + len;
+  };
+  if (!parse(0, 4, y) || !parse(5, 2, m) || !parse(8, 2, d)) return std::nullopt;
+
+  const std::chrono::year_month_day ymd{std::chrono::year{y}, std::chrono::month{m},
+                                        std::chrono::day{d}};
+  if (!ymd.ok()) return std::nullopt;
+  return static_cast<std::int32_t>(std::chrono::sys_days{ymd}.time_since_epoch().count());
+}
+
+std::string format_date(std::int32_t epoch_day) {
+  const std::chrono::year_month_day ymd{std::chrono::sys_days{std::chrono::days{epoch_day}}};
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", static_cast<int>(ymd.year()),
+                static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()));
+  return buffer;
+}
+
+void PriceColumns::reserve(std::size_t n) {
+  date.reserve(n);
+  adj_close.reserve(n);
+  close.reserve(n);
+  high.reserve(n);
+  low.reserve(n);
+  open.reserve(n);
+  volume.reserve(n);
+}
+
+void PriceColumns::append(const StockData &row) {
+  date.push_back(row.epoch_day());
+  adj_close.push_back(row.adj_close());
+  close.push_back(row.close());
+  high.push_back(row.high());
+  low.push_back(row.low());
+  open.push_back(row.open());
+  volume.push_back(row.volume());
+}
+
+void PriceColumns::append(const PriceColumnsView &rows) {
+  date.insert(date.end(), rows.date.begin(), rows.date.end());
+  adj_close.insert(adj_close.end(), rows.adj_close.begin(), rows.adj_close.end());
+  close.insert(close.end(), rows.close.begin(), rows.close.end());
+  high.insert(high.end(), rows.high.begin(), rows.high.end());
+  low.insert(low.end(), rows.low.begin(), rows.low.end());
+  open.insert(open.end(), rows.open.begin(), rows.open.end());
+  volume.insert(volume.end(), rows.volume.begin(), rows.volume.end());
+}
+
+std::size_t PriceColumns::memory_bytes() const {
+  return date.capacity() * sizeof(std::int32_t) +
+         (adj_close.capacity() + close.capacity() + high.capacity() +
+          low.capacity() + open.capacity()) * sizeof(double) +
+         volume.capacity() * sizeof(std::int64_t);
+}
+
+std::pair<std::size_t, std::size_t> StockSeries::rows_between(std::int32_t first_day,
+                                                              std::int32_t last_day) const {
+  const auto &date = m_columns.date;
+  const auto first = std::lower_bound(date.begin(), date.end(), first_day);
+  const auto last = std::upper_bound(first, date.end(), last_day);
+  return {static_cast<std::size_t>(first - date.begin()),
+          static_cast<std::size_t>(last - date.begin())};
+}
+
+// std::*_heap build max-heaps; ordering by "later" puts the earliest
+// (day, source) at the front.
+bool SeriesMerge::later(const Head &a, const Head &b) {
+  return a.day != b.day ? a.day > b.day : a.source > b.source;
+}
+
+SeriesMerge::SeriesMerge(std::vector<StockSeries> series)
+    : SeriesMerge(std::move(series), {}) {}
+
+SeriesMerge::SeriesMerge(std::vector<StockSeries> series, std::vector<std::size_t> starts)
+    : m_series(std::move(series)), m_positions(std::move(starts)) {
+  m_positions.resize(m_series.size(), 0);
+  for (std::size_t i = 0; i < m_series.size(); ++i) {
+    if (m_positions[i] < m_series[i].size()) {
+      m_heap.push_back(
+          {m_series[i].columns().date[m_positions[i]], static_cast<std::uint32_t>(i)});
+    }
+  }
+  std::make_heap(m_heap.begin(), m_heap.end(), later);
+}
+
+StockData SeriesMerge::row() const {
+  const std::size_t i = source();
+  return m_series[i][m_positions[i]];
+}
+
+void SeriesMerge::next() {
+  std::pop_heap(m_heap.begin(), m_heap.end(), later);
+  Head &head = m_heap.back();
+  const PriceColumnsView &columns = m_series[head.source].columns();
+  if (++m_positions[head.source] < columns.size()) {
+    head.day = columns.date[m_positions[head.source]];
+    std::push_heap(m_heap.begin(), m_heap.end(), later);
+  } else {
+    m_heap.pop_back();
+  }
+}
+
+SymbolTable::Id SymbolTable::intern(std::string_view symbol) {
+  auto it = m_ids.find(std::string(symbol));
+  if (it != m_ids.end()) return it->second;
+
+  const Id id = static_cast<Id>(m_names.size());
+  m_names.emplace_back(symbol);
+  m_ids.emplace(m_names.back(), id);
+  return id;
+}
+
+std::optional<SymbolTable::Id> SymbolTable::find(std::string_view symbol) const {
+  auto it = m_ids.find(std::string(symbol));
+  if (it == m_ids.end()) return std::nullopt;
+  return it->second;
+}
+
+const std::string &SymbolTable::name(Id id) const { return m_names[id]; }
+
+std::size_t SymbolTable::size() const { return m_names.size(); }
+
+namespace {
+
+constexpr std::size_t kRowBytes = sizeof(std::int32_t) + 5 * sizeof(double) + sizeof(std::int64_t);
+
+// Merges two histories that are each ordered by date.
+PriceColumns merge_by_date(const PriceColumnsView &a, const PriceColumnsView &b) {
+  PriceColumns merged;
+  merged.reserve(a.size() + b.size());
+  std::size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a.date[i] <= b.date[j])) {
+      merged.append(a.row(i++));
+    } else {
+      merged.append(b.row(j++));
+    }
+  }
+  return merged;
+}
+
+// Rows that can still be appended to `columns` without reallocating.
+std::size_t room(const PriceColumns &columns) {
+  const std::size_t capacity = std::min({columns.date.capacity(), columns.adj_close.capacity(),
+                                         columns.close.capacity(), columns.high.capacity(),
+                                         columns.low.capacity(), columns.open.capacity(),
+                                         columns.volume.capacity()});
+  return capacity - columns.size();
+}
+
+bool ordered_by_date(const PriceColumnsView &rows) {
+  return std::is_sorted(rows.date.begin(), rows.date.end());
+}
+
+// `rows` stably sorted by date: rows of the same day keep their order.
+PriceColumns sorted_by_date(const PriceColumnsView &rows) {
+  std::vector<std::size_t> order(rows.size());
+  for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) { return rows.date[a] < rows.date[b]; });
+
+  PriceColumns sorted;
+  sorted.reserve(rows.size());
+  for (const std::size_t i : order) sorted.append(rows.row(i));
+  return sorted;
+}
+
+}  // namespace
+
+void StockStore::add(std::string_view symbol, PriceColumns &&rows) {
+  // A CSV file may list its rows newest first, or out of order.
+  if (!ordered_by_date(rows.view())) rows = sorted_by_date(rows.view());
+
+  std::lock_guard writer(m_write_mutex);
+  auto owned = std::make_shared<PriceColumns>(std::move(rows));
+  insert(symbol, StockSeries(std::shared_ptr<const PriceColumns>(owned)), owned);
+}
+
+void StockStore::add(std::string_view symbol, const StockSeries &rows) {
+  if (!ordered_by_date(rows.columns())) {
+    add(symbol, sorted_by_date(rows.columns()));
+    return;
+  }
+
+  std::lock_guard writer(m_write_mutex);
+  insert(symbol, rows, nullptr);
+}
+
+bool StockStore::append(std::string_view symbol, PriceColumns &&rows, std::string &error) {
+  std::vector<SymbolRows> batch;
+  batch.emplace_back(std::string(symbol), std::move(rows));
+  return append(std::move(batch), error);
+}
+
+bool StockStore::append(std::vector<SymbolRows> &&batch, std::string &error) {
+  for (const auto &[symbol, rows] : batch) {
+    if (!ordered_by_date(rows.view())) {
+      error = "Rows of " + symbol + " are not ordered by date";
+      return false;
+    }
+  }
+
+  std::lock_guard writer(m_write_mutex);
+  for (const auto &[symbol, rows] : batch) {
+    const History *history = find_history(symbol);
+    if (!history || rows.date.empty()) continue;
+    const StockSeries base = *history->latest.load();
+    if (!base.empty() && rows.date.front() < base.columns().date.back()) {
+      error = "Rows of " + symbol + " dated before its last row (" +
+              format_date(base.columns().date.back()) + ")";
+      return false;
+    }
+  }
+  for (auto &[symbol, rows] : batch) {
+    auto owned = std::make_shared<PriceColumns>(std::move(rows));
+    insert(symbol, StockSeries(std::shared_ptr<const PriceColumns>(owned)), owned);
+  }
+  return true;
+}
+
+void StockStore::insert(std::string_view symbol, const StockSeries &rows,
+                        std::shared_ptr<PriceColumns> owned) {
+  History &history = this->history(symbol);
+  const StockSeries base = *history.latest.load();
+
+  StockSeries next;
+  if (base.empty()) {
+    next = rows;
+    history.tail = std::move(owned);
+  } else if (rows.empty()) {
+    return;
+  } else if (base.columns().date.back() <= rows.columns().date.front()) {
+    // Readers only see rows [0, base.size()) of the tail, so the rows after
+    // them can be written while they read.
+    PriceColumns *tail = history.tail.get();
+    if (!tail || tail->date.data() != base.columns().date.data() ||
+        tail->size() != base.size() || room(*tail) < rows.size()) {
+      auto grown = std::make_shared<PriceColumns>();
+      const std::size_t size = base.size() + rows.size();
+      grown->reserve(size + size / 2);
+      grown->append(base.columns());
+      history.tail = std::move(grown);
+    }
+    history.tail->append(rows.columns());
+    next = StockSeries(std::shared_ptr<const PriceColumns>(history.tail));
+  } else {
+    history.tail = std::make_shared<PriceColumns>(merge_by_date(base.columns(), rows.columns()));
+    next = StockSeries(std::shared_ptr<const PriceColumns>(history.tail));
+  }
+
+  history.latest.store(std::make_shared<const StockSeries>(std::move(next)));
+}
+
+StockStore::History &StockStore::history(std::string_view symbol) {
+  {
+    std::shared_lock lock(m_mutex);
+    if (const auto id = m_symbols.find(symbol)) return m_histories[*id];
+  }
+  std::unique_lock lock(m_mutex);
+  m_symbols.intern(symbol);
+  History &history = m_histories.emplace_back();
+  history.latest.store(std::make_shared<const StockSeries>());
+  return history;
+}
+
+const StockStore::History *StockStore::find_history(std::string_view symbol) const {
+  std::shared_lock lock(m_mutex);
+  const auto id = m_symbols.find(symbol);
+  return id ? &m_histories[*id] : nullptr;
+}
+
+StockSeries StockStore::Handle::latest() const {
+  return m_history ? *m_history->latest.load() : StockSeries();
+}
+
+StockStore::Handle StockStore::handle(std::string_view symbol) const {
+  return Handle(find_history(symbol));
+}
+
+StockSeries StockStore::series(std::string_view symbol) const {
+  const History *history = find_history(symbol);
+  return history ? *history->latest.load() : StockSeries();
+}
+
+StockSeries StockStore::series(SymbolTable::Id id) const {
+  const History *history = nullptr;
+  {
+    std::shared_lock lock(m_mutex);
+    if (id < m_histories.size()) history = &m_histories[id];
+  }
+  return history ? *history->latest.load() : StockSeries();
+}
+std::optional<SymbolTable::Id> StockStore::find(std::string_view symbol) const {
+  std::shared_lock lock(m_mutex);
+  return m_symbols.find(symbol);
+}
+
+std::string StockStore::symbol(SymbolTable::Id id) const {
+  std::shared_lock lock(m_mutex);
+  return m_symbols.name(id);
+}
+
+std::size_t StockStore::size() const {
+  std::shared_lock lock(m_mutex);
+  return m_symbols.size();
+}
+
+std::size_t StockStore::memory_bytes() const {
+  std::shared_lock lock(m_mutex);
+  std::size_t bytes = 0;
+  for (const auto &history : m_histories) bytes += history.latest.load()->size() * kRowBytes;
+  return bytes;
+}
@@ -0,0 +1,285 @@
+#ifndef STOCK_STORE_HPP
+#define STOCK_STORE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Dates are stored as days since 1970-01-01.
+std::optional<std::int32_t> parse_date(std::string_view date);  // "YYYY-MM-DD"
+std::string format_date(std::int32_t epoch_day);               // "YYYY-MM-DD"
+
+// One row of a symbol's history, materialized from the columnar store.
+class StockData {
+ public:
+  StockData(std::int32_t epoch_day, double adjusted_close, double close,
+            double high, double low, double open, long long volume)
+      : m_date(epoch_day),
+        m_adj_close(adjusted_close),
+        m_close(close),
+        m_high(high),
+        m_low(low),
+        m_open(open),
+        m_volume(volume) {}
+
+  StockData(const std::string &date, double adjusted_close, double close,
+            double high, double low, double open, long long volume)
+      : StockData(parse_date(date).value_or(0), adjusted_close, close, high,
+                  low, open, volume) {}
+
+  std::string date() const { return format_date(m_date); }
+  std::int32_t epoch_day() const { return m_date; }
+  double open() const { return m_open; }
+  double high() const { return m_high; }
+  double low() const { return m_low; }
+  double close() const { return m_close; }
+  double adj_close() const { return m_adj_close; }
+  long long volume() const { return m_volume; }
+
+ private:
+  std::int32_t m_date;
+  double m_adj_close;
+  double m_close;
+  double m_high;
+  double m_low;
+  double m_open;
+  long long m_volume;
+};
+
+struct PriceColumns;
+
+// Read-only struct-of-arrays history of one symbol, wherever it is stored
+// (PriceColumns on the heap, or a memory-mapped snapshot).
+struct PriceColumnsView {
+  std::span<const std::int32_t> date;
+  std::span<const double> adj_close;
+  std::span<const double> close;
+  std::span<const double> high;
+  std::span<const double> low;
+  std::span<const double> open;
+  std::span<const std::int64_t> volume;
+
+  std::size_t size() const { return date.size(); }
+
+  StockData row(std::size_t i) const {
+    return StockData(date[i], adj_close[i], close[i], high[i], low[i], open[i], volume[i]);
+  }
+};
+
+// Struct-of-arrays history of one symbol: one contiguous array per field,
+// so a scan over a field touches only that field's cache lines.
+struct PriceColumns {
+  std::vector<std::int32_t> date;
+  std::vector<double> adj_close;
+  std::vector<double> close;
+  std::vector<double> high;
+  std::vector<double> low;
+  std::vector<double> open;
+  std::vector<std::int64_t> volume;
+
+  std::size_t size() const { return date.size(); }
+  void reserve(std::size_t n);
+  void append(const StockData &row);
+  void append(const PriceColumnsView &rows);
+
+  StockData row(std::size_t i) const {
+    return StockData(date[i], adj_close[i], close[i], high[i], low[i], open[i], volume[i]);
+  }
+
+  PriceColumnsView view() const {
+    return {date, adj_close, close, high, low, open, volume};
+  }
+
+  // Heap bytes held by the columns (capacity, not size).
+  std::size_t memory_bytes() const;
+};
+
+// Read-only view of a symbol's history. Kept for the code written against
+// the former std::vector<StockData>: rows are materialized on access.
+// The view shares ownership of the storage behind the columns, so it stays
+// valid when the store publishes a newer version of the symbol.
+class StockSeries {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StockData;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = StockData;
+
+    iterator(const PriceColumnsView *columns, std::size_t i) : m_columns(columns), m_i(i) {}
+    StockData operator*() const { return m_columns->row(m_i); }
+    iterator &operator++() { ++m_i; return *this; }
+    iterator operator++(int) { iterator it = *this; ++m_i; return it; }
+    bool operator==(const iterator &other) const { return m_i == other.m_i; }
+    bool operator!=(const iterator &other) const { return m_i != other.m_i; }
+
+   private:
+    const PriceColumnsView *m_columns;
+    std::size_t m_i;
+  };
+
+  StockSeries() = default;
+  explicit StockSeries(std::shared_ptr<const PriceColumns> columns)
+      : m_columns(columns->view()), m_owner(std::move(columns)) {}
+  // Columns stored in memory kept alive by `owner`.
+  StockSeries(const PriceColumnsView &columns, std::shared_ptr<const void> owner)
+      : m_columns(columns), m_owner(std::move(owner)) {}
+
+  std::size_t size() const { return m_columns.size(); }
+  bool empty() const { return size() == 0; }
+  StockData operator[](std::size_t i) const { return m_columns.row(i); }
+
+  iterator begin() const { return iterator(&m_columns, 0); }
+  iterator end() const { return iterator(&m_columns, size()); }
+
+  // Direct access to the arrays.
+  const PriceColumnsView &columns() const { return m_columns; }
+
+  // Rows [first, last) of the days from `first_day` to `last_day` included,
+  // found by binary search on the date column, which is sorted.
+  std::pair<std::size_t, std::size_t> rows_between(std::int32_t first_day,
+                                                   std::int32_t last_day) const;
+
+ private:
+  PriceColumnsView m_columns;
+  std::shared_ptr<const void> m_owner;
+};
+
+// Walks several series at once in date order, i.e. a k-way merge of their
+// rows. Rows of the same day come in the order of the series, so the merged
+// order is deterministic.
+class SeriesMerge {
+ public:
+  SeriesMerge() = default;
+  explicit SeriesMerge(std::vector<StockSeries> series);
+  // Starts series i at its row starts[i] instead of its first row.
+  SeriesMerge(std::vector<StockSeries> series, std::vector<std::size_t> starts);
+
+  bool done() const { return m_heap.empty(); }
+
+  // The current row and the index of its series. Require !done().
+  std::size_t source() const { return m_heap.front().source; }
+  // Index of the current row in its series.
+  std::size_t position() const { return m_positions[source()]; }
+  std::int32_t epoch_day() const { return m_heap.front().day; }
+  StockData row() const;
+
+  void next();
+
+ private:
+  struct Head {
+    std::int32_t day;
+    std::uint32_t source;
+  };
+  static bool later(const Head &a, const Head &b);
+
+  std::vector<StockSeries> m_series;
+  std::vector<std::size_t> m_positions;
+  std::vector<Head> m_heap;  // min-heap on (day, source)
+};
+
+// Interns symbol strings to dense integer ids (0, 1, 2, ...).
+class SymbolTable {
+ public:
+  using Id = std::uint32_t;
+
+  Id intern(std::string_view symbol);
+  std::optional<Id> find(std::string_view symbol) const;
+  const std::string &name(Id id) const;
+  std::size_t size() const;
+
+ private:
+  std::unordered_map<std::string, Id> m_ids;
+  std::deque<std::string> m_names;  // stable references
+};
+
+// Columnar history of every symbol, indexed by symbol id.
+//
+// Thread-safe. A symbol's published versions are immutable, and the latest
+// one is behind an atomic pointer. series() resolves the symbol under a
+// shared lock; a reader that polls a symbol (a following stream) resolves a
+// Handle once, then loads the latest version without a lock. Rows appended after the last one are written in place into
+// spare capacity of the symbol's heap columns, past the rows of every
+// published version, and a longer version is published; when the columns
+// are full they are copied into larger ones (older versions keep theirs).
+// Rows dated before the last one are merged into a new copy.
+class StockStore {
+  struct History;
+
+ public:
+  // A resolved symbol. Valid as long as the store; empty if the symbol was
+  // unknown.
+  class Handle {
+   public:
+    Handle() = default;
+    explicit operator bool() const { return m_history != nullptr; }
+    // The latest version: one atomic load.
+    StockSeries latest() const;
+
+   private:
+    friend class StockStore;
+    explicit Handle(const History *history) : m_history(history) {}
+    const History *m_history = nullptr;
+  };
+
+  // Adds `rows` to the history of `symbol`, keeping it ordered by date.
+  void add(std::string_view symbol, PriceColumns &&rows);
+  // Same, for columns stored elsewhere; a new symbol shares `rows` as is.
+  void add(std::string_view symbol, const StockSeries &rows);
+
+  // Appends `rows`, ordered by date, after the last row of `symbol`. Returns
+  // false with `error` set, adding nothing, if they are not ordered or one
+  // is dated before that last row.
+  bool append(std::string_view symbol, PriceColumns &&rows, std::string &error);
+
+  // Same for several symbols at once: all of them are checked, then all
+  // appended, under one hold of the writer lock, so a concurrent writer
+  // cannot make the batch fail halfway.
+  using SymbolRows = std::pair<std::string, PriceColumns>;
+  bool append(std::vector<SymbolRows> &&batch, std::string &error);
+
+  StockSeries series(std::string_view symbol) const;
+  StockSeries series(SymbolTable::Id id) const;
+  Handle handle(std::string_view symbol) const;
+
+  std::optional<SymbolTable::Id> find(std::string_view symbol) const;
+  std::string symbol(SymbolTable::Id id) const;
+  std::size_t size() const;  // number of symbols
+  std::size_t memory_bytes() const;  // bytes of column data
+
+ private:
+  struct History {
+    std::atomic<std::shared_ptr<const StockSeries>> latest;
+    // The heap columns behind `latest`, if they are the store's; only the
+    // writer touches them.
+    std::shared_ptr<PriceColumns> tail;
+  };
+
+  // Publishes `rows` added to `symbol`. `owned` holds them if the store may
+  // append to them in place. Requires m_write_mutex.
+  void insert(std::string_view symbol, const StockSeries &rows,
+              std::shared_ptr<PriceColumns> owned);
+  // The history of `symbol`, created if new. Requires m_write_mutex.
+  History &history(std::string_view symbol);
+  const History *find_history(std::string_view symbol) const;
+
+  mutable std::shared_mutex m_mutex;  // guards the table and the list of histories
+  std::mutex m_write_mutex;          // serializes add() and append()
+  SymbolTable m_symbols;
+  std::deque<History> m_histories;    // by id; stable references
+};
+
+#endif
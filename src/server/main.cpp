@@ -1,7 +1,18 @@
 #include "MarketDataServer.hpp"
+#include "AsyncMarketDataServer.hpp"
+#include "SharedMemoryFeed.hpp"
+#include "Snapshot.hpp"
+#include "utilities/logger.hpp"
+#include "utilities/thread_pool.hpp"
 #include <grpcpp/grpcpp.h>
 #include <iostream>
 #include <filesystem>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
@@ -18,38 +29,166 @@ std::vector<std::string> collect_files_from_directory(const std::string &directo
     return files;
 }
 
+// A snapshot is fresh if it was written from the same CSV files, by name and
+// size, as `sources`, and is newer than every one of them.
+bool snapshot_is_fresh(const std::string &snapshot, const std::vector<std::string> &files,
+                       const std::vector<SnapshotSource> &sources) {
+    std::error_code ec;
+    const auto snapshot_time = fs::last_write_time(snapshot, ec);
+    if (ec) return false;
+
+    const bool newer = std::all_of(files.begin(), files.end(), [&](const std::string &file) {
+        const auto file_time = fs::last_write_time(file, ec);
+        return !ec && file_time <= snapshot_time;
+    });
+    if (!newer) return false;
+
+    std::string error;
+    const auto opened = Snapshot::open(snapshot, false, error);
+    return opened && opened->sources() == sources;
+}
+
+// Usage: marketdata_server [address] [--engine=sync|async] [--threads=N]
+//                          [--fanout=drop|conflate|disconnect] [--max-queued=N]
+//   --engine=sync  : one gRPC thread per subscriber (default)
+//   --engine=async : completion-queue engine, N subscriptions per thread
+//   --threads=N    : number of completion-queue workers for the async engine
+//   --fanout=...   : async engine sharing one replay per symbol between its
+//                    subscribers, with the given slow-consumer policy
+//   --max-queued=N : ticks queued per fan-out subscriber before the policy applies
+//   --snapshot=PATH: binary snapshot served instead of the CSV files when it
+//                    is newer than all of them, and rewritten otherwise
+//                    (default: data/marketdata.snap)
+//   --no-snapshot  : always load the CSV files, do not write a snapshot
+//   --verify-snapshot : also verify the checksum of the snapshot column data
+//   --replay=SPEC  : pacing of the subscriptions that do not request their own:
+//                    afap, rate:MSGS_PER_SEC, historical:DAYS_PER_SEC,
+//                    uniform:MIN_US:MAX_US or exponential:MIN_US:MAX_US
+//                    (default: uniform:100000:1000000)
+//   --seed=N       : seed of the jitter modes, for reproducible runs
+//   --log-level=L  : trace, debug, info (default), warn, error or off; every
+//                    sent update is logged at debug
+//   --stats-interval=S : log the server metrics (see ServerMetrics) every S
+//                    seconds (default 0: never; they are always served by GetStats)
+//   --shm[=NAME]   : also serve same-host subscribers from the shared-memory
+//                    object NAME (default /marketdata), see SharedMemoryFeed
+//   --shm-capacity=N : ticks per symbol ring of the shared-memory feed (default 4096)
 int main(int argc, char** argv) {
 
     std::string server_address("0.0.0.0:0"); //default address.
     bool custom_portal = false;
+    bool async_engine = false;
+    unsigned int async_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool fanout = false;
+    FanoutOptions fanout_options;
+    std::string csv_dir = CSV_DATA_DIR;
+    std::string snapshot_path = (fs::path(csv_dir).parent_path() / "marketdata.snap").string();
+    bool use_snapshot = true;
+    bool verify_snapshot = false;
+    ReplayOptions replay;
+    std::chrono::seconds stats_interval(0);
+    bool shared_memory = false;
+    SharedMemoryOptions shm_options;
 
-    if (argc > 1) {
-        server_address = argv[1];
-        custom_portal = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=async") {
+            async_engine = true;
+        } else if (arg == "--engine=sync") {
+            async_engine = false;
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            async_threads = static_cast<unsigned int>(std::stoul(arg.substr(10)));
+        } else if (arg.rfind("--fanout=", 0) == 0) {
+            std::string policy = arg.substr(9);
+            if (policy == "drop") {
+                fanout_options.policy = SlowConsumerPolicy::Drop;
+            } else if (policy == "conflate") {
+                fanout_options.policy = SlowConsumerPolicy::Conflate;
+            } else if (policy == "disconnect") {
+                fanout_options.policy = SlowConsumerPolicy::Disconnect;
+            } else {
+                std::cerr << "Unknown slow-consumer policy: " << policy << std::endl;
+                return 1;
+            }
+            fanout = true;
+            async_engine = true;
+        } else if (arg.rfind("--max-queued=", 0) == 0) {
+            fanout_options.max_queued = std::stoul(arg.substr(13));
+        } else if (arg.rfind("--snapshot=", 0) == 0) {
+            snapshot_path = arg.substr(11);
+        } else if (arg == "--no-snapshot") {
+            use_snapshot = false;
+        } else if (arg == "--verify-snapshot") {
+            verify_snapshot = true;
+        } else if (arg.rfind("--replay=", 0) == 0) {
+            std::string error;
+            if (!parse_replay(arg.substr(9), replay, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            replay.seed = std::stoull(arg.substr(7));
+        } else if (arg.rfind("--log-level=", 0) == 0) {
+            util::log_level level;
+            if (!util::parse_log_level(arg.substr(12), level)) {
+                std::cerr << "Unknown log level: " << arg.substr(12) << std::endl;
+                return 1;
+            }
+            util::default_logger().set_level(level);
+        } else if (arg.rfind("--stats-interval=", 0) == 0) {
+            stats_interval = std::chrono::seconds(std::stoul(arg.substr(17)));
+        } else if (arg == "--shm") {
+            shared_memory = true;
+        } else if (arg.rfind("--shm=", 0) == 0) {
+            shared_memory = true;
+            shm_options.name = arg.substr(6);
+        } else if (arg.rfind("--shm-capacity=", 0) == 0) {
+            shm_options.ring_capacity = std::stoul(arg.substr(15));
+        } else {
+            server_address = arg;
+            custom_portal = false;
+        }
     }
 
     MarketDataServiceImpl service;
+    service.set_replay(replay);
+    SharedMemoryFeed shm_feed(service, shm_options);
+    if (shared_memory) {
+        std::string error;
+        if (!shm_feed.start(error)) {
+            std::cerr << "Failed to create the shared-memory feed: " << error << std::endl;
+            return 1;
+        }
+        service.set_shared_memory(&shm_feed);
+    }
+    AsyncMarketDataServer async_service(service, async_threads);
     std::unique_ptr<int> selected_port = std::make_unique<int>();
 
     grpc::ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials(), selected_port.get());
-    builder.RegisterService(&service);
+    if (fanout) {
+        async_service.set_fanout(fanout_options);
+    }
+    if (async_engine) {
+        async_service.configure(builder);
+    } else {
+        builder.RegisterService(&service);
+    }
 
+    // Symbols are served as soon as they are loaded; until the load phase
+    // ends, subscribers of a symbol that is not loaded yet wait for it.
+    service.begin_loading();
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
 
     if (!server) {
         std::cerr << "Failed to start server." << std::endl;
+        return 1;
     }
 
-    std::string csv_dir = CSV_DATA_DIR;
-    
-    auto files = collect_files_from_directory(csv_dir, ".csv");
-    std::cout << "Found " << files.size() << " CSV files:\n";
-    for (const auto& f : files) {
-        std::cout << "  " << f << "\n";
-        service.load_data(f);
+    if (async_engine) {
+        async_service.start();
+        std::cout << "Using async engine with " << async_service.size() << " worker threads\n";
     }
-        
 
     if (custom_portal) {
         std::cout << "MarketData server listening on " << server_address << std::endl;
@@ -57,6 +196,53 @@ int main(int argc, char** argv) {
         std::cout << "MarketData server listening on " << *selected_port << std::endl;
     }
 
+    const auto start = std::chrono::steady_clock::now();
+    auto files = collect_files_from_directory(csv_dir, ".csv");
+    const std::vector<SnapshotSource> sources = snapshot_sources(files);
+
+    if (use_snapshot && snapshot_is_fresh(snapshot_path, files, sources) &&
+        service.load_snapshot(snapshot_path, verify_snapshot)) {
+        service.end_loading();
+        std::cout << "Serving snapshot " << snapshot_path << "\n";
+    } else {
+        std::cout << "Found " << files.size() << " CSV files\n";
+        util::thread_pool loaders(std::max(1u, std::thread::hardware_concurrency()));
+        service.load_files(files, loaders);
+        service.end_loading();
+
+        if (use_snapshot && service.save_snapshot(snapshot_path, sources)) {
+            std::cout << "Wrote snapshot " << snapshot_path << "\n";
+        }
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Loaded " << service.getStockData().size() << " symbols in "
+              << elapsed.count() << " ms" << std::endl;
+
+    std::mutex stats_mutex;
+    std::condition_variable stats_cv;
+    bool stopping = false;
+    std::thread stats_dumper;
+    if (stats_interval.count() > 0) {
+        stats_dumper = std::thread([&] {
+            std::unique_lock<std::mutex> lock(stats_mutex);
+            while (!stats_cv.wait_for(lock, stats_interval, [&] { return stopping; })) {
+                std::ostringstream dump;
+                service.metrics().registry().dump(dump);
+                UTIL_LOG(info, "[Server] Metrics:\n{}", dump.str());
+            }
+        });
+    }
+
     server->Wait();
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stopping = true;
+    }
+    stats_cv.notify_all();
+    if (stats_dumper.joinable()) stats_dumper.join();
+    async_service.stop();
+    shm_feed.stop();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace util
+{
+    // Lock-free histogram of non-negative integer values (e.g. latencies in
+    // microseconds) with HdrHistogram-style log-linear buckets: values below
+    // 2^SUB_BUCKET_BITS have a bucket each, larger ones fall into one of
+    // 2^(SUB_BUCKET_BITS-1) buckets per power of two, so every value is
+    // known to within 1/128 of itself (0.8%) with a few thousand buckets.
+    //
+    // record() is a couple of relaxed atomic increments, safe from any
+    // number of threads. Readers see a consistent-enough view for reporting
+    // while writers run; merge() adds another histogram's counts.
+    class latency_histogram
+    {
+        public:
+        static constexpr unsigned int SUB_BUCKET_BITS = 8;
+        // Larger values are counted in the last bucket (max() stays exact).
+        static constexpr unsigned int MAX_VALUE_BITS = 36;
+
+        latency_histogram() = default;
+        latency_histogram(const latency_histogram &) = delete;
+        latency_histogram &operator=(const latency_histogram &) = delete;
+
+        void record(std::uint64_t value);
+
+        std::uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+        std::uint64_t min() const;  // 0 if empty
+        std::uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+        double mean() const;
+
+        // Smallest value such that `percent`% of the recorded values are at
+        // or below it, up to the bucket precision. 0 if empty.
+        std::uint64_t percentile(double percent) const;
+
+        // Adds the values of `other` to this histogram.
+        void merge(const latency_histogram &other);
+
+        void reset();
+
+        private:
+        static constexpr std::size_t LINEAR_BUCKETS = std::size_t(1) << SUB_BUCKET_BITS;
+        static constexpr std::size_t HALF = LINEAR_BUCKETS / 2;
+        static constexpr std::size_t BUCKETS =
+            LINEAR_BUCKETS + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * HALF;
+
+        static std::size_t bucket_of(std::uint64_t value);
+        static std::uint64_t highest_value_of(std::size_t bucket);
+
+        std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets{};
+        std::atomic<std::uint64_t> m_count{0};
+        std::atomic<std::uint64_t> m_sum{0};
+        std::atomic<std::uint64_t> m_min{std::numeric_limits<std::uint64_t>::max()};
+        std::atomic<std::uint64_t> m_max{0};
+    };
+
+
+    inline std::size_t latency_histogram::bucket_of(std::uint64_t value)
+    {
+        if (value < LINEAR_BUCKETS) return static_cast<std::size_t>(value);
+
+        // The SUB_BUCKET_BITS - 1 bits below the leading one select the
+        // bucket within the power of two.
+        const unsigned int msb = 63 - static_cast<unsigned int>(std::countl_zero(value));
+        if (msb >= MAX_VALUE_BITS) return BUCKETS - 1;
+        const unsigned int shift = msb - (SUB_BUCKET_BITS - 1);
+        const std::size_t sub = static_cast<std::size_t>(value >> shift) - HALF;
+        return LINEAR_BUCKETS + (shift - 1) * HALF + sub;
+    }
+
+    inline std::uint64_t latency_histogram::highest_value_of(std::size_t bucket)
+    {
+        if (bucket < LINEAR_BUCKETS) return bucket;
+        const std::size_t shift = (bucket - LINEAR_BUCKETS) / HALF + 1;
+        const std::uint64_t sub = (bucket - LINEAR_BUCKETS) % HALF + HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    inline void latency_histogram::record(std::uint64_t value)
+    {
+        m_buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+
+        std::uint64_t current = m_max.load(std::memory_order_relaxed);
+        while (value > current &&
+               !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+        current = m_min.load(std::memory_order_relaxed);
+        while (value < current &&
+               !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    inline std::uint64_t latency_histogram::min() const
+    {
+        return count() == 0 ? 0 : m_min.load(std::memory_order_relaxed);
+    }
+
+    inline double latency_histogram::mean() const
+    {
+        const std::uint64_t n = count();
+        return n == 0 ? 0.0 : static_cast<double>(m_sum.load(std::memory_order_relaxed)) / n;
+    }
+
+    inline std::uint64_t latency_histogram::percentile(double percent) const
+    {
+        const std::uint64_t n = count();
+        if (n == 0) return 0;
+        if (percent < 0) percent = 0;
+        if (percent > 100) percent = 100;
+
+        // Rank of the value, at least the first one.
+        auto rank = static_cast<std::uint64_t>(percent / 100.0 * static_cast<double>(n) + 0.5);
+        if (rank == 0) rank = 1;
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                const std::uint64_t value = highest_value_of(i);
+                return value < max() ? value : max();
+            }
+        }
+        return max();  // counts raced ahead of the buckets
+    }
+
+    inline void latency_histogram::merge(const latency_histogram &other)
+    {
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            const std::uint64_t n = other.m_buckets[i].load(std::memory_order_relaxed);
+            if (n != 0) m_buckets[i].fetch_add(n, std::memory_order_relaxed);
+        }
+        m_count.fetch_add(other.count(), std::memory_order_relaxed);
+        m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        const std::uint64_t other_max = other.max();
+        std::uint64_t current = m_max.load(std::memory_order_relaxed);
+        while (other_max > current &&
+               !m_max.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {
+        }
+        const std::uint64_t other_min = other.m_min.load(std::memory_order_relaxed);
+        current = m_min.load(std::memory_order_relaxed);
+        while (other_min < current &&
+               !m_min.compare_exchange_weak(current, other_min, std::memory_order_relaxed)) {
+        }
+    }
+
+    inline void latency_histogram::reset()
+    {
+        for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+}  // namespace util
+
+#endif
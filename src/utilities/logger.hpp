@@ -0,0 +1,482 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "spsc_queue.hpp"
+
+// Levels below UTIL_LOG_ACTIVE_LEVEL are compiled out of the UTIL_LOG*
+// macros, arguments included (0 = trace ... 4 = error). Define it to 2 to
+// drop the per-tick debug lines from a build.
+#ifndef UTIL_LOG_ACTIVE_LEVEL
+#define UTIL_LOG_ACTIVE_LEVEL 0
+#endif
+
+namespace util
+{
+    enum class log_level : std::uint8_t { trace, debug, info, warn, error, off };
+
+    // Parses "trace", "debug", "info", "warn", "error" or "off".
+    bool parse_log_level(std::string_view name, log_level &level);
+
+    struct logger_options
+    {
+        log_level level = log_level::info;
+        std::size_t ring_capacity = 256;  // records per producer thread
+        // How long the background thread sleeps when every ring is empty.
+        std::chrono::microseconds idle_sleep = std::chrono::milliseconds(1);
+        // Receives each batch of formatted lines; `error` batches hold the
+        // warn and error lines. Default: stdout and stderr.
+        std::function<void(std::string_view text, bool error)> sink;
+    };
+
+    // Asynchronous logger for hot paths.
+    //
+    // A log call only captures its arguments: it copies them, with a
+    // pointer to the format string, into a fixed-size binary record pushed
+    // onto a lock-free ring owned by the calling thread. A background thread
+    // drains the rings, formats the records ("{}" placeholders, each
+    // replaced by the next argument through operator<<) and hands the lines
+    // to the sink in one write per batch.
+    //
+    // Callers never block: when their ring is full the record is dropped
+    // and counted, and the drops are reported. Lines of one thread keep
+    // their order; lines of different threads are only ordered per batch.
+    //
+    // The format string and `const char *` arguments are stored as
+    // pointers, so they must be string literals (the macros enforce it for
+    // the format); pass anything else as std::string or std::string_view,
+    // which are copied.
+    class logger
+    {
+        public:
+        explicit logger(logger_options options = {});
+        ~logger();  // writes the pending records
+
+        logger(const logger &) = delete;
+        logger &operator=(const logger &) = delete;
+
+        bool enabled(log_level level) const
+        {
+            return level >= m_level.load(std::memory_order_relaxed);
+        }
+        void set_level(log_level level) { m_level.store(level, std::memory_order_relaxed); }
+
+        template <class... Args>
+        void log(log_level level, const char *format, Args &&...args);
+
+        // Returns once every record logged before the call is written.
+        void flush();
+
+        // Records dropped because a ring was full.
+        std::uint64_t dropped() const;
+
+        private:
+        // Record size, arguments included; one record never spans more.
+        static constexpr std::size_t RECORD_SIZE = 192;
+
+        struct record_ops
+        {
+            void (*format)(std::ostream &out, const char *format, void *args);
+            void (*relocate)(void *to, void *from);  // move-constructs, destroys `from`
+            void (*destroy)(void *args);
+        };
+
+        struct record
+        {
+            static constexpr std::size_t ARGS_SIZE =
+                RECORD_SIZE - sizeof(const record_ops *) - sizeof(const char *) - 8;
+
+            record() = default;
+            template <class Tuple, class... Args>
+            record(log_level l, const char *f, std::in_place_type_t<Tuple>, Args &&...args);
+            record(record &&other) noexcept;
+            record &operator=(record &&other) noexcept;
+            ~record();
+
+            const record_ops *ops = nullptr;
+            const char *format = nullptr;
+            log_level level = log_level::info;
+            alignas(8) unsigned char args[ARGS_SIZE];
+        };
+
+        struct ring
+        {
+            explicit ring(std::size_t capacity) : records(capacity) {}
+
+            spsc_queue<record> records;
+            std::atomic<std::uint64_t> dropped{0};
+            std::atomic<bool> closed{false};  // its thread exited
+        };
+
+        // A thread's ring for each logger it used.
+        struct thread_rings
+        {
+            struct entry
+            {
+                std::uint64_t logger_id;
+                std::shared_ptr<ring> queue;
+            };
+            ~thread_rings();
+            std::vector<entry> entries;
+        };
+
+        template <class Tuple>
+        static const record_ops *ops_for();
+
+        template <class T>
+        using stored_t = std::conditional_t<
+            std::is_same_v<std::decay_t<T>, std::string_view>, std::string, std::decay_t<T>>;
+
+        ring &local_ring();
+        void run();
+        bool drain(std::string &out, std::string &err);
+        void write(const std::string &text, bool error);
+
+        static std::uint64_t next_id();
+
+        const std::uint64_t m_id = next_id();
+        logger_options m_options;
+        std::atomic<log_level> m_level;
+
+        mutable std::mutex m_rings_mutex;
+        std::vector<std::shared_ptr<ring>> m_rings;  // guarded by m_rings_mutex
+        std::atomic<std::uint64_t> m_retired_drops{0};  // of the rings removed
+
+        std::mutex m_flush_mutex;
+        std::condition_variable m_flushed;
+        std::uint64_t m_flush_requests = 0;  // guarded by m_flush_mutex
+        std::uint64_t m_flushes_done = 0;    // guarded by m_flush_mutex
+        std::uint64_t m_reported_drops = 0;  // background thread only
+
+        std::atomic<bool> m_stop{false};
+        std::ostringstream m_stream;  // background thread only
+        std::thread m_thread;
+    };
+
+    // Process-wide logger used by the UTIL_LOG macros.
+    logger &default_logger();
+
+    namespace detail
+    {
+        inline void format_args(std::ostream &out, const char *format)
+        {
+            out << format;
+        }
+
+        // Replaces each "{}" of `format` by the next argument.
+        template <class T, class... Rest>
+        void format_args(std::ostream &out, const char *format, const T &first, const Rest &...rest)
+        {
+            const char *p = format;
+            while (*p && !(p[0] == '{' && p[1] == '}')) ++p;
+            out.write(format, p - format);
+            if (!*p) return;  // more arguments than placeholders
+            out << first;
+            format_args(out, p + 2, rest...);
+        }
+    }
+
+
+    inline bool parse_log_level(std::string_view name, log_level &level)
+    {
+        static constexpr std::pair<std::string_view, log_level> names[] = {
+            {"trace", log_level::trace}, {"debug", log_level::debug}, {"info", log_level::info},
+            {"warn", log_level::warn},   {"error", log_level::error}, {"off", log_level::off}};
+        for (const auto &[n, l] : names) {
+            if (n == name) {
+                level = l;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class Tuple>
+    inline const logger::record_ops *logger::ops_for()
+    {
+        static constexpr record_ops ops = {
+            [](std::ostream &out, const char *format, void *args) {
+                std::apply([&](const auto &...values) { detail::format_args(out, format, values...); },
+                           *static_cast<Tuple *>(args));
+            },
+            [](void *to, void *from) {
+                ::new (to) Tuple(std::move(*static_cast<Tuple *>(from)));
+                static_cast<Tuple *>(from)->~Tuple();
+            },
+            [](void *args) { static_cast<Tuple *>(args)->~Tuple(); },
+        };
+        return &ops;
+    }
+
+    template <class Tuple, class... Args>
+    inline logger::record::record(log_level l, const char *f, std::in_place_type_t<Tuple>,
+                                  Args &&...values)
+        : ops(ops_for<Tuple>()), format(f), level(l)
+    {
+        ::new (static_cast<void *>(args)) Tuple(std::forward<Args>(values)...);
+    }
+
+    inline logger::record::record(record &&other) noexcept
+        : ops(other.ops), format(other.format), level(other.level)
+    {
+        if (ops) ops->relocate(args, other.args);
+        other.ops = nullptr;
+    }
+
+    inline logger::record &logger::record::operator=(record &&other) noexcept
+    {
+        if (this != &other) {
+            if (ops) ops->destroy(args);
+            ops = other.ops;
+            format = other.format;
+            level = other.level;
+            if (ops) ops->relocate(args, other.args);
+            other.ops = nullptr;
+        }
+        return *this;
+    }
+
+    inline logger::record::~record()
+    {
+        if (ops) ops->destroy(args);
+    }
+
+    template <class... Args>
+    inline void logger::log(log_level level, const char *format, Args &&...args)
+    {
+        using Tuple = std::tuple<stored_t<Args>...>;
+        static_assert(sizeof(Tuple) <= record::ARGS_SIZE,
+                      "log arguments too large for one record; log fewer or smaller values");
+        static_assert(alignof(Tuple) <= 8, "over-aligned log argument");
+
+        if (!enabled(level)) return;
+        ring &r = local_ring();
+        if (!r.records.try_emplace(level, format, std::in_place_type<Tuple>,
+                                   std::forward<Args>(args)...)) {
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::uint64_t logger::next_id()
+    {
+        static std::atomic<std::uint64_t> id{1};
+        return id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline logger::thread_rings::~thread_rings()
+    {
+        for (auto &e : entries) e.queue->closed.store(true, std::memory_order_release);
+    }
+
+    inline logger::ring &logger::local_ring()
+    {
+        // Keyed by id rather than address: a logger may be destroyed and
+        // another one created at the same address.
+        thread_local thread_rings rings;
+        for (auto &e : rings.entries) {
+            if (e.logger_id == m_id) return *e.queue;
+        }
+
+        auto r = std::make_shared<ring>(m_options.ring_capacity);
+        {
+            std::lock_guard<std::mutex> lock(m_rings_mutex);
+            m_rings.push_back(r);
+        }
+        rings.entries.push_back({m_id, r});
+        return *r;
+    }
+
+    inline logger::logger(logger_options options)
+        : m_options(std::move(options)), m_level(m_options.level)
+    {
+        m_thread = std::thread([this] { run(); });
+    }
+
+    inline logger::~logger()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_flush_mutex);
+            m_stop.store(true, std::memory_order_release);
+        }
+        m_flushed.notify_all();
+        m_thread.join();
+    }
+
+    inline std::uint64_t logger::dropped() const
+    {
+        std::lock_guard<std::mutex> lock(m_rings_mutex);
+        std::uint64_t total = m_retired_drops.load(std::memory_order_relaxed);
+        for (const auto &r : m_rings) total += r->dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    inline void logger::flush()
+    {
+        std::unique_lock<std::mutex> lock(m_flush_mutex);
+        const std::uint64_t ticket = ++m_flush_requests;
+        m_flushed.notify_all();  // wakes the background thread
+        m_flushed.wait(lock, [&] { return m_flushes_done >= ticket; });
+    }
+
+    inline void logger::write(const std::string &text, bool error)
+    {
+        if (text.empty()) return;
+        if (m_options.sink) {
+            m_options.sink(text, error);
+        } else {
+            std::FILE *file = error ? stderr : stdout;
+            std::fwrite(text.data(), 1, text.size(), file);
+            std::fflush(file);
+        }
+    }
+
+    // Formats every record queued so far. Returns false if there was none.
+    inline bool logger::drain(std::string &out, std::string &err)
+    {
+        std::vector<std::shared_ptr<ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(m_rings_mutex);
+            rings = m_rings;
+        }
+
+        constexpr std::size_t BATCH = 64;
+        record batch[BATCH];
+        bool any = false;
+
+        for (const auto &r : rings) {
+            // Checked first: a closed ring gets no more records after it.
+            const bool closed = r->closed.load(std::memory_order_acquire);
+            std::size_t n;
+            while ((n = r->records.try_pop_bulk(batch, BATCH)) > 0) {
+                any = true;
+                for (std::size_t i = 0; i < n; ++i) {
+                    m_stream.str(std::string());
+                    batch[i].ops->format(m_stream, batch[i].format, batch[i].args);
+                    m_stream << '\n';
+                    (batch[i].level >= log_level::warn ? err : out) += m_stream.str();
+                    batch[i] = record();
+                }
+            }
+            if (closed) {
+                std::lock_guard<std::mutex> lock(m_rings_mutex);
+                m_rings.erase(std::find(m_rings.begin(), m_rings.end(), r));
+                m_retired_drops.fetch_add(r->dropped.load(std::memory_order_relaxed),
+                                          std::memory_order_relaxed);
+            }
+        }
+
+        const std::uint64_t drops = dropped();
+        if (drops > m_reported_drops) {
+            err += "[Logger] " + std::to_string(drops - m_reported_drops) +
+                   " messages dropped (ring full)\n";
+            m_reported_drops = drops;
+        }
+        return any;
+    }
+
+    inline void logger::run()
+    {
+        std::string out;
+        std::string err;
+
+        while (true) {
+            std::uint64_t requests;
+            {
+                std::lock_guard<std::mutex> lock(m_flush_mutex);
+                requests = m_flush_requests;
+            }
+            const bool stopping = m_stop.load(std::memory_order_acquire);
+
+            // Drains until empty, so that a flush covers everything logged
+            // before it was requested.
+            bool any = false;
+            while (drain(out, err)) {
+                any = true;
+                write(out, false);
+                write(err, true);
+                out.clear();
+                err.clear();
+            }
+            write(err, true);  // drop reports
+            err.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_flush_mutex);
+                m_flushes_done = requests;
+            }
+            m_flushed.notify_all();
+
+            if (stopping) return;
+            if (!any) {
+                std::unique_lock<std::mutex> lock(m_flush_mutex);
+                m_flushed.wait_for(lock, m_options.idle_sleep, [&] {
+                    return m_flush_requests != m_flushes_done ||
+                           m_stop.load(std::memory_order_relaxed);
+                });
+            }
+        }
+    }
+
+    inline logger &default_logger()
+    {
+        static logger instance;
+        return instance;
+    }
+
+    // Lowest level compiled into the UTIL_LOG* macros. A variable rather than
+    // the macro's literal, so that the default of 0 is not a comparison
+    // against the type's limit (-Wtype-limits).
+    inline constexpr int log_active_level = UTIL_LOG_ACTIVE_LEVEL;
+
+    // True if `level` is compiled into the UTIL_LOG* macros.
+    constexpr bool log_level_compiled(log_level level)
+    {
+        return static_cast<int>(level) >= log_active_level;
+    }
+
+}  // namespace util
+
+// Logs through util::default_logger() if `level` (trace, debug, info, warn or
+// error) is compiled in and enabled; the arguments are not evaluated
+// otherwise. The format must be a string literal.
+#define UTIL_LOG(level, format, ...)                                                    \
+    do {                                                                                \
+        if constexpr (util::log_level_compiled(util::log_level::level)) {               \
+            util::logger &util_log_ = util::default_logger();                           \
+            if (util_log_.enabled(util::log_level::level)) {                            \
+                util_log_.log(util::log_level::level, "" format "" __VA_OPT__(, ) __VA_ARGS__); \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+// Same, for one in `n` calls per thread and call site (n <= 1: every call).
+#define UTIL_LOG_EVERY_N(level, n, format, ...)                                         \
+    do {                                                                                \
+        if constexpr (util::log_level_compiled(util::log_level::level)) {               \
+            static thread_local std::uint64_t util_log_calls_ = 0;                      \
+            const auto util_log_n_ = static_cast<std::uint64_t>(n);                     \
+            if (util_log_n_ <= 1 || util_log_calls_++ % util_log_n_ == 0) {             \
+                UTIL_LOG(level, format __VA_OPT__(, ) __VA_ARGS__);                     \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "latency_histogram.hpp"
+#include "spin_wait.hpp"
+
+namespace util
+{
+    namespace detail
+    {
+        // Number of shards of a metric: the hardware threads, rounded up to
+        // a power of two and capped, so that concurrent writers rarely share
+        // a cache line.
+        inline std::size_t metric_shards()
+        {
+            static const std::size_t shards = round_up_pow2(
+                std::clamp(std::thread::hardware_concurrency(), 1u, 16u));
+            return shards;
+        }
+
+        // Small number of the calling thread, handed out round-robin on
+        // first use, that picks its shard of every metric.
+        inline std::size_t thread_shard()
+        {
+            static std::atomic<std::size_t> next{0};
+            thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed);
+            return shard;
+        }
+    }
+
+    // Counter (unsigned) or gauge (signed) split into per-thread shards.
+    //
+    // add() is one relaxed atomic add on a cache line that the calling
+    // thread rarely shares, i.e. a few ns; value() sums the shards, so it
+    // is the slow side and may miss adds that are in progress.
+    template <class T>
+    class sharded_value
+    {
+        public:
+        sharded_value()
+            : m_mask(detail::metric_shards() - 1),
+              m_shards(std::make_unique<shard[]>(detail::metric_shards()))
+        {
+        }
+
+        sharded_value(const sharded_value &) = delete;
+        sharded_value &operator=(const sharded_value &) = delete;
+
+        void add(T n = 1)
+        {
+            m_shards[detail::thread_shard() & m_mask].value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        void sub(T n = 1) { add(static_cast<T>(-n)); }
+
+        T value() const
+        {
+            T sum = 0;
+            for (std::size_t i = 0; i <= m_mask; ++i) {
+                sum += m_shards[i].value.load(std::memory_order_relaxed);
+            }
+            return sum;
+        }
+
+        private:
+        struct alignas(CACHE_LINE_SIZE) shard
+        {
+            std::atomic<T> value{0};
+        };
+
+        std::size_t m_mask;
+        std::unique_ptr<shard[]> m_shards;
+    };
+
+    using sharded_counter = sharded_value<std::uint64_t>;
+    using sharded_gauge = sharded_value<std::int64_t>;
+
+    // latency_histogram split into per-thread shards, merged on read.
+    class sharded_histogram
+    {
+        public:
+        sharded_histogram()
+            : m_mask(detail::metric_shards() - 1),
+              m_shards(std::make_unique<latency_histogram[]>(detail::metric_shards()))
+        {
+        }
+
+        sharded_histogram(const sharded_histogram &) = delete;
+        sharded_histogram &operator=(const sharded_histogram &) = delete;
+
+        void record(std::uint64_t value) { m_shards[detail::thread_shard() & m_mask].record(value); }
+
+        // Adds every shard to `into`.
+        void merge_into(latency_histogram &into) const
+        {
+            for (std::size_t i = 0; i <= m_mask; ++i) into.merge(m_shards[i]);
+        }
+
+        private:
+        std::size_t m_mask;
+        std::unique_ptr<latency_histogram[]> m_shards;
+    };
+
+    // Named metrics, each with an optional label (a symbol, a file...).
+    //
+    // Looking a metric up takes a lock and may allocate, so the hot paths
+    // look theirs up once and keep the reference, which stays valid for the
+    // lifetime of the registry. Reading (snapshot(), dump()) aggregates the
+    // shards and may run concurrently with the writers.
+    class metrics_registry
+    {
+        public:
+        enum class kind { counter, gauge, histogram };
+
+        struct sample
+        {
+            std::string name;
+            std::string label;
+            kind type = kind::counter;
+            std::int64_t value = 0;  // counter, gauge
+            // Histogram:
+            std::uint64_t count = 0;
+            double mean = 0;
+            std::uint64_t p50 = 0;
+            std::uint64_t p99 = 0;
+            std::uint64_t p999 = 0;
+            std::uint64_t max = 0;
+        };
+
+        sharded_counter &counter(std::string_view name, std::string_view label = {})
+        {
+            return find(m_counters, name, label);
+        }
+
+        sharded_gauge &gauge(std::string_view name, std::string_view label = {})
+        {
+            return find(m_gauges, name, label);
+        }
+
+        sharded_histogram &histogram(std::string_view name, std::string_view label = {})
+        {
+            return find(m_histograms, name, label);
+        }
+
+        // Every metric whose name starts with `prefix`, by name then label.
+        std::vector<sample> snapshot(std::string_view prefix = {}) const;
+
+        // snapshot() as text, one metric per line:
+        //   name{label} value
+        //   name{label} count=N mean=M p50=A p99=B p999=C max=D
+        void dump(std::ostream &out, std::string_view prefix = {}) const;
+
+        private:
+        using key = std::pair<std::string, std::string>;
+
+        template <class Metric>
+        Metric &find(std::map<key, std::unique_ptr<Metric>, std::less<>> &metrics,
+                     std::string_view name, std::string_view label)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto &metric = metrics[key(name, label)];
+            if (!metric) metric = std::make_unique<Metric>();
+            return *metric;
+        }
+
+        mutable std::mutex m_mutex;
+        std::map<key, std::unique_ptr<sharded_counter>, std::less<>> m_counters;
+        std::map<key, std::unique_ptr<sharded_gauge>, std::less<>> m_gauges;
+        std::map<key, std::unique_ptr<sharded_histogram>, std::less<>> m_histograms;
+    };
+
+
+    inline std::vector<metrics_registry::sample>
+    metrics_registry::snapshot(std::string_view prefix) const
+    {
+        auto wanted = [prefix](const key &k) { return k.first.compare(0, prefix.size(), prefix) == 0; };
+
+        std::vector<sample> samples;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[k, counter] : m_counters) {
+            if (!wanted(k)) continue;
+            sample s{k.first, k.second, kind::counter};
+            s.value = static_cast<std::int64_t>(counter->value());
+            samples.push_back(std::move(s));
+        }
+        for (const auto &[k, gauge] : m_gauges) {
+            if (!wanted(k)) continue;
+            sample s{k.first, k.second, kind::gauge};
+            s.value = gauge->value();
+            samples.push_back(std::move(s));
+        }
+        for (const auto &[k, histogram] : m_histograms) {
+            if (!wanted(k)) continue;
+            latency_histogram merged;
+            histogram->merge_into(merged);
+            sample s{k.first, k.second, kind::histogram};
+            s.count = merged.count();
+            s.mean = merged.mean();
+            s.p50 = merged.percentile(50);
+            s.p99 = merged.percentile(99);
+            s.p999 = merged.percentile(99.9);
+            s.max = merged.max();
+            samples.push_back(std::move(s));
+        }
+
+        std::sort(samples.begin(), samples.end(), [](const sample &a, const sample &b) {
+            return std::tie(a.name, a.label) < std::tie(b.name, b.label);
+        });
+        return samples;
+    }
+
+    inline void metrics_registry::dump(std::ostream &out, std::string_view prefix) const
+    {
+        for (const sample &s : snapshot(prefix)) {
+            out << s.name;
+            if (!s.label.empty()) out << '{' << s.label << '}';
+            if (s.type == kind::histogram) {
+                out << " count=" << s.count << " mean=" << s.mean << " p50=" << s.p50
+                    << " p99=" << s.p99 << " p999=" << s.p999 << " max=" << s.max << '\n';
+            } else {
+                out << ' ' << s.value << '\n';
+            }
+        }
+    }
+
+}  // namespace util
+
+#endif
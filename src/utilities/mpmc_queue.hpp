@@ -0,0 +1,239 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include "spin_wait.hpp"
+
+namespace util
+{
+    // Bounded lock-free multi-producer multi-consumer ring buffer, after
+    // Dmitry Vyukov's bounded MPMC queue.
+    //
+    // Every slot carries a sequence number telling whether it is free for
+    // the producer of a given position or full for its consumer, so that
+    // producers and consumers only contend on their own position counter
+    // (one CAS per operation) and never on each other. Elements are
+    // constructed in place and moved out, so T may be move-only.
+    template <typename T>
+    class mpmc_queue
+    {
+        public:
+        // `capacity` is rounded up to a power of two.
+        explicit mpmc_queue(std::size_t capacity);
+        ~mpmc_queue();
+
+        mpmc_queue(const mpmc_queue &) = delete;
+        mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+        template <class... Args>
+        bool try_emplace(Args &&...args);
+        bool try_push(T &&value) { return try_emplace(std::move(value)); }
+        void push(T &&value, unsigned int spin_budget = DEFAULT_SPIN_BUDGET);
+
+        std::optional<T> try_pop();
+        T pop(unsigned int spin_budget = DEFAULT_SPIN_BUDGET);
+
+        // Batches move up to `count`/`max` elements and wake the other side
+        // once. Each element is still claimed individually, so a batch may
+        // interleave with other threads' elements.
+        template <class It>
+        std::size_t try_push_bulk(It first, std::size_t count);
+        template <class OutIt>
+        std::size_t try_pop_bulk(OutIt out, std::size_t max);
+
+        std::size_t capacity() const { return m_mask + 1; }
+        std::size_t size() const;  // approximate
+
+        private:
+        struct cell
+        {
+            std::atomic<std::size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+        };
+
+        template <class... Args>
+        bool enqueue(Args &&...args);
+        bool dequeue(T *&item, std::size_t &pos);
+        void release(std::size_t pos);
+
+        const std::size_t m_mask;
+        std::unique_ptr<cell[]> m_cells;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_enqueue_pos{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_dequeue_pos{0};
+
+        alignas(CACHE_LINE_SIZE) parking_lot m_not_empty;
+        parking_lot m_not_full;
+    };
+
+
+    template <typename T>
+    inline mpmc_queue<T>::mpmc_queue(std::size_t capacity)
+        : m_mask(detail::round_up_pow2(capacity < 2 ? 2 : capacity) - 1),
+          m_cells(new cell[m_mask + 1])
+    {
+        for (std::size_t i = 0; i <= m_mask; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    inline mpmc_queue<T>::~mpmc_queue()
+    {
+        T *item;
+        std::size_t pos;
+        while (dequeue(item, pos)) {
+            item->~T();
+        }
+    }
+
+    template <typename T>
+    template <class... Args>
+    inline bool mpmc_queue<T>::enqueue(Args &&...args)
+    {
+        std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        cell *c;
+        while (true) {
+            c = &m_cells[pos & m_mask];
+            const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        ::new (c->storage) T(std::forward<Args>(args)...);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename T>
+    inline bool mpmc_queue<T>::dequeue(T *&item, std::size_t &pos)
+    {
+        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        cell *c;
+        while (true) {
+            c = &m_cells[pos & m_mask];
+            const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // empty
+            } else {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = c->value();
+        return true;
+    }
+
+    // Hands the slot of a dequeued position back to the producers.
+    template <typename T>
+    inline void mpmc_queue<T>::release(std::size_t pos)
+    {
+        m_cells[pos & m_mask].sequence.store(pos + m_mask + 1, std::memory_order_release);
+    }
+
+    template <typename T>
+    template <class... Args>
+    inline bool mpmc_queue<T>::try_emplace(Args &&...args)
+    {
+        if (!enqueue(std::forward<Args>(args)...)) return false;
+        m_not_empty.notify();
+        return true;
+    }
+
+    template <typename T>
+    inline void mpmc_queue<T>::push(T &&value, unsigned int spin_budget)
+    {
+        while (!try_push(std::move(value))) {
+            m_not_full.wait([this] {
+                const std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos;
+            }, spin_budget);
+        }
+    }
+
+    template <typename T>
+    inline std::optional<T> mpmc_queue<T>::try_pop()
+    {
+        T *item;
+        std::size_t pos;
+        if (!dequeue(item, pos)) return std::nullopt;
+
+        std::optional<T> value(std::move(*item));
+        item->~T();
+        release(pos);
+        m_not_full.notify();
+        return value;
+    }
+
+    template <typename T>
+    inline T mpmc_queue<T>::pop(unsigned int spin_budget)
+    {
+        while (true) {
+            if (std::optional<T> value = try_pop()) return std::move(*value);
+            m_not_empty.wait([this] {
+                const std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos + 1;
+            }, spin_budget);
+        }
+    }
+
+    template <typename T>
+    template <class It>
+    inline std::size_t mpmc_queue<T>::try_push_bulk(It first, std::size_t count)
+    {
+        std::size_t n = 0;
+        for (; n < count; ++n, ++first) {
+            if (!enqueue(std::move(*first))) break;
+        }
+        if (n > 0) m_not_empty.notify();
+        return n;
+    }
+
+    template <typename T>
+    template <class OutIt>
+    inline std::size_t mpmc_queue<T>::try_pop_bulk(OutIt out, std::size_t max)
+    {
+        std::size_t n = 0;
+        T *item;
+        std::size_t pos;
+        for (; n < max && dequeue(item, pos); ++n, ++out) {
+            *out = std::move(*item);
+            item->~T();
+            release(pos);
+        }
+        if (n > 0) m_not_full.notify();
+        return n;
+    }
+
+    template <typename T>
+    inline std::size_t mpmc_queue<T>::size() const
+    {
+        const std::size_t tail = m_enqueue_pos.load(std::memory_order_acquire);
+        const std::size_t head = m_dequeue_pos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+}  // namespace util
+
+#endif
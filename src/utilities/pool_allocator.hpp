@@ -0,0 +1,92 @@
+#ifndef POOL_ALLOCATOR_HPP
+#define POOL_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include "mpmc_queue.hpp"
+
+namespace util
+{
+    // Process-wide free list of blocks of one size and alignment.
+    //
+    // Blocks freed by any thread are kept (up to MAX_FREE_BLOCKS) in a
+    // lock-free queue and handed out again, so that objects created on one
+    // thread and destroyed on another, such as the shared state of a future,
+    // stop hitting malloc once the pool is warm.
+    template <std::size_t Size, std::size_t Align>
+    class block_pool
+    {
+        public:
+        // Enough for the tasks and futures of a large burst of submissions;
+        // about 1 MB for 64-byte blocks.
+        static constexpr std::size_t MAX_FREE_BLOCKS = 16384;
+
+        // Never destroyed: blocks may still be released during static
+        // destruction, e.g. by a thread_pool with static storage duration.
+        static block_pool &instance()
+        {
+            static block_pool *pool = new block_pool;
+            return *pool;
+        }
+
+        void *allocate()
+        {
+            if (std::optional<void *> block = m_free.try_pop()) return *block;
+            return ::operator new(Size, std::align_val_t(Align));
+        }
+
+        void deallocate(void *block)
+        {
+            if (!m_free.try_emplace(block)) ::operator delete(block, std::align_val_t(Align));
+        }
+
+        private:
+        block_pool() = default;
+
+        mpmc_queue<void *> m_free{MAX_FREE_BLOCKS};
+    };
+
+    // Allocator drawing single objects from a block_pool; arrays go to the
+    // default allocator.
+    template <typename T>
+    class pool_allocator
+    {
+        public:
+        using value_type = T;
+
+        pool_allocator() noexcept = default;
+        template <typename U>
+        pool_allocator(const pool_allocator<U> &) noexcept {}
+
+        T *allocate(std::size_t n)
+        {
+            if (n == 1) return static_cast<T *>(pool().allocate());
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T *p, std::size_t n)
+        {
+            if (n == 1) {
+                pool().deallocate(p);
+            } else {
+                std::allocator<T>().deallocate(p, n);
+            }
+        }
+
+        private:
+        static block_pool<sizeof(T), alignof(T)> &pool()
+        {
+            return block_pool<sizeof(T), alignof(T)>::instance();
+        }
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(const pool_allocator<T> &, const pool_allocator<U> &) { return true; }
+    template <typename T, typename U>
+    inline bool operator!=(const pool_allocator<T> &, const pool_allocator<U> &) { return false; }
+
+}  // namespace util
+
+#endif
@@ -4,6 +4,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 namespace util 
 {
@@ -13,10 +14,14 @@ namespace util
         public:
         // Pushes an element onto the queue
         void push(T const& val);
+        void push(T&& val);
 
         // Pops and returns the front element of the queue
         T pop();
 
+        // Pops the front element into `out` if there is one, without waiting
+        bool try_pop(T& out);
+
         private:
         std::queue<T> m_queue;                // Underlying queue to store elements
         std::condition_variable m_condition;  // Condition variable for synchronization
@@ -32,16 +37,34 @@ namespace util
       m_condition.notify_one();  // Notify one waiting thread that data is available
     }
 
+    template <typename T>
+    inline void queue_safe<T>::push(T&& val) 
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push(std::move(val));
+      m_condition.notify_one();
+    }
+
     template <typename T>
     inline T util::queue_safe<T>::pop()
     {
       std::unique_lock<std::mutex> uLock(m_mutex);
       m_condition.wait(uLock,
               [&] { return !m_queue.empty(); });  // Wait until the queue is not empty
-      T front = m_queue.front();
+      T front = std::move(m_queue.front());
       m_queue.pop();
       return front;
     }
 
+    template <typename T>
+    inline bool queue_safe<T>::try_pop(T& out)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_queue.empty()) return false;
+      out = std::move(m_queue.front());
+      m_queue.pop();
+      return true;
+    }
+
         }  // namespace util
 #endif
\ No newline at end of file
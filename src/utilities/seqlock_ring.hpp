@@ -0,0 +1,181 @@
+#ifndef SEQLOCK_RING_HPP
+#define SEQLOCK_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include "spin_wait.hpp"
+
+namespace util
+{
+    // Broadcast ring of trivially copyable records, with one writer and any
+    // number of readers, laid out in memory provided by the caller (e.g. a
+    // shared-memory mapping, see shared_memory.hpp) so that the readers may
+    // live in other processes.
+    //
+    // The writer never waits for, nor even knows about, the readers: every
+    // slot carries its own sequence counter (a seqlock), odd while the
+    // writer copies a record in, which tells a reader whether the slot holds
+    // the record it wants, one not written yet, or one already overwritten.
+    // A reader that falls a whole ring behind thus loses records, and knows
+    // how many. Records are copied as relaxed atomic 8-byte words, so the
+    // torn reads that the seqlock discards are not data races.
+    //
+    // Every atomic is lock-free and address-free, hence valid across
+    // processes mapping the same memory.
+    template <class T>
+    class seqlock_ring
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "records are copied word by word");
+        static_assert(sizeof(T) % sizeof(std::uint64_t) == 0 && alignof(T) <= alignof(std::uint64_t),
+                      "records are copied as 8-byte words");
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+        static constexpr std::size_t WORDS = sizeof(T) / sizeof(std::uint64_t);
+
+        struct alignas(CACHE_LINE_SIZE) control
+        {
+            std::atomic<std::uint64_t> head{0};  // position of the next record
+            std::uint64_t capacity = 0;
+        };
+
+        struct alignas(CACHE_LINE_SIZE) slot
+        {
+            std::atomic<std::uint64_t> seq{0};  // 2 * position + 2 once written
+            std::atomic<std::uint64_t> words[WORDS];
+        };
+
+        public:
+        enum class read_result { ok, empty, overrun };
+
+        // Bytes of memory for a ring of `capacity` records (rounded up to a
+        // power of two).
+        static std::size_t bytes(std::size_t capacity)
+        {
+            return sizeof(control) + detail::round_up_pow2(std::max<std::size_t>(capacity, 2)) * sizeof(slot);
+        }
+
+        // Formats `memory`, at least bytes(capacity) bytes aligned to a cache
+        // line, as an empty ring.
+        static seqlock_ring create(void *memory, std::size_t capacity)
+        {
+            capacity = detail::round_up_pow2(std::max<std::size_t>(capacity, 2));
+            auto *c = new (memory) control{};
+            c->capacity = capacity;
+            auto *slots = reinterpret_cast<slot *>(c + 1);
+            for (std::size_t i = 0; i < capacity; ++i) new (&slots[i]) slot{};
+            return seqlock_ring(c);
+        }
+
+        // Attaches to a ring formatted by create(), e.g. in another process.
+        static seqlock_ring attach(const void *memory)
+        {
+            return seqlock_ring(static_cast<control *>(const_cast<void *>(memory)));
+        }
+
+        seqlock_ring() = default;
+
+        // Appends `record`, overwriting the oldest one. Single writer.
+        void push(const T &record)
+        {
+            const std::uint64_t position = m_control->head.load(std::memory_order_relaxed);
+            slot &s = m_slots[position & m_mask];
+
+            std::uint64_t words[WORDS];
+            std::memcpy(words, &record, sizeof(T));
+
+            s.seq.store(2 * position + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i = 0; i < WORDS; ++i) s.words[i].store(words[i], std::memory_order_relaxed);
+            s.seq.store(2 * position + 2, std::memory_order_release);
+            m_control->head.store(position + 1, std::memory_order_release);
+        }
+
+        // Position of the next record to be written: the records in
+        // [head() - capacity(), head()) may still be read.
+        std::uint64_t head() const { return m_control->head.load(std::memory_order_acquire); }
+
+        std::size_t capacity() const { return m_mask + 1; }
+
+        // Copies record `position` into `out`. `empty` if it is not written
+        // yet (or being written), `overrun` if it was already overwritten.
+        read_result read(std::uint64_t position, T &out) const
+        {
+            const slot &s = m_slots[position & m_mask];
+            const std::uint64_t expected = 2 * position + 2;
+
+            const std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq < expected) return read_result::empty;
+            if (seq > expected) return read_result::overrun;
+
+            std::uint64_t words[WORDS];
+            for (std::size_t i = 0; i < WORDS; ++i) words[i] = s.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != expected) return read_result::overrun;
+
+            std::memcpy(&out, words, sizeof(T));
+            return read_result::ok;
+        }
+
+        // Cursor of one reader.
+        class reader;
+
+        private:
+        explicit seqlock_ring(control *c)
+            : m_control(c), m_slots(reinterpret_cast<slot *>(c + 1)), m_mask(c->capacity - 1)
+        {
+        }
+
+        control *m_control = nullptr;
+        slot *m_slots = nullptr;
+        std::size_t m_mask = 0;
+    };
+
+    template <class T>
+    class seqlock_ring<T>::reader
+    {
+        public:
+        reader() = default;
+        reader(const seqlock_ring &ring, std::uint64_t position) : m_ring(ring), m_position(position) {}
+
+        // Reads the next record into `out`; false if there is none yet.
+        // After an overrun, skips ahead to half a ring behind the writer,
+        // counting the records it missed as lost.
+        bool next(T &out)
+        {
+            while (true) {
+                switch (m_ring.read(m_position, out)) {
+                    case read_result::ok:
+                        ++m_position;
+                        return true;
+                    case read_result::empty:
+                        return false;
+                    case read_result::overrun:
+                        break;
+                }
+                const std::uint64_t head = m_ring.head();
+                const std::uint64_t resume = std::max(m_position + 1,
+                                                      head - std::min<std::uint64_t>(head, m_ring.capacity() / 2));
+                m_lost += resume - m_position;
+                m_position = resume;
+            }
+        }
+
+        // Position of the next record to read.
+        std::uint64_t position() const { return m_position; }
+        // Records overwritten before they could be read.
+        std::uint64_t lost() const { return m_lost; }
+
+        private:
+        seqlock_ring m_ring;  // a view, cheap to copy
+        std::uint64_t m_position = 0;
+        std::uint64_t m_lost = 0;
+    };
+
+}  // namespace util
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef SHARED_MEMORY_HPP
+#define SHARED_MEMORY_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util
+{
+    // POSIX shared-memory object (shm_open) mapped into the process.
+    //
+    // The creator maps it read-write and unlinks it when destroyed; other
+    // processes open() it read-only, so that a reader can never corrupt what
+    // the writer publishes. Names are of the form "/name". Not available on
+    // Windows, where create() and open() fail.
+    class shared_memory
+    {
+        public:
+        shared_memory() = default;
+        ~shared_memory() { close(); }
+
+        shared_memory(const shared_memory &) = delete;
+        shared_memory &operator=(const shared_memory &) = delete;
+
+        shared_memory(shared_memory &&other) noexcept { *this = std::move(other); }
+        shared_memory &operator=(shared_memory &&other) noexcept
+        {
+            if (this != &other) {
+                close();
+                m_name = std::move(other.m_name);
+                m_data = std::exchange(other.m_data, nullptr);
+                m_size = std::exchange(other.m_size, 0);
+                m_owner = std::exchange(other.m_owner, false);
+            }
+            return *this;
+        }
+
+        // Tells whether an existing object, mapped read-only, was left behind
+        // by a writer that is gone.
+        using stale_check = std::function<bool(const void *data, std::size_t size)>;
+
+        // Creates the object `name` with `size` zeroed bytes. An object of
+        // that name already there is replaced only if `stale` says it was
+        // left behind; otherwise, it is someone else's and create() fails.
+        // Returns false with `error` set on failure.
+        bool create(const std::string &name, std::size_t size, std::string &error,
+                    const stale_check &stale = {})
+        {
+            close();
+#ifdef _WIN32
+            (void)name, (void)size, (void)stale;
+            error = "shared memory is not supported on this platform";
+            return false;
+#else
+            int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (fd < 0 && errno == EEXIST) {
+                shared_memory existing;
+                std::string ignored;
+                const bool replace =
+                    stale && existing.open(name, ignored) && stale(existing.data(), existing.size());
+                existing.close();
+                if (!replace) {
+                    error = "shm_open " + name + ": exists and is not stale, "
+                            "another process may be using it";
+                    return false;
+                }
+                ::shm_unlink(name.c_str());
+                fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            }
+            if (fd < 0) return fail("shm_open " + name, error);
+
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                fail("ftruncate " + name, error);
+                ::close(fd);
+                ::shm_unlink(name.c_str());
+                return false;
+            }
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);  // the mapping keeps the object referenced
+            if (p == MAP_FAILED) {
+                fail("mmap " + name, error);
+                ::shm_unlink(name.c_str());
+                return false;
+            }
+
+            m_name = name;
+            m_data = p;
+            m_size = size;
+            m_owner = true;
+            return true;
+#endif
+        }
+
+        // Maps the existing object `name`, read-only. Returns false with
+        // `error` set on failure.
+        bool open(const std::string &name, std::string &error)
+        {
+            close();
+#ifdef _WIN32
+            (void)name;
+            error = "shared memory is not supported on this platform";
+            return false;
+#else
+            const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) return fail("shm_open " + name, error);
+
+            struct stat st {};
+            if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+                ::close(fd);
+                error = "shm_open " + name + ": empty object";
+                return false;
+            }
+            const auto size = static_cast<std::size_t>(st.st_size);
+            void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return fail("mmap " + name, error);
+
+            m_name = name;
+            m_data = p;
+            m_size = size;
+            m_owner = false;
+            return true;
+#endif
+        }
+
+        // Unmaps, and unlinks the object if this process created it.
+        void close()
+        {
+#ifndef _WIN32
+            if (m_data) ::munmap(m_data, m_size);
+            if (m_owner) ::shm_unlink(m_name.c_str());
+#endif
+            m_data = nullptr;
+            m_size = 0;
+            m_owner = false;
+        }
+
+        explicit operator bool() const { return m_data != nullptr; }
+
+        void *data() { return m_data; }
+        const void *data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+        const std::string &name() const { return m_name; }
+
+        private:
+        static bool fail(const std::string &what, std::string &error)
+        {
+            error = what + ": " + std::strerror(errno);
+            return false;
+        }
+
+        std::string m_name;
+        void *m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_owner = false;
+    };
+
+}  // namespace util
+
+#endif
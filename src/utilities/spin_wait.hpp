@@ -0,0 +1,111 @@
+#ifndef SPIN_WAIT_HPP
+#define SPIN_WAIT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace util
+{
+    // Size of a cache line, for padding data written by different threads.
+    // (std::hardware_destructive_interference_size is not stable across
+    // compiler flags, so it is not used in types shared between TUs.)
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    // Spin iterations of a blocking operation before its thread parks.
+    constexpr unsigned int DEFAULT_SPIN_BUDGET = 1024;
+
+    // Tells the CPU that the caller is busy-waiting.
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // Spinning only helps if the thread being waited for runs meanwhile; on
+    // a single hardware thread it just burns the waiter's time slice, so
+    // waiters yield it a few times instead.
+    inline bool spinning_pays_off()
+    {
+        static const bool multi_core = std::thread::hardware_concurrency() > 1;
+        return multi_core;
+    }
+
+    constexpr unsigned int SINGLE_CORE_YIELDS = 16;
+
+    namespace detail
+    {
+        // Ring buffer capacities are powers of two, so that an index maps to
+        // its slot with a mask.
+        inline std::size_t round_up_pow2(std::size_t n)
+        {
+            std::size_t p = 1;
+            while (p < n) p <<= 1;
+            return p;
+        }
+    }
+
+    // Spin-then-park waiting on a condition published by other threads.
+    //
+    // A waiter spins for a bounded number of iterations, then sleeps on an
+    // epoch counter (std::atomic::wait). Notifiers only touch the epoch, and
+    // only make a system call, when a thread is actually parked.
+    class parking_lot
+    {
+        public:
+        // Returns once `ready()` holds.
+        template <class Ready>
+        void wait(Ready ready, unsigned int spin_budget = DEFAULT_SPIN_BUDGET)
+        {
+            if (spinning_pays_off()) {
+                for (unsigned int i = 0; i < spin_budget; ++i) {
+                    if (ready()) return;
+                    cpu_relax();
+                }
+            } else if (spin_budget > 0) {
+                for (unsigned int i = 0; i < SINGLE_CORE_YIELDS; ++i) {
+                    if (ready()) return;
+                    std::this_thread::yield();
+                }
+            }
+
+            while (!ready()) {
+                const std::uint32_t epoch = m_epoch.load(std::memory_order_acquire);
+                m_waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (!ready()) {
+                    m_epoch.wait(epoch, std::memory_order_acquire);
+                }
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Call after making `ready()` true for some waiter.
+        void notify()
+        {
+            // Orders the publication before the waiter count check; pairs
+            // with the fetch_add in wait().
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiters.load(std::memory_order_relaxed) > 0) {
+                m_epoch.fetch_add(1, std::memory_order_release);
+                m_epoch.notify_all();
+            }
+        }
+
+        private:
+        std::atomic<std::uint32_t> m_epoch{0};
+        std::atomic<std::uint32_t> m_waiters{0};
+    };
+
+}  // namespace util
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include "spin_wait.hpp"
+
+namespace util
+{
+    // Bounded lock-free single-producer single-consumer ring buffer.
+    //
+    // Exactly one thread may push and one thread may pop. Elements are
+    // constructed in place and moved out, so T may be move-only. Each side
+    // keeps a cached copy of the other side's index and only reads the
+    // shared one (a cache miss) when the cached copy says full/empty.
+    template <typename T>
+    class spsc_queue
+    {
+        public:
+        // `capacity` is rounded up to a power of two.
+        explicit spsc_queue(std::size_t capacity);
+        ~spsc_queue();
+
+        spsc_queue(const spsc_queue &) = delete;
+        spsc_queue &operator=(const spsc_queue &) = delete;
+
+        // Producer side
+        template <class... Args>
+        bool try_emplace(Args &&...args);
+        bool try_push(T &&value) { return try_emplace(std::move(value)); }
+        void push(T &&value, unsigned int spin_budget = DEFAULT_SPIN_BUDGET);
+        // Moves up to `count` elements from `first`; returns how many.
+        template <class It>
+        std::size_t try_push_bulk(It first, std::size_t count);
+
+        // Consumer side
+        std::optional<T> try_pop();
+        T pop(unsigned int spin_budget = DEFAULT_SPIN_BUDGET);
+        // Moves up to `max` elements to `out`; returns how many.
+        template <class OutIt>
+        std::size_t try_pop_bulk(OutIt out, std::size_t max);
+
+        std::size_t capacity() const { return m_mask + 1; }
+        std::size_t size() const;  // approximate while both sides run
+
+        private:
+        struct alignas(T) storage
+        {
+            unsigned char bytes[sizeof(T)];
+        };
+
+        void *raw_slot(std::size_t i) { return m_slots[i & m_mask].bytes; }
+        T *slot(std::size_t i) { return std::launder(static_cast<T *>(raw_slot(i))); }
+
+        const std::size_t m_mask;
+        std::unique_ptr<storage[]> m_slots;
+
+        // Consumer line
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head{0};
+        std::size_t m_cached_tail = 0;
+
+        // Producer line
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail{0};
+        std::size_t m_cached_head = 0;
+
+        alignas(CACHE_LINE_SIZE) parking_lot m_not_empty;
+        parking_lot m_not_full;
+    };
+
+
+    template <typename T>
+    inline spsc_queue<T>::spsc_queue(std::size_t capacity)
+        : m_mask(detail::round_up_pow2(capacity < 2 ? 2 : capacity) - 1),
+          m_slots(new storage[m_mask + 1])
+    {
+    }
+
+    template <typename T>
+    inline spsc_queue<T>::~spsc_queue()
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        for (std::size_t i = m_head.load(std::memory_order_relaxed); i != tail; ++i) {
+            slot(i)->~T();
+        }
+    }
+
+    template <typename T>
+    template <class... Args>
+    inline bool spsc_queue<T>::try_emplace(Args &&...args)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head > m_mask) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head > m_mask) return false;
+        }
+
+        ::new (raw_slot(tail)) T(std::forward<Args>(args)...);
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_not_empty.notify();
+        return true;
+    }
+
+    template <typename T>
+    inline void spsc_queue<T>::push(T &&value, unsigned int spin_budget)
+    {
+        while (!try_push(std::move(value))) {
+            m_not_full.wait([this] {
+                return m_tail.load(std::memory_order_relaxed) -
+                           m_head.load(std::memory_order_acquire) <= m_mask;
+            }, spin_budget);
+        }
+    }
+
+    template <typename T>
+    template <class It>
+    inline std::size_t spsc_queue<T>::try_push_bulk(It first, std::size_t count)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t free = capacity() - (tail - m_cached_head);
+        if (free < count) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            free = capacity() - (tail - m_cached_head);
+        }
+
+        const std::size_t n = count < free ? count : free;
+        for (std::size_t i = 0; i < n; ++i, ++first) {
+            ::new (raw_slot(tail + i)) T(std::move(*first));
+        }
+        if (n > 0) {
+            m_tail.store(tail + n, std::memory_order_release);  // one publication for the batch
+            m_not_empty.notify();
+        }
+        return n;
+    }
+
+    template <typename T>
+    inline std::optional<T> spsc_queue<T>::try_pop()
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail) return std::nullopt;
+        }
+
+        T *item = slot(head);
+        std::optional<T> value(std::move(*item));
+        item->~T();
+        m_head.store(head + 1, std::memory_order_release);
+        m_not_full.notify();
+        return value;
+    }
+
+    template <typename T>
+    inline T spsc_queue<T>::pop(unsigned int spin_budget)
+    {
+        while (true) {
+            if (std::optional<T> value = try_pop()) return std::move(*value);
+            m_not_empty.wait([this] {
+                return m_tail.load(std::memory_order_acquire) !=
+                       m_head.load(std::memory_order_relaxed);
+            }, spin_budget);
+        }
+    }
+
+    template <typename T>
+    template <class OutIt>
+    inline std::size_t spsc_queue<T>::try_pop_bulk(OutIt out, std::size_t max)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_cached_tail - head < max) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+        }
+
+        const std::size_t available = m_cached_tail - head;
+        const std::size_t n = available < max ? available : max;
+        for (std::size_t i = 0; i < n; ++i, ++out) {
+            T *item = slot(head + i);
+            *out = std::move(*item);
+            item->~T();
+        }
+        if (n > 0) {
+            m_head.store(head + n, std::memory_order_release);
+            m_not_full.notify();
+        }
+        return n;
+    }
+
+    template <typename T>
+    inline std::size_t spsc_queue<T>::size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+}  // namespace util
+
+#endif
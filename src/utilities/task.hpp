@@ -0,0 +1,132 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+    // Move-only `void()` callable, used in place of std::function for the
+    // tasks of util::thread_pool.
+    //
+    // Callables up to INLINE_SIZE bytes that can be moved without throwing
+    // are stored inside the task itself, so wrapping a typical lambda (a few
+    // captured pointers plus a std::promise) does not allocate. Larger ones
+    // fall back to the heap. Unlike std::function, the callable does not
+    // have to be copyable.
+    class task
+    {
+        public:
+        static constexpr std::size_t INLINE_SIZE = 56;
+
+        template <class F>
+        static constexpr bool stored_inline =
+            sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(void *) &&
+            std::is_nothrow_move_constructible_v<F>;
+
+        task() noexcept = default;
+
+        template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, task>>>
+        task(F &&f);
+
+        task(task &&other) noexcept;
+        task &operator=(task &&other) noexcept;
+        ~task() { reset(); }
+
+        task(const task &) = delete;
+        task &operator=(const task &) = delete;
+
+        void operator()() { m_ops->invoke(m_storage); }
+        explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+        private:
+        struct ops
+        {
+            void (*invoke)(void *self);
+            void (*move)(void *to, void *from);  // and destroys `from`
+            void (*destroy)(void *self);
+        };
+
+        template <class F>
+        static const ops *inline_ops();
+        template <class F>
+        static const ops *heap_ops();
+
+        void reset() noexcept;
+
+        alignas(void *) unsigned char m_storage[INLINE_SIZE];
+        const ops *m_ops = nullptr;
+    };
+
+
+    template <class F, class>
+    inline task::task(F &&f)
+    {
+        using callable = std::decay_t<F>;
+        if constexpr (stored_inline<callable>) {
+            ::new (static_cast<void *>(m_storage)) callable(std::forward<F>(f));
+            m_ops = inline_ops<callable>();
+        } else {
+            ::new (static_cast<void *>(m_storage)) callable *(new callable(std::forward<F>(f)));
+            m_ops = heap_ops<callable>();
+        }
+    }
+
+    inline task::task(task &&other) noexcept : m_ops(other.m_ops)
+    {
+        if (m_ops) {
+            m_ops->move(m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    inline task &task::operator=(task &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_ops) {
+                other.m_ops->move(m_storage, other.m_storage);
+                m_ops = other.m_ops;
+                other.m_ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    inline void task::reset() noexcept
+    {
+        if (m_ops) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    template <class F>
+    inline const task::ops *task::inline_ops()
+    {
+        static constexpr ops table{
+            [](void *self) { (*std::launder(static_cast<F *>(self)))(); },
+            [](void *to, void *from) {
+                F *source = std::launder(static_cast<F *>(from));
+                ::new (to) F(std::move(*source));
+                source->~F();
+            },
+            [](void *self) { std::launder(static_cast<F *>(self))->~F(); }};
+        return &table;
+    }
+
+    template <class F>
+    inline const task::ops *task::heap_ops()
+    {
+        static constexpr ops table{
+            [](void *self) { (**std::launder(static_cast<F **>(self)))(); },
+            [](void *to, void *from) { ::new (to) F *(*std::launder(static_cast<F **>(from))); },
+            [](void *self) { delete *std::launder(static_cast<F **>(self)); }};
+        return &table;
+    }
+
+}  // namespace util
+
+#endif
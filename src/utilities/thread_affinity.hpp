@@ -0,0 +1,81 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace util
+{
+    // Cores a CPU set can name: pin_current_thread() and parse_core_list()
+    // reject the ones above.
+#if defined(__linux__)
+    inline constexpr unsigned int max_cpu_count = CPU_SETSIZE;
+#else
+    inline constexpr unsigned int max_cpu_count = 1024;
+#endif
+
+    // Pins the calling thread to CPU `core`. Returns false where thread
+    // affinity is not supported, or if the core does not exist.
+    inline bool pin_current_thread(unsigned int core)
+    {
+#if defined(__linux__)
+        if (core >= max_cpu_count) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)core;
+        return false;
+#endif
+    }
+
+    // Names the calling thread for debuggers and `top -H`. Linux keeps the
+    // first 15 characters.
+    inline void set_current_thread_name(const std::string &name)
+    {
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+        (void)name;
+#endif
+    }
+
+    // Parses a list of cores such as "0,2,4-7". Returns false if malformed,
+    // or if a core is not below max_cpu_count.
+    inline bool parse_core_list(std::string_view spec, std::vector<unsigned int> &cores)
+    {
+        cores.clear();
+        while (!spec.empty()) {
+            const std::size_t comma = spec.find(',');
+            const std::string_view item = spec.substr(0, comma);
+            spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+
+            const std::size_t dash = item.find('-');
+            const std::string_view first_text = item.substr(0, dash);
+            const std::string_view last_text =
+                dash == std::string_view::npos ? first_text : item.substr(dash + 1);
+            unsigned int first = 0, last = 0;
+            const auto a = std::from_chars(first_text.data(), first_text.data() + first_text.size(), first);
+            const auto b = std::from_chars(last_text.data(), last_text.data() + last_text.size(), last);
+            if (first_text.empty() || last_text.empty() || a.ec != std::errc() ||
+                b.ec != std::errc() || a.ptr != first_text.data() + first_text.size() ||
+                b.ptr != last_text.data() + last_text.size() || first > last ||
+                last >= max_cpu_count) {
+                return false;
+            }
+            for (unsigned int core = first; core <= last; ++core) cores.push_back(core);
+        }
+        return !cores.empty();
+    }
+
+}  // namespace util
+
+#endif
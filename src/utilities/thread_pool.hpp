@@ -7,17 +7,69 @@
 #include <future>
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include "pool_allocator.hpp"
 #include "queue_safe.hpp"
+#include "spin_wait.hpp"
+#include "task.hpp"
+#include "thread_affinity.hpp"
+#include "work_stealing_deque.hpp"
 
 namespace util 
 {
     constexpr unsigned int DEFAULT_NUM_OF_THREADS = 2;
 
+    // How tasks reach the workers.
+    enum class scheduling
+    {
+        shared_queue,  // one locked queue shared by all the workers
+        work_stealing  // one deque per worker; idle workers steal from the others
+    };
+
+    // How an idle worker waits for the next task.
+    enum class wait_strategy
+    {
+        park,       // blocks on a condition variable right away
+        spin_park,  // polls for spin_budget iterations, yields a few times, then blocks
+        busy_poll   // never blocks: keeps polling, and owns its core, until the pool stops
+    };
+
+    struct thread_pool_options
+    {
+        unsigned int threads = DEFAULT_NUM_OF_THREADS;
+        scheduling mode = scheduling::shared_queue;
+
+        // Worker i is pinned to cores[i % cores.size()]; empty: not pinned.
+        std::vector<unsigned int> cores;
+
+        // Work-stealing mode: each worker allocates its own deque after it
+        // is pinned, so that (first-touch policy) the deque lives on the
+        // worker's NUMA node rather than on the node of the creating thread.
+        bool numa_local = false;
+
+        // Workers are named "<name>-<index>"; empty: not named.
+        std::string name;
+
+        wait_strategy wait = wait_strategy::park;
+        unsigned int spin_budget = DEFAULT_SPIN_BUDGET;
+    };
+
     class thread_pool 
     {
     public:
-        explicit thread_pool(unsigned int requested_threads = DEFAULT_NUM_OF_THREADS);
+        explicit thread_pool(unsigned int requested_threads = DEFAULT_NUM_OF_THREADS,
+                             scheduling mode = scheduling::shared_queue);
+
+        // Returns once every worker is pinned, named and ready.
+        explicit thread_pool(const thread_pool_options &options);
 
         ~thread_pool();
 
@@ -27,20 +79,84 @@ namespace util
         auto ExecuteTask(F &&f, Args &&...args)
             -> std::future<std::invoke_result_t<F, Args...>>;
 
+        // Fire-and-forget: runs f(args...) without creating a future.
+        // Exceptions are reported on std::cerr.
+        template <class F, class... Args>
+        void Post(F &&f, Args &&...args);
+
     private:
+        using job = task;
+
+        void schedule(job fn);
+
+        // Pins and names the calling worker, and creates its local state.
+        void setup_worker(unsigned int index);
+
+        // Polls `try_get` as the wait strategy says before a worker blocks.
+        // Returns true once it succeeds, false if the worker should block
+        // (busy_poll: only once the pool stops).
+        template <class TryGet>
+        bool poll(TryGet try_get) const;
+
+        void run_shared(unsigned int index);
+
+        // Work-stealing deque nodes come from a pool rather than new/delete.
+        static job *make_job(job &&fn);
+        static void destroy_job(job *t);
+
+        // Work-stealing mode
+        void run_stealing(unsigned int index);
+        job *next_job(unsigned int index);
+        static void run(job &fn);
+
         // Workers
         std::vector<std::thread> m_workers;
+        thread_pool_options m_options;
+        scheduling m_mode;
+        std::unique_ptr<std::latch> m_ready;  // counts the workers set up
+
+        // Task queue (shared_queue mode)
+        queue_safe<job> m_tasks;
 
-        // Task queue
-        queue_safe<std::function<void()>> m_tasks;
+        // Work-stealing mode: tasks submitted by a worker go to its own
+        // deque, tasks submitted from outside the pool to m_injected.
+        std::vector<std::unique_ptr<work_stealing_deque<job>>> m_deques;
+        std::mutex m_injected_mutex;
+        std::deque<job *> m_injected;
+
+        // Idle workers park until a task is pending.
+        std::mutex m_park_mutex;
+        std::condition_variable m_park;
+        std::atomic<long> m_pending{0};
+        std::atomic<unsigned int> m_sleeping{0};
+
+        // The pool and index of the calling thread, if it is a worker
+        // (zero-initialized, i.e. no pool, for the other threads).
+        struct worker_id
+        {
+            const thread_pool *pool;
+            unsigned int index;
+        };
+        static inline thread_local worker_id t_worker;
 
         // Synchronization
         std::atomic<bool> m_stop;
     };
 
 
-    // Constructor
-    inline thread_pool::thread_pool(unsigned int requested_threads) : m_stop(false) 
+    // Constructors
+    inline thread_pool::thread_pool(unsigned int requested_threads, scheduling mode)
+        : thread_pool([&] {
+              thread_pool_options options;
+              options.threads = requested_threads;
+              options.mode = mode;
+              return options;
+          }())
+    {
+    }
+
+    inline thread_pool::thread_pool(const thread_pool_options &options)
+        : m_options(options), m_mode(options.mode), m_stop(false) 
     {
         unsigned int max_threads = std::thread::hardware_concurrency();
 
@@ -48,30 +164,31 @@ namespace util
             max_threads = DEFAULT_NUM_OF_THREADS;
         }
 
+        unsigned int requested_threads = options.threads;
         if (requested_threads <= 0) {
             requested_threads = DEFAULT_NUM_OF_THREADS;
         }
 
         const unsigned int pool_size = std::min(requested_threads, max_threads);
+        m_ready = std::make_unique<std::latch>(pool_size);
 
-        for (unsigned int i = 0; i < pool_size; ++i) {
-            m_workers.emplace_back([this, &i]() {
-                while (true) {
-                    if (m_stop) break;
-                    auto task = m_tasks.pop();
-                    if (m_stop) break;
-                    
-                    try {
-                        task();
-                    } catch (const std::exception &e) {
-                        std::cerr << "[ThreadPool] Task threw exception: " 
-                                  << e.what() << "\n";
-                    } catch (...) {
-                        std::cerr << "[ThreadPool] Task threw unknown exception\n";
-                    }
+        if (m_mode == scheduling::work_stealing) {
+            m_deques.resize(pool_size);
+            if (!m_options.numa_local) {
+                for (auto &deque : m_deques) {
+                    deque = std::make_unique<work_stealing_deque<job>>();
                 }
-            });
+            }
+            for (unsigned int i = 0; i < pool_size; ++i) {
+                m_workers.emplace_back([this, i]() { run_stealing(i); });
+            }
+        } else {
+            for (unsigned int i = 0; i < pool_size; ++i) {
+                m_workers.emplace_back([this, i]() { run_shared(i); });
+            }
         }
+
+        m_ready->wait();
     }
 
 
@@ -80,15 +197,26 @@ namespace util
     {
         m_stop = true;
 
-        // Push dummy tasks to unblock workers waiting on pop()
-        for (size_t i = 0; i < m_workers.size(); ++i) {
-            m_tasks.push([] {}); 
+        if (m_mode == scheduling::work_stealing) {
+            { std::lock_guard<std::mutex> lock(m_park_mutex); }
+            m_park.notify_all();
+        } else {
+            // Push dummy tasks to unblock workers waiting on pop()
+            for (size_t i = 0; i < m_workers.size(); ++i) {
+                m_tasks.push([] {}); 
+            }
         }
 
         for (auto &worker : m_workers) {
             if (worker.joinable())
                 worker.join();
         }
+
+        // Tasks that never ran; their futures report a broken promise.
+        for (auto &deque : m_deques) {
+            while (job *t = deque->pop()) destroy_job(t);
+        }
+        for (job *t : m_injected) destroy_job(t);
     }
 
     inline unsigned int thread_pool::size() const
@@ -96,38 +224,225 @@ namespace util
         return m_workers.size();
     }
 
-    // ExecuteTask: wraps arbitrary callable + args into packaged_task
+    // ExecuteTask: runs f(args...) and hands its result (or exception) to
+    // the returned future. The callable, the arguments and the promise are
+    // stored inline in the task, and the future's shared state comes from a
+    // block_pool, so a warm pool submits without allocating.
     template <class F, class... Args>
     inline auto thread_pool::ExecuteTask(F &&f, Args &&...args)
         -> std::future<std::invoke_result_t<F, Args...>> 
     {
         using return_type = std::invoke_result_t<F, Args...>;
 
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-
-        std::future<return_type> res = task->get_future();
-
         if (m_stop) {
             // Return invalid future instead of throwing
             std::cerr << "[ThreadPool] Ignoring ExecuteTask after m_stop\n";
             return std::future<return_type>();
         }
 
-        m_tasks.push([task]() { 
+        std::promise<return_type> promise(std::allocator_arg, pool_allocator<char>());
+        std::future<return_type> res = promise.get_future();
+
+        schedule([promise = std::move(promise), fn = std::forward<F>(f),
+                  bound = std::make_tuple(std::forward<Args>(args)...)]() mutable {
             try {
-                (*task)();
-            } catch (const std::exception &e) {
-                std::cerr << "[ThreadPool] ExecuteTask exception: " 
-                          << e.what() << "\n";
+                if constexpr (std::is_void_v<return_type>) {
+                    std::apply(fn, bound);
+                    promise.set_value();
+                } else {
+                    promise.set_value(std::apply(fn, bound));
+                }
             } catch (...) {
-                std::cerr << "[ThreadPool] ExecuteTask unknown exception\n";
+                promise.set_exception(std::current_exception());
             }
         });
 
         return res;
     }
 
+    template <class F, class... Args>
+    inline void thread_pool::Post(F &&f, Args &&...args)
+    {
+        if (m_stop) {
+            std::cerr << "[ThreadPool] Ignoring Post after m_stop\n";
+            return;
+        }
+
+        if constexpr (sizeof...(Args) == 0) {
+            schedule(std::forward<F>(f));
+        } else {
+            schedule([fn = std::forward<F>(f),
+                      bound = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                std::apply(fn, bound);
+            });
+        }
+    }
+
+    inline void thread_pool::schedule(job fn)
+    {
+        if (m_mode == scheduling::shared_queue) {
+            m_tasks.push(std::move(fn));
+            return;
+        }
+
+        // Counted before it is visible, so that a worker never parks while
+        // a task is on its way.
+        m_pending.fetch_add(1);
+
+        job *t = make_job(std::move(fn));
+        if (t_worker.pool == this) {
+            m_deques[t_worker.index]->push(t);  // stays local, lock-free
+        } else {
+            std::lock_guard<std::mutex> lock(m_injected_mutex);
+            m_injected.push_back(t);
+        }
+
+        if (m_sleeping.load() > 0) {
+            { std::lock_guard<std::mutex> lock(m_park_mutex); }
+            m_park.notify_one();
+        }
+    }
+
+    inline void thread_pool::setup_worker(unsigned int index)
+    {
+        if (!m_options.cores.empty()) {
+            pin_current_thread(m_options.cores[index % m_options.cores.size()]);
+        }
+        if (!m_options.name.empty()) {
+            set_current_thread_name(m_options.name + "-" + std::to_string(index));
+        }
+        if (m_mode == scheduling::work_stealing && !m_deques[index]) {
+            m_deques[index] = std::make_unique<work_stealing_deque<job>>();
+        }
+    }
+
+    template <class TryGet>
+    inline bool thread_pool::poll(TryGet try_get) const
+    {
+        if (m_options.wait == wait_strategy::park) return false;
+
+        do {
+            if (spinning_pays_off()) {
+                for (unsigned int i = 0; i < m_options.spin_budget; ++i) {
+                    if (try_get()) return true;
+                    cpu_relax();
+                }
+            }
+            for (unsigned int i = 0; i < SINGLE_CORE_YIELDS; ++i) {
+                if (try_get()) return true;
+                std::this_thread::yield();
+            }
+        } while (m_options.wait == wait_strategy::busy_poll && !m_stop);
+        return false;
+    }
+
+    inline void thread_pool::run_shared(unsigned int index)
+    {
+        setup_worker(index);
+        m_ready->count_down();
+
+        while (true) {
+            if (m_stop) break;
+            job task;
+            if (!poll([&] { return m_tasks.try_pop(task); })) {
+                if (m_stop) break;
+                task = m_tasks.pop();
+            }
+            if (m_stop) break;
+
+            run(task);
+        }
+    }
+
+    inline void thread_pool::run_stealing(unsigned int index)
+    {
+        t_worker = {this, index};
+        setup_worker(index);
+        // Every deque must exist before anyone steals.
+        m_ready->arrive_and_wait();
+
+        while (true) {
+            if (m_stop) break;
+
+            job *t = next_job(index);
+            if (!t) {
+                // m_pending first: an idle pool polls without taking the injection lock.
+                poll([&] { return m_pending.load() > 0 && (t = next_job(index)) != nullptr; });
+            }
+            if (t) {
+                m_pending.fetch_sub(1);
+                run(*t);
+                destroy_job(t);
+                continue;
+            }
+            if (m_stop) break;
+
+            std::unique_lock<std::mutex> lock(m_park_mutex);
+            ++m_sleeping;
+            m_park.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+            --m_sleeping;
+        }
+    }
+
+    inline thread_pool::job *thread_pool::next_job(unsigned int index)
+    {
+        work_stealing_deque<job> &own = *m_deques[index];
+        if (job *t = own.pop()) return t;
+
+        // External submissions: take a batch, so that the other workers can
+        // steal from it instead of contending on the injection lock.
+        {
+            constexpr std::size_t batch = 32;
+            std::lock_guard<std::mutex> lock(m_injected_mutex);
+            if (!m_injected.empty()) {
+                job *t = m_injected.front();
+                m_injected.pop_front();
+                for (std::size_t i = 1; i < batch && !m_injected.empty(); ++i) {
+                    own.push(m_injected.front());
+                    m_injected.pop_front();
+                }
+                return t;
+            }
+        }
+
+        // Steal from the other workers, starting at a random victim.
+        thread_local std::minstd_rand rng(std::random_device{}());
+        const std::size_t n = m_deques.size();
+        const std::size_t start = rng() % n;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t victim = (start + i) % n;
+            if (victim == index) continue;
+            if (job *t = m_deques[victim]->steal()) return t;
+        }
+        return nullptr;
+    }
+
+    inline thread_pool::job *thread_pool::make_job(job &&fn)
+    {
+        pool_allocator<job> allocator;
+        job *t = allocator.allocate(1);
+        ::new (static_cast<void *>(t)) job(std::move(fn));
+        return t;
+    }
+
+    inline void thread_pool::destroy_job(job *t)
+    {
+        t->~job();
+        pool_allocator<job>().deallocate(t, 1);
+    }
+
+    inline void thread_pool::run(job &fn)
+    {
+        try {
+            fn();
+        } catch (const std::exception &e) {
+            std::cerr << "[ThreadPool] Task threw exception: " 
+                      << e.what() << "\n";
+        } catch (...) {
+            std::cerr << "[ThreadPool] Task threw unknown exception\n";
+        }
+    }
+
 }  // namespace util
 
 #endif
@@ -0,0 +1,239 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "spin_wait.hpp"
+
+namespace util
+{
+    class timer_wheel;
+
+    // Timer embedded in the object it wakes up (no allocation per timer).
+    class wheel_timer
+    {
+        public:
+        virtual ~wheel_timer() = default;
+
+        // Called by timer_wheel::advance() with `fired` true once the
+        // deadline has passed, or by timer_wheel::drain() with false.
+        virtual void expire(bool fired) = 0;
+
+        private:
+        friend class timer_wheel;
+
+        enum class state { idle, linked, due };
+
+        wheel_timer *m_prev = nullptr;
+        wheel_timer *m_next = nullptr;
+        std::uint64_t m_tick = 0;  // absolute tick of the deadline
+        state m_state = state::idle;
+    };
+
+    // Hashed timing wheel (Varghese & Lauck, "Hashed and Hierarchical Timing
+    // Wheels", SOSP 1987): timers hash by deadline tick into a ring of slots,
+    // so scheduling and cancelling are O(1) and advancing costs one slot per
+    // elapsed tick. Deadlines further than one rotation away stay in their
+    // slot until the tick is reached.
+    //
+    // Not thread-safe: meant to be owned by one event loop, which calls
+    // advance() and sleeps until next_expiry() between events.
+    class timer_wheel
+    {
+        public:
+        using clock = std::chrono::steady_clock;
+
+        explicit timer_wheel(clock::duration resolution = std::chrono::microseconds(100),
+                             std::size_t slots = 4096);
+
+        timer_wheel(const timer_wheel &) = delete;
+        timer_wheel &operator=(const timer_wheel &) = delete;
+
+        // Arms `timer`, which must not be pending, to expire at `deadline`
+        // (rounded up to the resolution; past deadlines expire on the next
+        // advance()).
+        void schedule(wheel_timer &timer, clock::time_point deadline);
+
+        // Disarms `timer`. Returns false if it was not pending, i.e. it
+        // expired already (or is expiring in the current advance()).
+        bool cancel(wheel_timer &timer);
+
+        // Expires the timers due at `now`; returns how many. Callbacks may
+        // schedule and cancel timers.
+        std::size_t advance(clock::time_point now);
+
+        // Expires every pending timer with `fired` false.
+        void drain();
+
+        // Lower bound of the next deadline; clock::time_point::max() if no
+        // timer is pending.
+        clock::time_point next_expiry();
+
+        std::size_t size() const { return m_size; }
+
+        private:
+        std::uint64_t tick_at(clock::time_point t) const;  // rounded down
+        clock::time_point time_of(std::uint64_t tick) const;
+        void link(wheel_timer &timer);
+        void unlink(wheel_timer &timer);
+        void expire_due(bool fired);
+
+        clock::time_point m_origin;
+        clock::duration m_resolution;
+        std::vector<wheel_timer *> m_slots;  // list heads
+        std::size_t m_mask;
+        std::uint64_t m_current = 0;   // next tick to process
+        std::uint64_t m_min_tick = 0;  // no timer is due before it
+        std::size_t m_size = 0;
+        std::vector<wheel_timer *> m_due;  // reused by advance()
+    };
+
+
+    inline timer_wheel::timer_wheel(clock::duration resolution, std::size_t slots)
+        : m_origin(clock::now()),
+          m_resolution(std::max(resolution, clock::duration(1))),
+          m_slots(detail::round_up_pow2(std::max<std::size_t>(slots, 1)), nullptr),
+          m_mask(m_slots.size() - 1)
+    {
+    }
+
+    inline std::uint64_t timer_wheel::tick_at(clock::time_point t) const
+    {
+        if (t <= m_origin) return 0;
+        return static_cast<std::uint64_t>((t - m_origin) / m_resolution);
+    }
+
+    inline timer_wheel::clock::time_point timer_wheel::time_of(std::uint64_t tick) const
+    {
+        return m_origin + m_resolution * static_cast<clock::rep>(tick);
+    }
+
+    inline void timer_wheel::link(wheel_timer &timer)
+    {
+        wheel_timer *&head = m_slots[timer.m_tick & m_mask];
+        timer.m_prev = nullptr;
+        timer.m_next = head;
+        if (head) head->m_prev = &timer;
+        head = &timer;
+        timer.m_state = wheel_timer::state::linked;
+        ++m_size;
+    }
+
+    inline void timer_wheel::unlink(wheel_timer &timer)
+    {
+        if (timer.m_prev) {
+            timer.m_prev->m_next = timer.m_next;
+        } else {
+            m_slots[timer.m_tick & m_mask] = timer.m_next;
+        }
+        if (timer.m_next) timer.m_next->m_prev = timer.m_prev;
+        timer.m_prev = timer.m_next = nullptr;
+        timer.m_state = wheel_timer::state::idle;
+        --m_size;
+    }
+
+    inline void timer_wheel::schedule(wheel_timer &timer, clock::time_point deadline)
+    {
+        if (deadline == clock::time_point::max()) deadline = time_of(m_current + m_slots.size());
+        std::uint64_t tick = tick_at(deadline);
+        if (time_of(tick) < deadline) ++tick;  // never early
+        timer.m_tick = std::max(tick, m_current);
+
+        if (m_size == 0 || timer.m_tick < m_min_tick) m_min_tick = timer.m_tick;
+        link(timer);
+    }
+
+    inline bool timer_wheel::cancel(wheel_timer &timer)
+    {
+        switch (timer.m_state) {
+            case wheel_timer::state::linked:
+                unlink(timer);
+                return true;
+            case wheel_timer::state::due:
+                timer.m_state = wheel_timer::state::idle;  // skipped by expire_due()
+                return true;
+            case wheel_timer::state::idle:
+                break;
+        }
+        return false;
+    }
+
+    inline std::size_t timer_wheel::advance(clock::time_point now)
+    {
+        const std::uint64_t target = tick_at(now);
+        if (target < m_current) return 0;
+
+        if (m_size > 0 && target >= m_min_tick) {
+            // Visits each slot at most once, even after a long pause.
+            const std::uint64_t steps = std::min<std::uint64_t>(target - m_current + 1, m_slots.size());
+            for (std::uint64_t i = 0; i < steps; ++i) {
+                wheel_timer *t = m_slots[(m_current + i) & m_mask];
+                while (t) {
+                    wheel_timer *next = t->m_next;
+                    if (t->m_tick <= target) {
+                        unlink(*t);
+                        t->m_state = wheel_timer::state::due;
+                        m_due.push_back(t);
+                    }
+                    t = next;
+                }
+            }
+        }
+
+        m_current = target + 1;
+        if (m_min_tick < m_current) m_min_tick = m_current;
+
+        const std::size_t expired = m_due.size();
+        expire_due(true);
+        return expired;
+    }
+
+    inline void timer_wheel::drain()
+    {
+        for (wheel_timer *&head : m_slots) {
+            while (head) {
+                wheel_timer *t = head;
+                unlink(*t);
+                t->m_state = wheel_timer::state::due;
+                m_due.push_back(t);
+            }
+        }
+        expire_due(false);
+    }
+
+    inline void timer_wheel::expire_due(bool fired)
+    {
+        // Callbacks may re-arm their timer, which pushes nothing to m_due,
+        // or cancel a later due timer, which then is skipped.
+        std::vector<wheel_timer *> due;
+        due.swap(m_due);
+        for (wheel_timer *t : due) {
+            if (t->m_state != wheel_timer::state::due) continue;
+            t->m_state = wheel_timer::state::idle;
+            t->expire(fired);
+        }
+        due.clear();
+        if (m_due.empty()) m_due.swap(due);  // keep the capacity
+    }
+
+    inline timer_wheel::clock::time_point timer_wheel::next_expiry()
+    {
+        if (m_size == 0) return clock::time_point::max();
+
+        // m_min_tick is a lower bound; tighten it to the first non-empty
+        // slot within one rotation.
+        for (std::size_t i = 0; i < m_slots.size(); ++i) {
+            if (m_slots[(m_min_tick + i) & m_mask]) {
+                m_min_tick += i;
+                break;
+            }
+        }
+        return time_of(m_min_tick);
+    }
+
+}  // namespace util
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace util
+{
+    // Chase-Lev work-stealing deque of pointers (Le et al., "Correct and
+    // Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+    //
+    // The owner thread pushes and pops at the bottom without locking; any
+    // other thread may steal from the top. The deque grows when full; the
+    // buffers it outgrows are kept until destruction, since a thief may still
+    // be reading from them.
+    template <typename T>
+    class work_stealing_deque
+    {
+        public:
+        explicit work_stealing_deque(std::int64_t capacity = 256);
+
+        work_stealing_deque(const work_stealing_deque &) = delete;
+        work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+        // Owner only.
+        void push(T *item);
+        T *pop();  // nullptr if empty
+
+        // Any thread. Returns nullptr if empty or if it lost a race.
+        T *steal();
+
+        bool empty() const;
+
+        private:
+        struct buffer
+        {
+            explicit buffer(std::int64_t cap) : capacity(cap), mask(cap - 1), slots(cap) {}
+
+            T *get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+            void put(std::int64_t i, T *item) { slots[i & mask].store(item, std::memory_order_relaxed); }
+
+            std::int64_t capacity;
+            std::int64_t mask;
+            std::vector<std::atomic<T *>> slots;
+        };
+
+        buffer *grow(buffer *old, std::int64_t top, std::int64_t bottom);
+
+        alignas(64) std::atomic<std::int64_t> m_top{0};
+        alignas(64) std::atomic<std::int64_t> m_bottom{0};
+        std::atomic<buffer *> m_buffer;
+        std::vector<std::unique_ptr<buffer>> m_buffers;  // owner only
+    };
+
+
+    template <typename T>
+    inline work_stealing_deque<T>::work_stealing_deque(std::int64_t capacity)
+    {
+        std::int64_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_buffers.push_back(std::make_unique<buffer>(cap));
+        m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline void work_stealing_deque<T>::push(T *item)
+    {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = m_top.load(std::memory_order_acquire);
+        buffer *a = m_buffer.load(std::memory_order_relaxed);
+
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline T *work_stealing_deque<T>::pop()
+    {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        buffer *a = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T *item = a->get(b);
+        if (t == b) {
+            // Last item: race against thieves for it.
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    template <typename T>
+    inline T *work_stealing_deque<T>::steal()
+    {
+        std::int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return nullptr;
+
+        buffer *a = m_buffer.load(std::memory_order_acquire);
+        T *item = a->get(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    template <typename T>
+    inline bool work_stealing_deque<T>::empty() const
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline typename work_stealing_deque<T>::buffer *
+    work_stealing_deque<T>::grow(buffer *old, std::int64_t top, std::int64_t bottom)
+    {
+        auto bigger = std::make_unique<buffer>(old->capacity * 2);
+        for (std::int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        buffer *a = bigger.get();
+        m_buffers.push_back(std::move(bigger));
+        m_buffer.store(a, std::memory_order_release);
+        return a;
+    }
+
+}  // namespace util
+
+#endif
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "Analytics.hpp"
+#include <cmath>
+
+namespace {
+
+// A deterministic random walk, with some zero-volume days.
+PriceColumns make_columns(std::size_t rows) {
+  PriceColumns columns;
+  double close = 100;
+  std::uint64_t state = 42;
+  for (std::size_t i = 0; i < rows; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    close *= 1 + (static_cast<double>(state >> 40) / (1ULL << 24) - 0.5) * 0.04;
+    const auto volume = static_cast<long long>(i % 17 == 0 ? 0 : (state >> 44) + 1000);
+    columns.append(StockData(static_cast<std::int32_t>(i), close, close, close, close, close,
+                             volume));
+  }
+  return columns;
+}
+
+}  // namespace
+
+TEST(AnalyticsTest, KernelsMatchThePerRowDefinitions) {
+  const PriceColumns columns = make_columns(300);
+  const PriceColumnsView view = columns.view();
+  const std::uint32_t window = 20;
+
+  const auto sma = compute_indicator(view, Indicator::Sma, window);
+  const auto ema = compute_indicator(view, Indicator::Ema, window);
+  const auto vwap = compute_indicator(view, Indicator::Vwap, window);
+  const auto returns = compute_indicator(view, Indicator::LogReturn, 0);
+  const auto volatility = compute_indicator(view, Indicator::Volatility, window);
+
+  double expected_ema = view.close[0];
+  for (std::size_t i = 0; i < view.size(); ++i) {
+    const std::size_t first = i + 1 >= window ? i + 1 - window : 0;
+    double sum = 0, notional = 0, volume = 0;
+    for (std::size_t j = first; j <= i; ++j) {
+      sum += view.close[j];
+      notional += view.close[j] * view.volume[j];
+      volume += view.volume[j];
+    }
+    expected_ema += 2.0 / (window + 1) * (view.close[i] - expected_ema);
+    const double expected_return = i ? std::log(view.close[i] / view.close[i - 1]) : 0;
+
+    // Sample standard deviation of the returns of rows [max(first, 1), i].
+    const std::size_t from = std::max<std::size_t>(first, 1);
+    const double n = static_cast<double>(i + 1 - from);
+    double mean = 0, variance = 0;
+    for (std::size_t j = from; j <= i; ++j) mean += std::log(view.close[j] / view.close[j - 1]);
+    mean /= std::max(n, 1.0);
+    for (std::size_t j = from; j <= i; ++j) {
+      const double r = std::log(view.close[j] / view.close[j - 1]);
+      variance += (r - mean) * (r - mean);
+    }
+
+    EXPECT_NEAR(sma[i], sum / (i + 1 - first), 1e-9) << i;
+    EXPECT_NEAR(ema[i], expected_ema, 1e-9) << i;
+    EXPECT_NEAR(vwap[i], volume > 0 ? notional / volume : view.close[i], 1e-9) << i;
+    EXPECT_NEAR(returns[i], expected_return, 1e-12) << i;
+    EXPECT_NEAR(volatility[i], n < 2 ? 0 : std::sqrt(variance / (n - 1)), 1e-9) << i;
+  }
+}
+
+TEST(AnalyticsTest, CacheSharesColumnsPerSeriesVersion) {
+  StockStore store;
+  store.add("AAPL", make_columns(50));
+  IndicatorWindows windows;
+  windows.sma = 5;
+  windows.log_return = true;
+
+  IndicatorCache cache;
+  const IndicatorSet first = cache.get(store.series("AAPL"), windows);
+  const IndicatorSet second = cache.get(store.series("AAPL"), windows);
+  EXPECT_EQ(first.sma, second.sma);
+  EXPECT_EQ(first.log_return, second.log_return);
+  EXPECT_FALSE(first.ema);
+
+  // A new version of the series gets its own columns.
+  PriceColumns more;
+  more.append(StockData(1000, 1, 1, 1, 1, 1, 1));
+  store.add("AAPL", std::move(more));
+  const IndicatorSet third = cache.get(store.series("AAPL"), windows);
+  EXPECT_NE(third.sma, first.sma);
+  EXPECT_EQ(third.sma->size(), 51u);
+
+  marketdata::IndicatorRequest request;
+  request.set_sma_window(IndicatorWindows::kMaxWindow + 1);
+  std::string error;
+  EXPECT_FALSE(indicator_windows(request, windows, error));
+}
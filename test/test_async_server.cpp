@@ -0,0 +1,516 @@
+#include "gtest/gtest.h"
+#include "AsyncMarketDataServer.hpp"
+#include "MarketDataClient.hpp"
+#include "PipelinedClient.hpp"
+#include "thread_pool.hpp"
+#include <grpcpp/grpcpp.h>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// Runs the async engine in-process on an ephemeral port with sample.csv loaded.
+class AsyncServerFixture : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+    m_service.set_replay(
+        ReplayOptions::uniform(std::chrono::microseconds(0), std::chrono::microseconds(100)));
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &m_port);
+    m_engine.configure(builder);
+    m_server = builder.BuildAndStart();
+    ASSERT_NE(m_server, nullptr);
+    m_engine.start();
+
+    m_stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+        "localhost:" + std::to_string(m_port), grpc::InsecureChannelCredentials()));
+  }
+
+  void TearDown() override {
+    m_server->Shutdown();
+    m_engine.stop();
+  }
+
+  MarketDataServiceImpl m_service;
+  AsyncMarketDataServer m_engine{m_service, 2};
+  std::unique_ptr<grpc::Server> m_server;
+  std::unique_ptr<marketdata::MarketData::Stub> m_stub;
+  int m_port = 0;
+};
+
+}  // namespace
+
+TEST_F(AsyncServerFixture, StreamsEveryRow) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+
+  auto reader = m_stub->Subscribe(&context, request);
+  std::vector<marketdata::StockPrice> received;
+  marketdata::StockPrice price;
+  while (reader->Read(&price)) {
+    received.push_back(price);
+  }
+
+  EXPECT_TRUE(reader->Finish().ok());
+  ASSERT_EQ(received.size(), 2);
+  EXPECT_EQ(received[0].symbol(), "AAPL");
+  EXPECT_DOUBLE_EQ(received[0].close(), 110.08000183105469);
+  EXPECT_EQ(received[1].volume(), 183055400);
+  EXPECT_GT(received[1].timestamp_ns(), 0);
+}
+
+TEST_F(AsyncServerFixture, UnknownSymbolIsNotFound) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("XXXX");
+
+  auto reader = m_stub->Subscribe(&context, request);
+  marketdata::StockPrice price;
+  EXPECT_FALSE(reader->Read(&price));
+  EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(AsyncServerFixture, ConcurrentSubscribers) {
+  constexpr int kSubscribers = 32;
+  std::vector<std::thread> threads;
+  std::atomic<int> completed{0};
+
+  for (int i = 0; i < kSubscribers; ++i) {
+    threads.emplace_back([&]() {
+      grpc::ClientContext context;
+      marketdata::StockRequest request;
+      request.set_symbol("AAPL");
+      auto reader = m_stub->Subscribe(&context, request);
+      marketdata::StockPrice price;
+      int rows = 0;
+      while (reader->Read(&price)) ++rows;
+      if (reader->Finish().ok() && rows == 2) ++completed;
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(completed.load(), kSubscribers);
+}
+
+TEST_F(AsyncServerFixture, SymbolLoadedAfterSubscribeIsServed) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "async_server_msft.csv").string();
+  {
+    std::ofstream out(path);
+    out << "MSFT\nDate,Adj Close,Close,High,Low,Open,Volume\n"
+        << "2020-09-21,1,2,3,4,5,6\n2020-09-22,1,2,3,4,5,7\n";
+  }
+
+  // The single pool thread is held until the subscription is waiting.
+  util::thread_pool pool(1);
+  std::promise<void> gate;
+  pool.ExecuteTask([f = gate.get_future().share()] { f.wait(); });
+  std::thread loader([&] { m_service.load_files({path}, pool); });
+  while (!m_service.loading()) std::this_thread::yield();
+
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("MSFT");
+  auto reader = m_stub->Subscribe(&context, request);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  gate.set_value();
+
+  marketdata::StockPrice price;
+  int rows = 0;
+  while (reader->Read(&price)) ++rows;
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(rows, 2);
+
+  loader.join();
+  std::filesystem::remove(path);
+}
+
+TEST_F(AsyncServerFixture, SubscriberWaitsForTheLoadPhase) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "async_server_load_phase.csv").string();
+  {
+    std::ofstream out(path);
+    out << "MSFT\nDate,Adj Close,Close,High,Low,Open,Volume\n"
+        << "2020-09-21,1,2,3,4,5,6\n2020-09-22,1,2,3,4,5,7\n";
+  }
+
+  // Before any load starts, as between BuildAndStart() and the loaders.
+  m_service.begin_loading();
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("MSFT");
+  auto reader = m_stub->Subscribe(&context, request);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  m_service.load_data(path);
+  m_service.end_loading();
+
+  marketdata::StockPrice price;
+  int rows = 0;
+  while (reader->Read(&price)) ++rows;
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(rows, 2);
+  EXPECT_FALSE(m_service.loading());
+  std::filesystem::remove(path);
+}
+
+TEST_F(AsyncServerFixture, SubscribeManyMergesSymbolsByDay) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "async_server_multi.csv").string();
+  {
+    std::ofstream out(path);
+    out << "MSFT\nDate,Adj Close,Close,High,Low,Open,Volume\n"
+        << "2020-09-18,1,2,3,4,5,6\n2020-09-22,1,2,3,4,5,7\n2020-09-23,1,2,3,4,5,8\n";
+  }
+  m_service.load_data(path);
+  std::filesystem::remove(path);
+
+  auto client = MarketDataClient::createClient(grpc::CreateChannel(
+      "localhost:" + std::to_string(m_port), grpc::InsecureChannelCredentials()));
+  ASSERT_TRUE(client.ok());
+
+  std::vector<std::pair<std::string, std::string>> received;
+  grpc::Status status = client->subscribeToSymbols(
+      {"AAPL", "MSFT", "AAPL"}, [&](const marketdata::StockPrice &price) {
+        received.emplace_back(format_date(price.epoch_day()), price.symbol());
+      });
+
+  EXPECT_TRUE(status.ok());
+  const std::vector<std::pair<std::string, std::string>> expected = {
+      {"2020-09-18", "MSFT"}, {"2020-09-21", "AAPL"}, {"2020-09-22", "AAPL"},
+      {"2020-09-22", "MSFT"}, {"2020-09-23", "MSFT"}};
+  EXPECT_EQ(received, expected);
+}
+
+TEST_F(AsyncServerFixture, SubscribeManyBatchesOneDayPerMessage) {
+  grpc::ClientContext context;
+  marketdata::MultiStockRequest request;
+  request.add_symbols("AAPL");
+  request.set_max_batch(8);
+
+  auto reader = m_stub->SubscribeMany(&context, request);
+  marketdata::StockPriceBatch batch;
+  int batches = 0;
+  while (reader->Read(&batch)) {
+    ++batches;
+    EXPECT_EQ(batch.prices_size(), 1);  // the stream is paced: one day per message
+  }
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(batches, 2);
+}
+
+TEST_F(AsyncServerFixture, SubscribeManyUnknownSymbolIsNotFound) {
+  grpc::ClientContext context;
+  marketdata::MultiStockRequest request;
+  request.add_symbols("AAPL");
+  request.add_symbols("XXXX");
+
+  auto reader = m_stub->SubscribeMany(&context, request);
+  marketdata::StockPriceBatch batch;
+  EXPECT_FALSE(reader->Read(&batch));
+  grpc::Status status = reader->Finish();
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::NOT_FOUND);
+  EXPECT_EQ(status.error_message(), "Symbol not found: XXXX");
+}
+
+TEST_F(AsyncServerFixture, CompactSubscriptionDecodesToFullValues) {
+  auto client = MarketDataClient::createClient(grpc::CreateChannel(
+      "localhost:" + std::to_string(m_port), grpc::InsecureChannelCredentials()));
+  ASSERT_TRUE(client.ok());
+
+  std::vector<marketdata::StockPrice> single, many;
+  EXPECT_TRUE(client->subscribeToSymbol("AAPL", [&](const marketdata::StockPrice &price) {
+    single.push_back(price);
+  }, marketdata::COMPACT).ok());
+  EXPECT_TRUE(client->subscribeToSymbols({"AAPL"}, [&](const marketdata::StockPrice &price) {
+    many.push_back(price);
+  }, 0, marketdata::COMPACT).ok());
+
+  for (const auto *received : {&single, &many}) {
+    ASSERT_EQ(received->size(), 2u);
+    EXPECT_EQ((*received)[0].symbol(), "AAPL");
+    EXPECT_NEAR((*received)[0].close(), 110.08000183105469, 1e-6);
+    EXPECT_NEAR((*received)[1].open(), 112.68000030517578, 1e-6);
+    EXPECT_EQ((*received)[1].volume(), 183055400);
+    EXPECT_EQ(format_date((*received)[1].epoch_day()), "2020-09-22");
+    EXPECT_GT((*received)[1].timestamp_ns(), (*received)[0].timestamp_ns());
+  }
+  // Both subscriptions recorded the latency of their two updates.
+  EXPECT_EQ(client->latency().histogram("AAPL").count(), 4u);
+}
+
+TEST_F(AsyncServerFixture, RequestChoosesItsReplay) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  // The two rows are on consecutive trading days, i.e. half a second apart.
+  request.mutable_replay()->set_mode(marketdata::Replay::HISTORICAL);
+  request.mutable_replay()->set_rate(2);
+
+  const auto start = std::chrono::steady_clock::now();
+  auto reader = m_stub->Subscribe(&context, request);
+  marketdata::StockPrice price;
+  int received = 0;
+  while (reader->Read(&price)) ++received;
+
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(received, 2);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST_F(AsyncServerFixture, InvalidReplayIsRejected) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  request.mutable_replay()->set_mode(marketdata::Replay::FIXED_RATE);  // without a rate
+
+  auto reader = m_stub->Subscribe(&context, request);
+  marketdata::StockPrice price;
+  EXPECT_FALSE(reader->Read(&price));
+  EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(AsyncServerFixture, RequestedIndicatorsAreStreamed) {
+  marketdata::MultiStockRequest request;
+  request.add_symbols("AAPL");
+  request.set_encoding(marketdata::COMPACT);
+  request.mutable_indicators()->set_sma_window(2);
+  request.mutable_indicators()->set_log_return(true);
+
+  grpc::ClientContext context;
+  auto reader = m_stub->SubscribeMany(&context, request);
+  std::vector<marketdata::CompactPrice> received;
+  marketdata::StockPriceBatch batch;
+  while (reader->Read(&batch)) {
+    for (const auto &price : batch.compact_prices()) received.push_back(price);
+  }
+
+  EXPECT_TRUE(reader->Finish().ok());
+  ASSERT_EQ(received.size(), 2u);
+  const marketdata::Indicators &first = received[0].indicators();
+  const marketdata::Indicators &second = received[1].indicators();
+  EXPECT_DOUBLE_EQ(first.sma(), 110.08000183105469);
+  EXPECT_DOUBLE_EQ(first.log_return(), 0);
+  EXPECT_DOUBLE_EQ(second.sma(), (110.08000183105469 + 111.80999755859375) / 2);
+  EXPECT_DOUBLE_EQ(second.log_return(), std::log(111.80999755859375 / 110.08000183105469));
+  EXPECT_EQ(second.ema(), 0);  // not requested
+}
+
+TEST_F(AsyncServerFixture, WeeklyBarsAreStreamed) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  request.set_resolution(marketdata::WEEKLY);
+
+  auto reader = m_stub->Subscribe(&context, request);
+  std::vector<marketdata::StockPrice> received;
+  marketdata::StockPrice price;
+  while (reader->Read(&price)) received.push_back(price);
+
+  // Both rows are of the week of Monday 2020-09-21.
+  EXPECT_TRUE(reader->Finish().ok());
+  ASSERT_EQ(received.size(), 1u);
+  EXPECT_EQ(received[0].epoch_day(), parse_date("2020-09-22"));
+  EXPECT_DOUBLE_EQ(received[0].open(), 104.54000091552734);
+  EXPECT_DOUBLE_EQ(received[0].high(), 112.86000061035156);
+  EXPECT_DOUBLE_EQ(received[0].low(), 103.0999984741211);
+  EXPECT_DOUBLE_EQ(received[0].close(), 111.80999755859375);
+  EXPECT_EQ(received[0].volume(), 195713800 + 183055400);
+
+  grpc::ClientContext rejected;
+  request.set_bar_rows(5);
+  reader = m_stub->Subscribe(&rejected, request);
+  EXPECT_FALSE(reader->Read(&price));
+  EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(AsyncServerFixture, FollowingStreamReceivesPublishedRows) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  request.set_follow(true);
+  auto reader = m_stub->Subscribe(&context, request);
+
+  marketdata::StockPrice price;
+  ASSERT_TRUE(reader->Read(&price));
+  ASSERT_TRUE(reader->Read(&price));
+  EXPECT_EQ(price.seq(), 2u);
+
+  auto client = MarketDataClient::createClient(grpc::CreateChannel(
+      "localhost:" + std::to_string(m_port), grpc::InsecureChannelCredentials()));
+  ASSERT_TRUE(client.ok());
+  int messages = 0;
+  std::uint64_t rows = 0;
+  const grpc::Status status = client->publish([&](marketdata::StockPriceBatch &batch) {
+    batch.Clear();
+    marketdata::StockPrice *row = batch.add_prices();
+    row->set_symbol("AAPL");
+    row->set_epoch_day(*parse_date("2020-09-23"));
+    row->set_close(100 + messages);
+    return ++messages <= 2;
+  }, &rows);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  EXPECT_EQ(rows, 2u);
+
+  for (std::uint64_t seq = 3; seq <= 4; ++seq) {
+    ASSERT_TRUE(reader->Read(&price));
+    EXPECT_EQ(price.seq(), seq);
+    EXPECT_DOUBLE_EQ(price.close(), 100 + static_cast<double>(seq - 3));
+  }
+  context.TryCancel();
+  EXPECT_FALSE(reader->Read(&price));
+  EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::CANCELLED);
+
+  // Rows before the last one are rejected.
+  bool sent = false;
+  const grpc::Status rejected = client->publish([&](marketdata::StockPriceBatch &batch) {
+    batch.Clear();
+    marketdata::StockPrice *row = batch.add_prices();
+    row->set_symbol("AAPL");
+    row->set_epoch_day(*parse_date("2020-09-01"));
+    return !std::exchange(sent, true);
+  });
+  EXPECT_EQ(rejected.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_EQ(m_service.getStockData("AAPL").size(), 4u);
+}
+
+TEST_F(AsyncServerFixture, QueryRangeStreamsTheRange) {
+  auto client = MarketDataClient::createClient(grpc::CreateChannel(
+      "localhost:" + std::to_string(m_port), grpc::InsecureChannelCredentials()));
+  ASSERT_TRUE(client.ok());
+
+  marketdata::RangeRequest request;
+  request.set_symbol("AAPL");
+  request.set_to_date("2020-09-21");
+  request.add_columns(marketdata::RangeRequest::VOLUME);
+  std::vector<std::int64_t> volumes;
+  EXPECT_TRUE(client->queryRange(request, [&](const marketdata::RangeChunk &chunk) {
+    EXPECT_EQ(chunk.close_size(), 0);
+    volumes.insert(volumes.end(), chunk.volume().begin(), chunk.volume().end());
+  }).ok());
+  EXPECT_EQ(volumes, std::vector<std::int64_t>{195713800});
+
+  request.set_symbol("NOPE");
+  EXPECT_EQ(client->queryRange(request, [](const marketdata::RangeChunk &) {}).error_code(),
+            grpc::StatusCode::NOT_FOUND);
+  request.set_symbol("AAPL");
+  request.set_from_date("2020-13-01");
+  EXPECT_EQ(client->queryRange(request, [](const marketdata::RangeChunk &) {}).error_code(),
+            grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(AsyncServerFixture, SubscriptionResumesAfterSequenceOrDay) {
+  auto seqs_of = [&](const marketdata::StockRequest &request) {
+    grpc::ClientContext context;
+    auto reader = m_stub->Subscribe(&context, request);
+    std::vector<std::uint64_t> seqs;
+    marketdata::StockPrice price;
+    while (reader->Read(&price)) seqs.push_back(price.seq());
+    EXPECT_TRUE(reader->Finish().ok());
+    return seqs;
+  };
+
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  EXPECT_EQ(seqs_of(request), (std::vector<std::uint64_t>{1, 2}));
+  request.set_start_after_seq(1);
+  EXPECT_EQ(seqs_of(request), (std::vector<std::uint64_t>{2}));
+  request.set_start_after_seq(2);
+  EXPECT_TRUE(seqs_of(request).empty());
+
+  request.set_start_after_seq(0);
+  request.set_start_epoch_day(*parse_date("2020-09-22"));
+  EXPECT_EQ(seqs_of(request), (std::vector<std::uint64_t>{2}));
+
+  marketdata::MultiStockRequest many;
+  many.add_symbols("AAPL");
+  (*many.mutable_start_after_seq())["AAPL"] = 1;
+  grpc::ClientContext context;
+  auto reader = m_stub->SubscribeMany(&context, many);
+  marketdata::StockPriceBatch batch;
+  std::vector<std::uint64_t> seqs;
+  while (reader->Read(&batch)) {
+    for (const auto &price : batch.prices()) seqs.push_back(price.seq());
+  }
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(seqs, (std::vector<std::uint64_t>{2}));
+}
+
+TEST_F(AsyncServerFixture, GetStatsCountsUpdatesPerSymbol) {
+  grpc::ClientContext context;
+  marketdata::StockRequest request;
+  request.set_symbol("AAPL");
+  auto reader = m_stub->Subscribe(&context, request);
+  marketdata::StockPrice price;
+  while (reader->Read(&price)) {
+  }
+  ASSERT_TRUE(reader->Finish().ok());
+
+  grpc::ClientContext stats_context;
+  marketdata::StatsRequest stats_request;
+  stats_request.set_prefix("updates_");
+  marketdata::StatsReply reply;
+  ASSERT_TRUE(m_stub->GetStats(&stats_context, stats_request, &reply).ok());
+  ASSERT_EQ(reply.metrics_size(), 1);
+  EXPECT_EQ(reply.metrics(0).name(), "updates_sent");
+  EXPECT_EQ(reply.metrics(0).label(), "AAPL");
+  EXPECT_EQ(reply.metrics(0).value(), 2);
+
+  // Both writes completed before the stream finished.
+  const auto latency = m_service.metrics().registry().snapshot("write_latency_ns");
+  ASSERT_EQ(latency.size(), 1u);
+  EXPECT_EQ(latency[0].count, 2u);
+}
+
+TEST_F(AsyncServerFixture, PipelinedClientHandsEveryUpdateInOrder) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "async_server_pipeline.csv").string();
+  {
+    std::ofstream out(path);
+    out << "MSFT\nDate,Adj Close,Close,High,Low,Open,Volume\n"
+        << "2020-09-18,1,2,3,4,5,6\n2020-09-22,1,2,3,4,5,7\n2020-09-23,1,2,3,4,5,8\n";
+  }
+  m_service.load_data(path);
+  std::filesystem::remove(path);
+
+  // Records the sequence numbers per symbol, slowly enough for the rings to fill.
+  struct Recorder : PriceConsumer {
+    void on_ticks(const std::string &symbol, std::span<const Tick> ticks) override {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const Tick &tick : ticks) seqs[symbol].push_back(tick.seq);
+    }
+    std::mutex mutex;
+    std::map<std::string, std::vector<std::uint64_t>> seqs;
+  };
+
+  for (bool per_symbol : {false, true}) {
+    Recorder recorder;
+    PipelineOptions options;
+    options.handler_threads = 2;
+    options.stream_per_symbol = per_symbol;
+    options.ring_capacity = 1;
+    options.max_batch = 2;
+    PipelinedClient client(grpc::CreateChannel("localhost:" + std::to_string(m_port),
+                                               grpc::InsecureChannelCredentials()),
+                           {"AAPL", "MSFT"}, recorder, options);
+
+    EXPECT_TRUE(client.run().ok());
+    EXPECT_EQ(recorder.seqs["AAPL"], (std::vector<std::uint64_t>{1, 2}));
+    EXPECT_EQ(recorder.seqs["MSFT"], (std::vector<std::uint64_t>{1, 2, 3}));
+
+    const auto stats = client.stats();
+    ASSERT_EQ(stats.size(), 2);
+    EXPECT_EQ(stats[1].symbol, "MSFT");
+    EXPECT_EQ(stats[1].received, 3);
+    EXPECT_EQ(stats[1].handled, 3);
+    EXPECT_GE(stats[1].batches, 2);
+  }
+}
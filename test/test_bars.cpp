@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "Bars.hpp"
+
+namespace {
+
+std::int32_t day(const char *date) { return parse_date(date).value(); }
+
+// One row per calendar day from `first` on, `n` rows; row i has the price
+// i + 1 (the high one above it, the low one below) and the volume i + 1.
+PriceColumns make_days(std::int32_t first, std::size_t n) {
+  PriceColumns columns;
+  for (std::size_t i = 0; i < n; ++i) {
+    const double price = static_cast<double>(i + 1);
+    columns.append(StockData(first + static_cast<std::int32_t>(i), price, price, price + 1,
+                             price - 1, price, static_cast<long long>(i + 1)));
+  }
+  return columns;
+}
+
+void expect_same_bars(const StockSeries &a, const StockSeries &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(a[i].epoch_day(), b[i].epoch_day()) << i;
+    EXPECT_EQ(a[i].open(), b[i].open()) << i;
+    EXPECT_EQ(a[i].high(), b[i].high()) << i;
+    EXPECT_EQ(a[i].low(), b[i].low()) << i;
+    EXPECT_EQ(a[i].close(), b[i].close()) << i;
+    EXPECT_EQ(a[i].volume(), b[i].volume()) << i;
+  }
+}
+
+}  // namespace
+
+TEST(BarsTest, CalendarBarsAggregateOhlcv) {
+  EXPECT_EQ(period_of(marketdata::WEEKLY, day("2024-01-01")),  // a Monday
+            period_of(marketdata::WEEKLY, day("2024-01-07")));
+  EXPECT_NE(period_of(marketdata::WEEKLY, day("2024-01-07")),
+            period_of(marketdata::WEEKLY, day("2024-01-08")));
+  EXPECT_EQ(period_of(marketdata::QUARTERLY, day("2024-03-31")) + 1,
+            period_of(marketdata::QUARTERLY, day("2024-04-01")));
+
+  // 2024-01-01 to 2024-04-09: 100 days.
+  StockStore store;
+  store.add("AAPL", make_days(day("2024-01-01"), 100));
+  const BarPyramid pyramid(store.series("AAPL"));
+
+  const StockSeries weeks = pyramid.level(marketdata::WEEKLY);
+  ASSERT_EQ(weeks.size(), 15u);  // 14 full weeks, then 2 days
+  EXPECT_EQ(weeks[0].date(), "2024-01-07");
+  EXPECT_EQ(weeks[0].open(), 1);
+  EXPECT_EQ(weeks[0].close(), 7);
+  EXPECT_EQ(weeks[0].high(), 8);
+  EXPECT_EQ(weeks[0].low(), 0);
+  EXPECT_EQ(weeks[0].volume(), 1 + 2 + 3 + 4 + 5 + 6 + 7);
+  EXPECT_EQ(weeks[14].date(), "2024-04-09");
+  EXPECT_EQ(weeks[14].volume(), 99 + 100);
+
+  const StockSeries months = pyramid.level(marketdata::MONTHLY);
+  ASSERT_EQ(months.size(), 4u);
+  EXPECT_EQ(months[1].date(), "2024-02-29");
+  EXPECT_EQ(months[1].open(), 32);
+  EXPECT_EQ(months[1].close(), 60);
+  EXPECT_EQ(months[1].high(), 61);
+  EXPECT_EQ(months[1].low(), 31);
+
+  const StockSeries quarters = pyramid.level(marketdata::QUARTERLY);
+  ASSERT_EQ(quarters.size(), 2u);
+  EXPECT_EQ(quarters[0].date(), "2024-03-31");
+  EXPECT_EQ(quarters[0].open(), 1);
+  EXPECT_EQ(quarters[0].close(), 91);
+  EXPECT_EQ(quarters[0].volume(), 91 * 92 / 2);
+  ASSERT_EQ(pyramid.level(marketdata::YEARLY).size(), 1u);
+  EXPECT_EQ(pyramid.level(marketdata::YEARLY)[0].high(), 101);
+
+  const PriceColumns rows = aggregate_rows(store.series("AAPL").columns(), 30);
+  ASSERT_EQ(rows.size(), 4u);
+  EXPECT_EQ(rows.volume[3], 91 + 92 + 93 + 94 + 95 + 96 + 97 + 98 + 99 + 100);
+
+  BarSpec spec;
+  std::string error;
+  EXPECT_FALSE(bar_spec(marketdata::MONTHLY, 5, spec, error));
+  EXPECT_FALSE(bar_spec(static_cast<marketdata::Resolution>(42), 0, spec, error));
+  EXPECT_TRUE(bar_spec(marketdata::DAILY, 5, spec, error));
+  EXPECT_TRUE(spec.any());
+}
+
+TEST(BarsTest, AppendedRowsExtendThePyramid) {
+  StockStore store;
+  store.add("AAPL", make_days(day("2023-11-15"), 60));
+  BarStore bars;
+  bars.update("AAPL", store.series("AAPL"));
+  BarSpec spec;
+  spec.resolution = marketdata::MONTHLY;
+  const StockSeries before = bars.bars("AAPL", store.series("AAPL"), spec);
+  ASSERT_EQ(before.size(), 3u);  // mid-November to mid-January
+
+  // Completes January, then goes on into the next quarter and year.
+  PriceColumns more = make_days(day("2023-11-15") + 60, 500);
+  for (std::size_t i = 0; i < more.size(); ++i) {
+    more.volume[i] += 1000;
+    more.high[i] += 5;
+  }
+  store.add("AAPL", std::move(more));
+  bars.update("AAPL", store.series("AAPL"));
+
+  const BarPyramid rebuilt(store.series("AAPL"));
+  for (auto resolution : {marketdata::WEEKLY, marketdata::MONTHLY, marketdata::QUARTERLY,
+                          marketdata::YEARLY}) {
+    spec.resolution = resolution;
+    expect_same_bars(bars.bars("AAPL", store.series("AAPL"), spec), rebuilt.level(resolution));
+  }
+
+  // Streams that started on the previous version keep their bars.
+  EXPECT_EQ(before.size(), 3u);
+  EXPECT_EQ(before[2].date(), "2024-01-13");
+}
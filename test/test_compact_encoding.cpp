@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "CompactDecoder.hpp"
+#include "CompactEncoder.hpp"
+
+TEST(CompactEncodingTest, RoundTripsDeltasOfEverySymbol) {
+    const std::vector<std::pair<std::uint32_t, StockData>> rows = {
+        {0, StockData("2020-09-21", 107.0767822265625, 110.08000183105469, 110.19000244140625,
+                      103.0999984741211, 104.54000091552734, 195713800)},
+        {1, StockData("2020-09-21", 1.5, 2.25, 3.0, 1.0, 2.0, 10)},
+        {0, StockData("2020-09-22", 108.75956726074219, 111.80999755859375, 112.86000061035156,
+                      109.16000366210938, 112.68000030517578, 183055400)},
+        {1, StockData("2020-09-25", 1.25, 2.0, 2.5, 0.75, 2.125, 0)},  // prices fall
+    };
+
+    CompactEncoder encoder(2);
+    CompactDecoder decoder({"AAPL", "MSFT", "AAPL"});
+    std::int64_t timestamp = 1'600'000'000'000'000'000;
+
+    for (const auto &[id, row] : rows) {
+        timestamp += 1500;
+        marketdata::CompactPrice compact;
+        encoder.encode(id, row, timestamp, compact);
+
+        marketdata::StockPrice price;
+        ASSERT_TRUE(decoder.decode(compact, price));
+        EXPECT_EQ(price.symbol(), id == 0 ? "AAPL" : "MSFT");
+        EXPECT_NEAR(price.adjustedclose(), row.adj_close(), 1e-6);
+        EXPECT_NEAR(price.close(), row.close(), 1e-6);
+        EXPECT_NEAR(price.high(), row.high(), 1e-6);
+        EXPECT_NEAR(price.low(), row.low(), 1e-6);
+        EXPECT_NEAR(price.open(), row.open(), 1e-6);
+        EXPECT_EQ(price.volume(), row.volume());
+        EXPECT_EQ(price.epoch_day(), row.epoch_day());
+        EXPECT_EQ(price.timestamp_ns(), timestamp);
+    }
+}
+
+TEST(CompactEncodingTest, SmallDeltasAreSmallerThanFullMessage) {
+    CompactEncoder encoder;
+    marketdata::CompactPrice first, second;
+    const std::int64_t t0 = 1'600'000'000'000'000'000;
+    encoder.encode(0, StockData("2020-09-21", 110.08, 110.08, 110.19, 103.1, 104.54, 195713800), t0, first);
+    encoder.encode(0, StockData("2020-09-22", 110.11, 110.12, 110.25, 103.05, 104.6, 195700000), t0 + 900, second);
+
+    marketdata::StockPrice full;
+    full.set_symbol("AAPL");
+    full.set_adjustedclose(110.11);
+    full.set_close(110.12);
+    full.set_high(110.25);
+    full.set_low(103.05);
+    full.set_open(104.6);
+    full.set_volume(195700000);
+    full.set_timestamp_ns(t0 + 900);
+    full.set_epoch_day(18527);
+
+    EXPECT_LT(second.ByteSizeLong() * 2, full.ByteSizeLong());
+}
+
+TEST(CompactEncodingTest, UnknownSymbolIdIsRejected) {
+    CompactDecoder decoder({"AAPL"});
+    marketdata::CompactPrice compact;
+    compact.set_symbol_id(1);
+    marketdata::StockPrice price;
+    EXPECT_FALSE(decoder.decode(compact, price));
+}
@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "CsvLoader.hpp"
+
+TEST(CsvLoaderTest, ParsesRowsInPlace) {
+    const std::string csv =
+        "AAPL\r\n"
+        "Date,Adj Close,Close,High,Low,Open,Volume\r\n"
+        "2020-09-21,107.0767822265625,110.08000183105469,110.19000244140625,103.0999984741211,104.54000091552734,195713800\r\n"
+        "\r\n"
+        "2020-09-22,108.75956726074219,111.80999755859375,112.86000061035156,109.16000366210938,112.68000030517578,183055400";
+
+    PriceColumns columns;
+    CsvParseResult result = parse_price_csv(csv, columns);
+
+    EXPECT_EQ(result.symbol, "AAPL");
+    EXPECT_EQ(result.rows, 2u);
+    EXPECT_TRUE(result.errors.empty());
+    ASSERT_EQ(columns.size(), 2u);
+    EXPECT_EQ(columns.row(0).date(), "2020-09-21");
+    EXPECT_DOUBLE_EQ(columns.adj_close[0], 107.0767822265625);
+    EXPECT_DOUBLE_EQ(columns.open[1], 112.68000030517578);
+    EXPECT_EQ(columns.volume[1], 183055400);
+}
+
+TEST(CsvLoaderTest, ReportsMalformedRowsWithLineNumbers) {
+    const std::string csv =
+        "MSFT\n"
+        "Date,Adj Close,Close,High,Low,Open,Volume\n"
+        "2020-09-21,1,2,3,4,5,6\n"
+        "2020-09-22,1,abc,3,4,5,6\n"
+        "2020-13-01,1,2,3,4,5,6\n"
+        "2020-09-24,1,2,3,4,5\n"
+        "2020-09-25,1,2,3,4,5,6.5\n"
+        "2020-09-28,1,2,3,4,5,6\n";
+
+    PriceColumns columns;
+    CsvParseResult result = parse_price_csv(csv, columns);
+
+    EXPECT_EQ(result.rows, 2u);
+    EXPECT_EQ(columns.size(), 2u);
+    ASSERT_EQ(result.errors.size(), 4u);
+    EXPECT_EQ(result.errors[0].line, 4u);
+    EXPECT_EQ(result.errors[0].message, "invalid Close 'abc'");
+    EXPECT_EQ(result.errors[1].line, 5u);
+    EXPECT_EQ(result.errors[1].message, "invalid Date '2020-13-01'");
+    EXPECT_EQ(result.errors[2].line, 6u);
+    EXPECT_EQ(result.errors[2].message, "expected 7 fields, found 6");
+    EXPECT_EQ(result.errors[3].line, 7u);
+    EXPECT_EQ(result.errors[3].message, "invalid Volume '6.5'");
+}
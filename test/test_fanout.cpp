@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "AsyncMarketDataServer.hpp"
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+grpc::ByteBuffer make_tick(const std::string &payload) {
+  grpc::Slice slice(payload);
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+std::string payload(const grpc::ByteBuffer &tick) {
+  grpc::Slice slice;
+  EXPECT_TRUE(tick.TrySingleSlice(&slice).ok());
+  return std::string(reinterpret_cast<const char *>(slice.begin()), slice.size());
+}
+
+}  // namespace
+
+TEST(SubscriberQueueTests, DropKeepsOldestTicks) {
+  SubscriberQueue queue({SlowConsumerPolicy::Drop, 2});
+
+  EXPECT_EQ(queue.offer(make_tick("1")), SubscriberQueue::Offer::Queued);
+  EXPECT_EQ(queue.offer(make_tick("2")), SubscriberQueue::Offer::Queued);
+  EXPECT_EQ(queue.offer(make_tick("3")), SubscriberQueue::Offer::Dropped);
+  EXPECT_EQ(queue.dropped(), 1);
+
+  grpc::ByteBuffer tick;
+  ASSERT_TRUE(queue.pop(tick));
+  EXPECT_EQ(payload(tick), "1");
+  ASSERT_TRUE(queue.pop(tick));
+  EXPECT_EQ(payload(tick), "2");
+  EXPECT_FALSE(queue.pop(tick));
+}
+
+TEST(SubscriberQueueTests, ConflateKeepsLatestTick) {
+  SubscriberQueue queue({SlowConsumerPolicy::Conflate, 1});
+
+  EXPECT_EQ(queue.offer(make_tick("1")), SubscriberQueue::Offer::Queued);
+  EXPECT_EQ(queue.offer(make_tick("2")), SubscriberQueue::Offer::Conflated);
+  EXPECT_EQ(queue.offer(make_tick("3")), SubscriberQueue::Offer::Conflated);
+  EXPECT_EQ(queue.size(), 1);
+
+  grpc::ByteBuffer tick;
+  ASSERT_TRUE(queue.pop(tick));
+  EXPECT_EQ(payload(tick), "3");
+}
+
+TEST(SubscriberQueueTests, DisconnectReportsOverflow) {
+  SubscriberQueue queue({SlowConsumerPolicy::Disconnect, 1});
+
+  EXPECT_EQ(queue.offer(make_tick("1")), SubscriberQueue::Offer::Queued);
+  EXPECT_EQ(queue.offer(make_tick("2")), SubscriberQueue::Offer::Overflow);
+  EXPECT_EQ(queue.size(), 1);
+}
+
+TEST(FanoutServerTests, SubscribersShareOneReplay) {
+  MarketDataServiceImpl service;
+  service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+  // Long enough for every subscriber to attach before the first tick.
+  service.set_replay(ReplayOptions::uniform(std::chrono::milliseconds(300),
+                                            std::chrono::milliseconds(300)));
+
+  AsyncMarketDataServer engine(service, 2);
+  engine.set_fanout(FanoutOptions{});
+
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+  engine.configure(builder);
+  auto server = builder.BuildAndStart();
+  ASSERT_NE(server, nullptr);
+  engine.start();
+
+  auto stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+  constexpr int kSubscribers = 8;
+  std::vector<std::vector<long long>> timestamps(kSubscribers);
+  std::vector<std::thread> threads;
+  std::atomic<int> ok_count{0};
+
+  for (int i = 0; i < kSubscribers; ++i) {
+    threads.emplace_back([&, i]() {
+      grpc::ClientContext context;
+      marketdata::StockRequest request;
+      request.set_symbol("AAPL");
+      auto reader = stub->Subscribe(&context, request);
+      marketdata::StockPrice price;
+      while (reader->Read(&price)) {
+        timestamps[i].push_back(price.timestamp_ns());
+      }
+      if (reader->Finish().ok()) ++ok_count;
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(ok_count.load(), kSubscribers);
+  // Every subscriber received the very same encoded ticks.
+  ASSERT_EQ(timestamps[0].size(), 2);
+  for (int i = 1; i < kSubscribers; ++i) {
+    EXPECT_EQ(timestamps[i], timestamps[0]);
+  }
+
+  server->Shutdown();
+  engine.stop();
+}
+
+TEST(FanoutServerTests, PerSubscriberOptionsAreRefused) {
+  MarketDataServiceImpl service;
+  service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+  service.set_replay(ReplayOptions::afap());
+
+  AsyncMarketDataServer engine(service, 1);
+  engine.set_fanout(FanoutOptions{});
+
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+  engine.configure(builder);
+  auto server = builder.BuildAndStart();
+  ASSERT_NE(server, nullptr);
+  engine.start();
+
+  auto stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+  std::vector<marketdata::StockRequest> requests(6);
+  requests[0].set_encoding(marketdata::COMPACT);
+  requests[1].mutable_replay()->set_mode(marketdata::Replay::AFAP);
+  requests[2].mutable_indicators()->set_sma_window(5);
+  requests[3].set_start_after_seq(1);
+  requests[4].set_resolution(marketdata::WEEKLY);
+  requests[5].set_follow(true);
+  for (auto &request : requests) {
+    request.set_symbol("AAPL");
+    grpc::ClientContext context;
+    auto reader = stub->Subscribe(&context, request);
+    marketdata::StockPrice price;
+    EXPECT_FALSE(reader->Read(&price));
+    EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::INVALID_ARGUMENT)
+        << request.ShortDebugString();
+  }
+
+  server->Shutdown();
+  engine.stop();
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include "LatencyStats.hpp"
 #include <chrono>
 
 TEST(LatencyTest, NonNegativeLatency) {
@@ -8,3 +9,41 @@ TEST(LatencyTest, NonNegativeLatency) {
     auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - past).count();
     EXPECT_GE(latency, 0);
 }
+
+TEST(LatencyTest, HistogramPercentilesWithinBucketPrecision) {
+    util::latency_histogram histogram;
+    for (std::uint64_t us = 1; us <= 10000; ++us) {
+        histogram.record(us);
+    }
+
+    EXPECT_EQ(histogram.count(), 10000u);
+    EXPECT_EQ(histogram.min(), 1u);
+    EXPECT_EQ(histogram.max(), 10000u);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 5000.5);
+    EXPECT_NEAR(histogram.percentile(50), 5000, 5000 / 128.0);
+    EXPECT_NEAR(histogram.percentile(99), 9900, 9900 / 128.0);
+    EXPECT_NEAR(histogram.percentile(99.9), 9990, 9990 / 128.0);
+    EXPECT_EQ(histogram.percentile(100), 10000u);
+    EXPECT_EQ(histogram.percentile(0), 1u);  // exact below 256
+}
+
+TEST(LatencyTest, StatsMergeAcrossClients) {
+    LatencyStats a, b;
+    marketdata::StockPrice price;
+    price.set_timestamp_ns(1'000'000);
+
+    LatencyStats::record(a.histogram("AAPL"), price, 1'000'000 + 250'000);  // 250 us
+    LatencyStats::record(b.histogram("AAPL"), price, 1'000'000 + 750'000);
+    LatencyStats::record(b.histogram("MSFT"), price, 1'000'000 - 5'000);    // skewed: 0 us
+
+    a.merge(b);
+    EXPECT_EQ(a.count(), 3u);
+    EXPECT_EQ(a.histogram("AAPL").min(), 250u);
+    EXPECT_EQ(a.histogram("AAPL").max(), 750u);
+    EXPECT_EQ(a.histogram("MSFT").max(), 0u);
+
+    const std::string json = a.report(LatencyStats::Format::Json);
+    EXPECT_NE(json.find("\"AAPL\":{\"count\":2,"), std::string::npos);
+    EXPECT_NE(json.find("\"total\":{\"count\":3,"), std::string::npos);
+    EXPECT_NE(a.report(LatencyStats::Format::Text).find("MSFT"), std::string::npos);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "utilities/logger.hpp"
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Collects what the logger writes, split by stream.
+struct captured_sink {
+    std::mutex mutex;
+    std::string out;
+    std::string err;
+
+    util::logger_options options(util::log_level level = util::log_level::info) {
+        util::logger_options options;
+        options.level = level;
+        options.sink = [this](std::string_view text, bool error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            (error ? err : out).append(text);
+        };
+        return options;
+    }
+};
+
+}  // namespace
+
+TEST(LoggerTest, FormatsOnTheBackgroundThread) {
+    captured_sink sink;
+    util::logger log(sink.options());
+
+    std::string symbol = "AAPL";
+    log.log(util::log_level::info, "[{}] price {}, volume {}", symbol, 187.5, 1200);
+    symbol = "MSFT";  // the argument was copied when logged
+    log.log(util::log_level::error, "failed: {} {}", std::string_view("no data"), "extra");
+    log.log(util::log_level::info, "{} and {}", 1);  // missing arguments stay as is
+    log.flush();
+
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    EXPECT_EQ(sink.out, "[AAPL] price 187.5, volume 1200\n1 and {}\n");
+    EXPECT_EQ(sink.err, "failed: no data extra\n");
+}
+
+TEST(LoggerTest, FiltersByLevel) {
+    captured_sink sink;
+    util::logger log(sink.options(util::log_level::warn));
+
+    EXPECT_FALSE(log.enabled(util::log_level::info));
+    log.log(util::log_level::info, "hidden");
+    log.log(util::log_level::warn, "shown");
+    log.set_level(util::log_level::debug);
+    log.log(util::log_level::debug, "shown too");
+    log.set_level(util::log_level::off);
+    log.log(util::log_level::error, "hidden");
+    log.flush();
+
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    EXPECT_EQ(sink.out, "shown too\n");
+    EXPECT_EQ(sink.err, "shown\n");
+
+    util::log_level level;
+    EXPECT_TRUE(util::parse_log_level("debug", level));
+    EXPECT_EQ(level, util::log_level::debug);
+    EXPECT_FALSE(util::parse_log_level("verbose", level));
+}
+
+TEST(LoggerTest, DrainsTheRingsOfExitedThreadsAndCountsDrops) {
+    captured_sink sink;
+    util::logger_options options = sink.options();
+    options.ring_capacity = 4;
+    options.idle_sleep = std::chrono::seconds(10);  // nothing drained before flush()
+    util::logger log(options);
+
+    std::thread([&] {
+        for (int i = 0; i < 3; ++i) log.log(util::log_level::info, "line {}", i);
+    }).join();
+    log.flush();
+    {
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        EXPECT_EQ(sink.out, "line 0\nline 1\nline 2\n");
+    }
+
+    std::thread([&] {
+        for (int i = 0; i < 100; ++i) log.log(util::log_level::info, "burst {}", i);
+    }).join();
+    log.flush();
+    EXPECT_GT(log.dropped(), 0u);
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "metrics.hpp"
+
+TEST(MetricsTests, ShardedValuesSumEveryThread) {
+    util::sharded_counter counter;
+    util::sharded_gauge gauge;
+    util::sharded_histogram histogram;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                counter.add();
+                gauge.add(2);
+                gauge.sub();
+                histogram.record(static_cast<std::uint64_t>(i));
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    EXPECT_EQ(counter.value(), 4000u);
+    EXPECT_EQ(gauge.value(), 4000);
+    util::latency_histogram merged;
+    histogram.merge_into(merged);
+    EXPECT_EQ(merged.count(), 4000u);
+    EXPECT_EQ(merged.max(), 999u);
+}
+
+TEST(MetricsTests, RegistrySnapshotsByNameAndLabel) {
+    util::metrics_registry registry;
+    registry.counter("sent", "MSFT").add(3);
+    registry.counter("sent", "AAPL").add(2);
+    registry.gauge("active").add(1);
+    registry.histogram("latency").record(10);
+    EXPECT_EQ(&registry.counter("sent", "AAPL"), &registry.counter("sent", "AAPL"));
+
+    const auto samples = registry.snapshot();
+    ASSERT_EQ(samples.size(), 4u);
+    EXPECT_EQ(samples[0].name, "active");
+    EXPECT_EQ(samples[1].name, "latency");
+    EXPECT_EQ(samples[1].type, util::metrics_registry::kind::histogram);
+    EXPECT_EQ(samples[1].p50, 10u);
+    EXPECT_EQ(samples[2].label, "AAPL");
+    EXPECT_EQ(samples[3].value, 3);
+
+    std::ostringstream dump;
+    registry.dump(dump, "sent");
+    EXPECT_EQ(dump.str(), "sent{AAPL} 2\nsent{MSFT} 3\n");
+}
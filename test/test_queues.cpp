@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mpmc_queue.hpp"
+#include "spsc_queue.hpp"
+
+TEST(QueueTests, SpscMovesOnlyTypesInOrder) {
+    util::spsc_queue<std::unique_ptr<int>> queue(4);
+    EXPECT_EQ(queue.capacity(), 4u);
+
+    // Wraps around the ring several times.
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(queue.try_push(std::make_unique<int>(2 * i)));
+        EXPECT_TRUE(queue.try_push(std::make_unique<int>(2 * i + 1)));
+        EXPECT_EQ(*queue.pop(), 2 * i);
+        EXPECT_EQ(*queue.try_pop().value(), 2 * i + 1);
+    }
+    EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(QueueTests, SpscBulkStopsAtCapacity) {
+    util::spsc_queue<int> queue(8);
+    std::vector<int> in(12);
+    for (int i = 0; i < 12; i++) in[i] = i;
+
+    EXPECT_EQ(queue.try_push_bulk(in.begin(), in.size()), 8u);
+    EXPECT_FALSE(queue.try_push(99));
+
+    std::vector<int> out(5);
+    EXPECT_EQ(queue.try_pop_bulk(out.begin(), out.size()), 5u);
+    EXPECT_EQ(queue.try_push_bulk(in.begin() + 8, 4), 4u);
+
+    std::vector<int> rest;
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(rest), 100), 7u);
+    EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(rest, (std::vector<int>{5, 6, 7, 8, 9, 10, 11}));
+}
+
+TEST(QueueTests, MpmcFullAndEmpty) {
+    util::mpmc_queue<std::unique_ptr<int>> queue(2);
+    EXPECT_TRUE(queue.try_emplace(new int(1)));
+    EXPECT_TRUE(queue.try_push(std::make_unique<int>(2)));
+    EXPECT_FALSE(queue.try_push(std::make_unique<int>(3)));
+
+    EXPECT_EQ(*queue.try_pop().value(), 1);
+    EXPECT_EQ(*queue.pop(), 2);
+    EXPECT_FALSE(queue.try_pop().has_value());
+
+    // Left in the queue; freed by its destructor.
+    EXPECT_TRUE(queue.try_push(std::make_unique<int>(4)));
+}
+
+TEST(QueueTests, MpmcDeliversEveryElementOnce) {
+    constexpr int producers = 4, consumers = 4, per_producer = 20000;
+    util::mpmc_queue<int> queue(64);
+    std::atomic<long long> sum{0};
+    std::atomic<int> received{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 1; i <= per_producer; i++) queue.push(p * per_producer + i);
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < producers * per_producer / consumers; i++) {
+                sum += queue.pop();
+                ++received;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    const long long n = producers * per_producer;
+    EXPECT_EQ(received.load(), n);
+    EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+    EXPECT_EQ(queue.size(), 0u);
+}
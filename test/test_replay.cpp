@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "Replay.hpp"
+#include "utilities/timer_wheel.hpp"
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Deadlines of `count` updates of one trading day each, relative to the first.
+std::vector<ReplayClock::clock::duration> offsets(ReplayClock clock, int count) {
+    std::vector<ReplayClock::clock::duration> result;
+    const auto first = clock.next(18526);
+    for (int i = 1; i < count; ++i) {
+        result.push_back(clock.next(18526 + i) - first);
+    }
+    return result;
+}
+
+struct RecordingTimer : util::wheel_timer {
+    RecordingTimer(std::vector<int> &log, int id) : log(log), id(id) {}
+    void expire(bool fired) override { log.push_back(fired ? id : -id); }
+    std::vector<int> &log;
+    int id;
+};
+
+}  // namespace
+
+TEST(ReplayTest, SeededJitterIsReproducible) {
+    const ReplayOptions options = ReplayOptions::uniform(100us, 1000us, 42);
+
+    const auto a = offsets(ReplayClock(options, "AAPL"), 50);
+    EXPECT_EQ(a, offsets(ReplayClock(options, "AAPL"), 50));
+    EXPECT_NE(a, offsets(ReplayClock(options, "MSFT"), 50));
+
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        const auto delay = a[i] - (i == 0 ? ReplayClock::clock::duration(0) : a[i - 1]);
+        EXPECT_GE(delay, 100us);
+        EXPECT_LE(delay, 1000us);
+    }
+
+    const auto e = offsets(ReplayClock(ReplayOptions::exponential(100us, 1000us, 7), "AAPL"), 50);
+    EXPECT_EQ(e, offsets(ReplayClock(ReplayOptions::exponential(100us, 1000us, 7), "AAPL"), 50));
+    EXPECT_GE(e.front(), 100us);
+}
+
+TEST(ReplayTest, FixedRateAndHistoricalAreEvenlySpaced) {
+    const auto fixed = offsets(ReplayClock(ReplayOptions::fixed_rate(1000), "AAPL"), 4);
+    EXPECT_EQ(fixed, (std::vector<ReplayClock::clock::duration>{1ms, 2ms, 3ms}));
+
+    // Two rows of the same day are due together; a weekend takes no time.
+    ReplayClock historical(ReplayOptions::historical(10), "AAPL");
+    const auto friday = historical.next(18529);
+    EXPECT_EQ(historical.next(18529), friday);
+    EXPECT_EQ(historical.next(18532) - friday, 100ms);
+
+    ReplayClock afap(ReplayOptions::afap(), "AAPL");
+    EXPECT_LE(afap.next(18526), ReplayClock::clock::now());
+}
+
+TEST(ReplayTest, ParsesCommandLineSpecs) {
+    ReplayOptions options;
+    options.seed = 9;
+    std::string error;
+
+    ASSERT_TRUE(parse_replay("rate:250000", options, error));
+    EXPECT_EQ(options.mode, ReplayMode::FixedRate);
+    EXPECT_DOUBLE_EQ(options.rate, 250000);
+    EXPECT_EQ(options.seed, 9u);
+
+    ASSERT_TRUE(parse_replay("exponential:10:30", options, error));
+    EXPECT_EQ(options.mode, ReplayMode::ExponentialJitter);
+    EXPECT_EQ(options.max_delay, 30us);
+
+    EXPECT_FALSE(parse_replay("rate:0", options, error));
+    EXPECT_FALSE(parse_replay("uniform:30:10", options, error));
+    EXPECT_FALSE(parse_replay("fast", options, error));
+    EXPECT_EQ(options.mode, ReplayMode::ExponentialJitter);  // unchanged
+}
+
+TEST(ReplayTest, RequestOverridesTheServerDefault) {
+    const ReplayOptions server = ReplayOptions::uniform(1ms, 2ms, 5);
+    ReplayOptions options;
+    std::string error;
+
+    ASSERT_TRUE(replay_for(server, marketdata::Replay(), options, error));
+    EXPECT_EQ(options.mode, ReplayMode::UniformJitter);
+    EXPECT_EQ(options.max_delay, 2ms);
+
+    marketdata::Replay request;
+    request.set_mode(marketdata::Replay::HISTORICAL);
+    request.set_rate(5);
+    ASSERT_TRUE(replay_for(server, request, options, error));
+    EXPECT_EQ(options.mode, ReplayMode::Historical);
+    EXPECT_EQ(options.seed, 5u);
+
+    request.set_rate(-1);
+    EXPECT_FALSE(replay_for(server, request, options, error));
+}
+
+TEST(TimerWheelTest, FiresDueTimersInDeadlineOrder) {
+    util::timer_wheel wheel(1ms, 8);
+    std::vector<int> log;
+    RecordingTimer a(log, 1), b(log, 2), c(log, 3), far(log, 4);
+
+    const auto now = util::timer_wheel::clock::now();
+    wheel.schedule(b, now + 3ms);
+    wheel.schedule(a, now + 1ms);
+    wheel.schedule(c, now + 5ms);
+    wheel.schedule(far, now + 20ms);  // more than one rotation ahead
+    EXPECT_LE(wheel.next_expiry(), now + 2ms);
+
+    EXPECT_TRUE(wheel.cancel(c));
+    EXPECT_FALSE(wheel.cancel(c));
+
+    EXPECT_EQ(wheel.advance(now + 4ms), 2u);
+    EXPECT_EQ(log, (std::vector<int>{1, 2}));
+    EXPECT_EQ(wheel.advance(now + 10ms), 0u);  // `far` shares a slot but is not due
+
+    wheel.drain();
+    EXPECT_EQ(log, (std::vector<int>{1, 2, -4}));
+    EXPECT_EQ(wheel.size(), 0u);
+    EXPECT_EQ(wheel.next_expiry(), util::timer_wheel::clock::time_point::max());
+}
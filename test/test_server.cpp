@@ -1,5 +1,9 @@
 #include "gtest/gtest.h"
 #include "MarketDataServer.hpp"
+#include "MarketDataClient.hpp"
+#include <grpcpp/grpcpp.h>
+#include <future>
+#include <thread>
 
 
 
@@ -28,3 +32,193 @@ TEST(MarketDataServerTest, Dummy) {
     EXPECT_DOUBLE_EQ(data[1].open(), 112.68000030517578);
     EXPECT_EQ(data[1].volume(), 183055400);
 }
+
+TEST(MarketDataServerTest, SubscribeManyPacksUnpacedDaysIntoOneBatch) {
+    MarketDataServiceImpl service;
+    service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+    service.set_replay(ReplayOptions::afap());
+
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    ASSERT_NE(server, nullptr);
+
+    auto stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+        "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+    grpc::ClientContext context;
+    marketdata::MultiStockRequest request;
+    request.add_symbols("AAPL");
+
+    auto reader = stub->SubscribeMany(&context, request);
+    std::vector<marketdata::StockPriceBatch> batches;
+    marketdata::StockPriceBatch batch;
+    while (reader->Read(&batch)) batches.push_back(batch);
+
+    EXPECT_TRUE(reader->Finish().ok());
+    ASSERT_EQ(batches.size(), 1u);
+    ASSERT_EQ(batches[0].prices_size(), 2);
+    EXPECT_EQ(batches[0].prices(0).symbol(), "AAPL");
+    EXPECT_EQ(format_date(batches[0].prices(1).epoch_day()), "2020-09-22");
+
+    server->Shutdown();
+}
+
+TEST(MarketDataServerTest, QueryRangeSendsRequestedColumnsInChunks) {
+    MarketDataServiceImpl service;
+    service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    ASSERT_NE(server, nullptr);
+
+    auto stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+        "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+    auto query = [&](const marketdata::RangeRequest &request,
+                     std::vector<marketdata::RangeChunk> &chunks) {
+        grpc::ClientContext context;
+        auto reader = stub->QueryRange(&context, request);
+        marketdata::RangeChunk chunk;
+        while (reader->Read(&chunk)) chunks.push_back(chunk);
+        return reader->Finish();
+    };
+
+    marketdata::RangeRequest request;
+    request.set_symbol("AAPL");
+    request.set_from_date("2020-09-22");
+    request.set_to_date("2021-01-01");
+    request.add_columns(marketdata::RangeRequest::CLOSE);
+    std::vector<marketdata::RangeChunk> chunks;
+    EXPECT_TRUE(query(request, chunks).ok());
+    ASSERT_EQ(chunks.size(), 1u);
+    ASSERT_EQ(chunks[0].epoch_day_size(), 1);
+    EXPECT_EQ(format_date(chunks[0].epoch_day(0)), "2020-09-22");
+    ASSERT_EQ(chunks[0].close_size(), 1);
+    EXPECT_DOUBLE_EQ(chunks[0].close(0), 111.80999755859375);
+    EXPECT_EQ(chunks[0].open_size(), 0);
+    EXPECT_EQ(chunks[0].volume_size(), 0);
+
+    // Whole history, all columns, one row per chunk.
+    request.clear_from_date();
+    request.clear_to_date();
+    request.clear_columns();
+    request.set_max_rows(1);
+    chunks.clear();
+    EXPECT_TRUE(query(request, chunks).ok());
+    ASSERT_EQ(chunks.size(), 2u);
+    EXPECT_EQ(chunks[1].volume(0), 183055400);
+    EXPECT_DOUBLE_EQ(chunks[0].open(0), 104.54000091552734);
+
+    // An empty range is not an error.
+    request.set_from_date("2021-01-01");
+    chunks.clear();
+    EXPECT_TRUE(query(request, chunks).ok());
+    EXPECT_TRUE(chunks.empty());
+
+    request.set_to_date("2020-01-01");
+    EXPECT_EQ(query(request, chunks).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+    server->Shutdown();
+}
+
+TEST(MarketDataServerTest, GetStatsReportsWhatWasSent) {
+    MarketDataServiceImpl service;
+    service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+    service.set_replay(ReplayOptions::afap());
+
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    ASSERT_NE(server, nullptr);
+
+    auto stub = marketdata::MarketData::NewStub(grpc::CreateChannel(
+        "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+    {
+        grpc::ClientContext context;
+        marketdata::MultiStockRequest request;
+        request.add_symbols("AAPL");
+        auto reader = stub->SubscribeMany(&context, request);
+        marketdata::StockPriceBatch batch;
+        while (reader->Read(&batch)) {
+        }
+        ASSERT_TRUE(reader->Finish().ok());
+    }
+
+    grpc::ClientContext context;
+    marketdata::StatsReply reply;
+    ASSERT_TRUE(stub->GetStats(&context, marketdata::StatsRequest(), &reply).ok());
+    auto find = [&](const std::string &name, const std::string &label) {
+        for (const auto &metric : reply.metrics()) {
+            if (metric.name() == name && metric.label() == label) return metric;
+        }
+        ADD_FAILURE() << "No metric " << name << "{" << label << "}";
+        return marketdata::Metric();
+    };
+
+    EXPECT_EQ(find("updates_sent", "AAPL").value(), 2);
+    EXPECT_GT(find("bytes_sent", "AAPL").value(), 0);
+    EXPECT_EQ(find("subscriptions_total", "").value(), 1);
+    EXPECT_EQ(find("subscriptions_active", "").value(), 0);
+    EXPECT_EQ(find("streams_cancelled", "").value(), 0);
+    EXPECT_EQ(find("rows_loaded", "sample.csv").value(), 2);
+    const marketdata::Metric latency = find("write_latency_ns", "");
+    EXPECT_EQ(latency.kind(), marketdata::Metric::HISTOGRAM);
+    EXPECT_EQ(latency.count(), 1u);  // one batch
+
+    server->Shutdown();
+}
+
+TEST(MarketDataServerTest, ClientResumesAfterServerRestart) {
+    auto start_server = [](MarketDataServiceImpl &service, const std::string &address, int &port) {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort(address, grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&service);
+        return builder.BuildAndStart();
+    };
+
+    // The first server sends the first row, then goes away before the second.
+    MarketDataServiceImpl first;
+    first.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+    first.set_replay(ReplayOptions::fixed_rate(2));
+    int port = 0;
+    auto server = start_server(first, "localhost:0", port);
+    ASSERT_NE(server, nullptr);
+    const std::string address = "localhost:" + std::to_string(port);
+
+    MarketDataServiceImpl second;
+    second.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+    second.set_replay(ReplayOptions::afap());
+
+    auto client = MarketDataClient::createClient(
+        grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    ASSERT_TRUE(client.ok());
+    ReconnectPolicy policy;
+    policy.initial_backoff = std::chrono::milliseconds(50);
+    client->setReconnectPolicy(policy);
+
+    std::promise<void> first_update;
+    std::vector<std::uint64_t> seqs;
+    std::thread subscriber([&] {
+        EXPECT_TRUE(client->subscribeToSymbol("AAPL", [&](const marketdata::StockPrice &price) {
+            seqs.push_back(price.seq());
+            if (seqs.size() == 1) first_update.set_value();
+        }, marketdata::COMPACT).ok());
+    });
+
+    first_update.get_future().wait();
+    server->Shutdown(std::chrono::system_clock::now());
+    server.reset();
+    int restarted_port = 0;
+    server = start_server(second, address, restarted_port);
+    ASSERT_NE(server, nullptr);
+    subscriber.join();
+
+    EXPECT_EQ(seqs, (std::vector<std::uint64_t>{1, 2}));
+    server->Shutdown();
+}
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "MarketDataServer.hpp"
+#include "SharedMemoryClient.hpp"
+#include "SharedMemoryFeed.hpp"
+#include "utilities/seqlock_ring.hpp"
+#include <grpcpp/grpcpp.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Record {
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+};
+
+using Ring = util::seqlock_ring<Record>;
+
+// Records the sequence numbers received per symbol.
+struct Recorder : PriceConsumer {
+  void on_ticks(const std::string &symbol, std::span<const Tick> ticks) override {
+    for (const Tick &tick : ticks) seqs[symbol].push_back(tick.seq);
+  }
+  std::map<std::string, std::vector<std::uint64_t>> seqs;
+};
+
+}  // namespace
+
+TEST(SeqlockRingTests, ReadersFollowTheWriterAndCountOverruns) {
+  std::vector<std::byte> memory(Ring::bytes(4) + util::CACHE_LINE_SIZE);
+  void *aligned = memory.data() + (util::CACHE_LINE_SIZE -
+                                   reinterpret_cast<std::uintptr_t>(memory.data()) % util::CACHE_LINE_SIZE);
+  Ring writer = Ring::create(aligned, 3);
+  ASSERT_EQ(writer.capacity(), 4u);
+
+  Ring::reader reader(Ring::attach(aligned), 0);
+  Record record;
+  EXPECT_FALSE(reader.next(record));
+  EXPECT_EQ(writer.read(0, record), Ring::read_result::empty);
+
+  writer.push({1, 10});
+  writer.push({2, 20});
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.a, 1u);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.b, 20u);
+  EXPECT_FALSE(reader.next(record));
+
+  // Lapped: positions 2 to 5 are overwritten by 6 to 9 before being read.
+  for (std::uint64_t i = 3; i <= 10; ++i) writer.push({i, i * 10});
+  EXPECT_EQ(writer.read(2, record), Ring::read_result::overrun);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.a, 9u);  // resumed half a ring behind the writer
+  EXPECT_EQ(reader.lost(), 6u);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.a, 10u);
+  EXPECT_FALSE(reader.next(record));
+}
+
+TEST(SharedMemoryFeedTest, ClientReadsEveryTickOfTheReplay) {
+  MarketDataServiceImpl service;
+  service.load_data(std::string(TESTING_CMAKE_CURRENT_SOURCE_DIR) + "/sample.csv");
+  service.set_replay(ReplayOptions::fixed_rate(1000));
+
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+  builder.RegisterService(&service);
+  auto server = builder.BuildAndStart();
+  ASSERT_NE(server, nullptr);
+  auto channel = grpc::CreateChannel("localhost:" + std::to_string(port),
+                                     grpc::InsecureChannelCredentials());
+
+  {
+    Recorder recorder;
+    SharedMemoryClient client(channel, {"AAPL"}, recorder);
+    EXPECT_EQ(client.run().error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+  }
+
+  SharedMemoryOptions options;
+  options.name = "/marketdata_test_" + std::to_string(::getpid());
+  options.max_symbols = 2;
+  options.ring_capacity = 8;
+  SharedMemoryFeed feed(service, options);
+  std::string error;
+  ASSERT_TRUE(feed.start(error)) << error;
+  service.set_shared_memory(&feed);
+
+  // Twice: the second subscription starts a new replay after the first ended.
+  for (int run = 0; run < 2; ++run) {
+    Recorder recorder;
+    SharedMemoryClient client(channel, {"AAPL"}, recorder);
+    ASSERT_TRUE(client.run().ok());
+    EXPECT_EQ(recorder.seqs["AAPL"], (std::vector<std::uint64_t>{1, 2}));
+    EXPECT_EQ(client.received(), 2u);
+    EXPECT_EQ(client.lost(), 0u);
+    EXPECT_EQ(client.latency().count(), 2u);
+  }
+
+  {
+    Recorder recorder;
+    SharedMemoryClient client(channel, {"AAPL", "MSFT"}, recorder);
+    EXPECT_EQ(client.run().error_code(), grpc::StatusCode::NOT_FOUND);
+  }
+
+  server->Shutdown();
+  feed.stop();
+}
+
+TEST(SharedMemoryFeedTest, StartReplacesOnlyAStaleSegment) {
+  MarketDataServiceImpl service;
+  SharedMemoryOptions options;
+  options.name = "/marketdata_stale_test_" + std::to_string(::getpid());
+  options.max_symbols = 1;
+  options.ring_capacity = 8;
+  std::string error;
+
+  SharedMemoryFeed live(service, options);
+  ASSERT_TRUE(live.start(error)) << error;
+  SharedMemoryFeed second(service, options);
+  EXPECT_FALSE(second.start(error));
+  EXPECT_NE(error.find("not stale"), std::string::npos) << error;
+  live.stop();
+
+  // Left behind by a server that exited without removing it.
+  const pid_t dead = ::fork();
+  if (dead == 0) ::_exit(0);
+  ASSERT_GT(dead, 0);
+  ::waitpid(dead, nullptr, 0);
+  const int fd = ::shm_open(options.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  ASSERT_GE(fd, 0);
+  SharedFeedLayout::Header header;
+  header.magic = SharedFeedLayout::kMagic;
+  header.writer_pid = dead;
+  ASSERT_EQ(::write(fd, &header, sizeof(header)), static_cast<ssize_t>(sizeof(header)));
+  ::close(fd);
+
+  SharedMemoryFeed restarted(service, options);
+  EXPECT_TRUE(restarted.start(error)) << error;
+  restarted.stop();
+  ::shm_unlink(options.name.c_str());
+}
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "Snapshot.hpp"
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+std::string temp_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void fill(StockStore &store) {
+    PriceColumns aapl;
+    aapl.append(StockData("2020-09-21", 107.07, 110.08, 110.19, 103.09, 104.54, 195713800));
+    aapl.append(StockData("2020-09-22", 108.75, 111.80, 112.86, 109.16, 112.68, 183055400));
+    store.add("AAPL", std::move(aapl));
+
+    PriceColumns msft;
+    msft.append(StockData("2020-09-21", 1.0, 2.0, 3.0, 4.0, 5.0, 7));
+    store.add("MSFT", std::move(msft));
+}
+
+}  // namespace
+
+TEST(SnapshotTest, RoundTripServesColumnsFromTheMapping) {
+    const std::string path = temp_path("snapshot_roundtrip.snap");
+    StockStore store;
+    fill(store);
+    const std::vector<SnapshotSource> sources = {{"AAPL_5y.csv", 1234}, {"MSFT_5y.csv", 56}};
+    std::string error;
+    ASSERT_TRUE(write_snapshot(store, sources, path, error)) << error;
+
+    auto snapshot = Snapshot::open(path, true, error);
+    ASSERT_NE(snapshot, nullptr) << error;
+    ASSERT_EQ(snapshot->size(), 2u);
+    EXPECT_EQ(snapshot->symbol(0), "AAPL");
+    EXPECT_EQ(snapshot->symbol(1), "MSFT");
+    EXPECT_EQ(snapshot->sources(), sources);
+
+    const StockSeries aapl = snapshot->series(0);
+    ASSERT_EQ(aapl.size(), 2u);
+    EXPECT_EQ(aapl[0].date(), "2020-09-21");
+    EXPECT_DOUBLE_EQ(aapl[1].close(), 111.80);
+    EXPECT_EQ(aapl[1].volume(), 183055400);
+    EXPECT_EQ(snapshot->series(1)[0].volume(), 7);
+
+    // The series keeps the mapping alive.
+    snapshot.reset();
+    EXPECT_DOUBLE_EQ(aapl[0].open(), 104.54);
+
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, RejectsCorruptedFiles) {
+    const std::string path = temp_path("snapshot_corrupt.snap");
+    StockStore store;
+    fill(store);
+    std::string error;
+    ASSERT_TRUE(write_snapshot(store, {}, path, error)) << error;
+    const auto size = std::filesystem::file_size(path);
+
+    auto patch = [&](std::streamoff offset, char value) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(offset);
+        file.put(value);
+    };
+
+    // Column data: only caught when verifying the data.
+    patch(static_cast<std::streamoff>(size) - 1, 0x7f);
+    EXPECT_NE(Snapshot::open(path, false, error), nullptr);
+    EXPECT_EQ(Snapshot::open(path, true, error), nullptr);
+    EXPECT_EQ(error, "data checksum mismatch");
+
+    // Index: always caught.
+    patch(sizeof(SnapshotHeader) + 2 * sizeof(SnapshotIndexEntry), 'X');
+    EXPECT_EQ(Snapshot::open(path, false, error), nullptr);
+    EXPECT_EQ(error, "index checksum mismatch");
+
+    // Version.
+    patch(offsetof(SnapshotHeader, version), 9);
+    EXPECT_EQ(Snapshot::open(path, false, error), nullptr);
+    EXPECT_EQ(error, "unsupported version 9");
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include "StockStore.hpp"
+
+TEST(StockStoreTest, DateRoundTrip) {
+    EXPECT_EQ(parse_date("1970-01-01"), 0);
+    EXPECT_EQ(parse_date("2020-09-21"), 18526);
+    EXPECT_EQ(format_date(18526), "2020-09-21");
+    EXPECT_EQ(format_date(*parse_date("2024-02-29")), "2024-02-29");
+
+    EXPECT_FALSE(parse_date("2023-02-29"));
+    EXPECT_FALSE(parse_date("2020-9-21"));
+    EXPECT_FALSE(parse_date("2020/09/21"));
+}
+
+TEST(StockStoreTest, SymbolsAreInternedToDenseIds) {
+    SymbolTable symbols;
+    EXPECT_EQ(symbols.intern("AAPL"), 0u);
+    EXPECT_EQ(symbols.intern("MSFT"), 1u);
+    EXPECT_EQ(symbols.intern("AAPL"), 0u);
+    EXPECT_EQ(symbols.size(), 2u);
+    EXPECT_EQ(symbols.name(1), "MSFT");
+    EXPECT_EQ(symbols.find("MSFT"), 1u);
+    EXPECT_FALSE(symbols.find("TSLA"));
+}
+
+TEST(StockStoreTest, SeriesViewsTheColumns) {
+    StockStore store;
+    PriceColumns columns;
+    columns.append(StockData("2020-09-21", 1.0, 2.0, 3.0, 0.5, 1.5, 100));
+    columns.append(StockData("2020-09-22", 1.1, 2.1, 3.1, 0.6, 1.6, 200));
+    store.add("AAPL", std::move(columns));
+
+    EXPECT_TRUE(store.series("MSFT").empty());
+
+    const StockSeries series = store.series("AAPL");
+    ASSERT_EQ(series.size(), 2u);
+    EXPECT_EQ(series[1].date(), "2020-09-22");
+    EXPECT_DOUBLE_EQ(series[1].close(), 2.1);
+    EXPECT_EQ(series[1].volume(), 200);
+    EXPECT_EQ(series.columns().volume[0], 100);
+
+    long long volume = 0;
+    for (const StockData &row : series) volume += row.volume();
+    EXPECT_EQ(volume, 300);
+}
+
+TEST(StockStoreTest, AddMergesByDateWithoutChangingPublishedSeries) {
+    StockStore store;
+    PriceColumns later;
+    later.append(StockData("2020-09-23", 0, 3.0, 0, 0, 0, 3));
+    later.append(StockData("2020-09-25", 0, 5.0, 0, 0, 0, 5));
+    store.add("AAPL", std::move(later));
+
+    const StockSeries before = store.series("AAPL");
+
+    PriceColumns earlier;
+    earlier.append(StockData("2020-09-21", 0, 1.0, 0, 0, 0, 1));
+    earlier.append(StockData("2020-09-24", 0, 4.0, 0, 0, 0, 4));
+    store.add("AAPL", std::move(earlier));
+
+    const StockSeries after = store.series("AAPL");
+    ASSERT_EQ(after.size(), 4u);
+    const auto volume = after.columns().volume;
+    EXPECT_EQ(std::vector<std::int64_t>(volume.begin(), volume.end()),
+              (std::vector<std::int64_t>{1, 3, 4, 5}));
+    EXPECT_EQ(before.size(), 2u);
+    EXPECT_EQ(store.size(), 1u);
+}
+
+TEST(StockStoreTest, AddSortsRowsByDate) {
+    StockStore store;
+    PriceColumns newest_first;
+    newest_first.append(StockData("2020-09-24", 0, 4.0, 0, 0, 0, 4));
+    newest_first.append(StockData("2020-09-22", 0, 2.0, 0, 0, 0, 2));
+    newest_first.append(StockData("2020-09-23", 0, 3.0, 0, 0, 0, 3));
+    newest_first.append(StockData("2020-09-21", 0, 1.0, 0, 0, 0, 1));
+    store.add("AAPL", std::move(newest_first));
+
+    const StockSeries series = store.series("AAPL");
+    const auto volume = series.columns().volume;
+    EXPECT_EQ(std::vector<std::int64_t>(volume.begin(), volume.end()),
+              (std::vector<std::int64_t>{1, 2, 3, 4}));
+    const auto [first, last] = series.rows_between(*parse_date("2020-09-22"),
+                                                   *parse_date("2020-09-23"));
+    EXPECT_EQ(first, 1u);
+    EXPECT_EQ(last, 3u);
+}
+
+TEST(StockStoreTest, AppendWritesInPlaceBehindPublishedSeries) {
+    StockStore store;
+    std::string error;
+    PriceColumns first;
+    for (int day = 0; day < 4; ++day) first.append(StockData(day, 0, day, 0, 0, 0, day));
+    ASSERT_TRUE(store.append("AAPL", std::move(first), error)) << error;
+    const StockStore::Handle aapl = store.handle("AAPL");
+    ASSERT_TRUE(aapl);
+    EXPECT_FALSE(store.handle("MSFT"));
+
+    // The first append copies into columns with room; the next ones fit.
+    PriceColumns one;
+    one.append(StockData(4, 0, 4, 0, 0, 0, 4));
+    ASSERT_TRUE(store.append("AAPL", std::move(one), error)) << error;
+    const StockSeries five = store.series("AAPL");
+
+    PriceColumns same_day;
+    same_day.append(StockData(4, 0, 4.5, 0, 0, 0, 5));
+    ASSERT_TRUE(store.append("AAPL", std::move(same_day), error)) << error;
+    const StockSeries six = store.series("AAPL");
+    EXPECT_EQ(six.columns().date.data(), five.columns().date.data());
+    EXPECT_EQ(five.size(), 5u);
+    ASSERT_EQ(six.size(), 6u);
+    EXPECT_EQ(six[5].close(), 4.5);
+    EXPECT_EQ(aapl.latest().size(), 6u);
+
+    PriceColumns earlier;
+    earlier.append(StockData(3, 0, 3, 0, 0, 0, 3));
+    EXPECT_FALSE(store.append("AAPL", std::move(earlier), error));
+    PriceColumns unordered;
+    unordered.append(StockData(9, 0, 9, 0, 0, 0, 9));
+    unordered.append(StockData(8, 0, 8, 0, 0, 0, 8));
+    EXPECT_FALSE(store.append("AAPL", std::move(unordered), error));
+    EXPECT_EQ(store.series("AAPL").size(), 6u);
+
+    // A batch is all or nothing: MSFT is valid, but AAPL goes back in time.
+    std::vector<StockStore::SymbolRows> batch(2);
+    batch[0].first = "MSFT";
+    batch[0].second.append(StockData(1, 0, 1, 0, 0, 0, 1));
+    batch[1].first = "AAPL";
+    batch[1].second.append(StockData(2, 0, 2, 0, 0, 0, 2));
+    EXPECT_FALSE(store.append(std::move(batch), error));
+    EXPECT_TRUE(store.series("MSFT").empty());
+    EXPECT_EQ(store.series("AAPL").size(), 6u);
+}
+
+TEST(StockStoreTest, SeriesMergeIsOrderedByDayThenSeries) {
+    auto series = [](std::initializer_list<const char *> dates, long long volume) {
+        auto columns = std::make_shared<PriceColumns>();
+        for (const char *date : dates) columns->append(StockData(date, 1, 1, 1, 1, 1, volume));
+        return StockSeries(columns);
+    };
+
+    SeriesMerge merge({series({"2020-09-21", "2020-09-23"}, 0),
+                       StockSeries(),
+                       series({"2020-09-21", "2020-09-22", "2020-09-24"}, 2)});
+
+    std::vector<std::pair<std::string, std::size_t>> order;
+    for (; !merge.done(); merge.next()) {
+        EXPECT_EQ(merge.row().volume(), static_cast<long long>(merge.source()));
+        order.emplace_back(merge.row().date(), merge.source());
+    }
+
+    const std::vector<std::pair<std::string, std::size_t>> expected = {
+        {"2020-09-21", 0}, {"2020-09-21", 2}, {"2020-09-22", 2},
+        {"2020-09-23", 0}, {"2020-09-24", 2}};
+    EXPECT_EQ(order, expected);
+}
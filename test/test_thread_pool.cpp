@@ -1,6 +1,26 @@
 #include <gtest/gtest.h>
+#include <array>
 #include "thread_pool.hpp"
 
+namespace {
+
+// The first core this process may run on: core 0 can be outside a
+// container's or taskset's CPU set.
+unsigned int first_allowed_core() {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (unsigned int core = 0; core < CPU_SETSIZE; ++core) {
+            if (CPU_ISSET(core, &allowed)) return core;
+        }
+    }
+#endif
+    return 0;
+}
+
+}  // namespace
+
 TEST(ThreadPoolTests, TaskReturnsValue) {
     util::thread_pool pool(2);
 
@@ -20,3 +40,132 @@ TEST(ThreadPoolTests, MultipleTasks) {
         EXPECT_EQ(futures[i].get(), i * i);
     }
 }
+
+TEST(ThreadPoolTests, WorkStealingRunsEveryTask) {
+    util::thread_pool pool(4, util::scheduling::work_stealing);
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; i++) {
+        futures.push_back(pool.ExecuteTask([i] { return i * i; }));
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(futures[i].get(), i * i);
+    }
+}
+
+TEST(ThreadPoolTests, WorkStealingNestedSpawns) {
+    util::thread_pool pool(4, util::scheduling::work_stealing);
+    std::atomic<int> leaves{0};
+    std::promise<void> done;
+
+    // Binary tree of tasks, each spawned from inside a worker.
+    std::function<void(int)> spawn = [&](int depth) {
+        if (depth == 0) {
+            if (++leaves == 256) done.set_value();
+            return;
+        }
+        pool.ExecuteTask(spawn, depth - 1);
+        pool.ExecuteTask(spawn, depth - 1);
+    };
+    pool.ExecuteTask(spawn, 8);
+
+    EXPECT_EQ(done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(leaves.load(), 256);
+}
+
+TEST(ThreadPoolTests, ExceptionReachesFuture) {
+    util::thread_pool pool(2);
+
+    auto f = pool.ExecuteTask([] { throw std::runtime_error("boom"); return 0; });
+    EXPECT_THROW(f.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTests, PostRunsMoveOnlyTasks) {
+    for (auto mode : {util::scheduling::shared_queue, util::scheduling::work_stealing}) {
+        util::thread_pool pool(2, mode);
+        std::promise<int> result;
+
+        auto value = std::make_unique<int>(7);
+        pool.Post([v = std::move(value), &result] { result.set_value(*v); });
+        EXPECT_EQ(result.get_future().get(), 7);
+    }
+}
+
+TEST(ThreadPoolTests, OptionsPinNameAndPollWorkers) {
+    const unsigned int core = first_allowed_core();
+    for (auto mode : {util::scheduling::shared_queue, util::scheduling::work_stealing}) {
+        for (auto wait : {util::wait_strategy::park, util::wait_strategy::spin_park,
+                          util::wait_strategy::busy_poll}) {
+            util::thread_pool_options options;
+            options.threads = 2;
+            options.mode = mode;
+            options.cores = {core};
+            options.numa_local = true;
+            options.name = "pool";
+            options.wait = wait;
+            options.spin_budget = 64;
+            util::thread_pool pool(options);
+
+            std::vector<std::future<int>> futures;
+            for (int i = 0; i < 100; i++) {
+                futures.push_back(pool.ExecuteTask([i] { return i * i; }));
+            }
+            for (int i = 0; i < 100; i++) {
+                EXPECT_EQ(futures[i].get(), i * i);
+            }
+
+#if defined(__linux__)
+            auto where = pool.ExecuteTask([] {
+                char name[16] = {};
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+                return std::make_pair(std::string(name), sched_getcpu());
+            }).get();
+            EXPECT_EQ(where.first.rfind("pool-", 0), 0u);
+            EXPECT_EQ(where.second, static_cast<int>(core));
+#endif
+        }
+    }
+}
+
+TEST(ThreadAffinityTests, ParsesCoreLists) {
+    std::vector<unsigned int> cores;
+    EXPECT_TRUE(util::parse_core_list("0,2,4-6", cores));
+    EXPECT_EQ(cores, (std::vector<unsigned int>{0, 2, 4, 5, 6}));
+    EXPECT_FALSE(util::parse_core_list("", cores));
+    EXPECT_FALSE(util::parse_core_list("3-1", cores));
+    EXPECT_FALSE(util::parse_core_list("1,x", cores));
+    EXPECT_FALSE(util::parse_core_list("0-4294967295", cores));
+    EXPECT_FALSE(util::parse_core_list(std::to_string(util::max_cpu_count), cores));
+}
+
+TEST(TaskTests, StoresSmallCallablesInline) {
+    int calls = 0;
+    auto small = [&calls] { ++calls; };
+    std::array<char, 128> payload{};
+    auto large = [&calls, payload] { calls += payload.size(); };
+    static_assert(util::task::stored_inline<decltype(small)>);
+    static_assert(!util::task::stored_inline<decltype(large)>);
+
+    util::task a(small), b(large);
+    util::task moved = std::move(b);
+    a();
+    moved();
+    EXPECT_EQ(calls, 129);
+    EXPECT_FALSE(b);
+}
+
+TEST(WorkStealingDequeTests, OwnerIsLifoThievesAreFifo) {
+    util::work_stealing_deque<int> deque(2);
+    int items[5] = {0, 1, 2, 3, 4};
+    for (int &item : items) deque.push(&item);  // grows past the capacity
+
+    EXPECT_EQ(deque.steal(), &items[0]);
+    EXPECT_EQ(deque.pop(), &items[4]);
+    EXPECT_EQ(deque.steal(), &items[1]);
+    EXPECT_EQ(deque.pop(), &items[3]);
+    EXPECT_EQ(deque.pop(), &items[2]);
+    EXPECT_EQ(deque.pop(), nullptr);
+    EXPECT_EQ(deque.steal(), nullptr);
+    EXPECT_TRUE(deque.empty());
+}